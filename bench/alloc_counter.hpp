@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstddef>
+
+// Number of operator new calls so far in this process
+std::size_t allocationCount();
@@ -0,0 +1,303 @@
+/*--------------------------------------------------------------*/
+/*      Micro-benchmarks for the code that runs on every        */
+/*      request. Prints one JSON object per benchmark:          */
+/*                                                              */
+/*        {"name":..., "iterations":..., "ns_per_op":...,       */
+/*         "allocs_per_op":..., "bytes_per_op":...,             */
+/*         "mb_per_s":...}                                      */
+/*                                                              */
+/*      Usage: bench_hotpath [data-dir] [name-filter]           */
+/*      allocs_per_op counts operator new calls only; libcurl   */
+/*      allocates with malloc and is not included               */
+/*--------------------------------------------------------------*/
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory_resource>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <curl/curl.h>
+#include <nlohmann/json.hpp>
+
+#include "alloc_counter.hpp"
+#include "endpoint_schema.hpp"
+#include "mock_streamer.hpp"
+#include "schwab_api.hpp"
+#include "utils.hpp"
+
+using string = std::string;
+
+/*----------------------*/
+/*      Harness         */
+/*----------------------*/
+// Keeps the optimizer from dropping a result
+template <class T>
+static void keep(T const& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+static string filter;
+static constexpr std::chrono::milliseconds minTime{300};
+
+/*
+ * Runs op in batches, doubling the batch until one takes at least
+ * minTime, and reports that batch. bytesPerOp is the input size for
+ * throughput; 0 leaves mb_per_s out.
+ */
+template <class Op>
+static void run(const char* name, std::size_t bytesPerOp, Op&& op) {
+    if (!filter.empty() && string(name).find(filter) == string::npos) {
+        return;
+    }
+    using Clock = std::chrono::steady_clock;
+
+    op();   // warm up
+    for (std::size_t iterations = 1; ; iterations *= 2) {
+        std::size_t allocsBefore = allocationCount();
+        auto start = Clock::now();
+        for (std::size_t i = 0; i < iterations; ++i) {
+            op();
+        }
+        auto elapsed = Clock::now() - start;
+        std::size_t allocs = allocationCount() - allocsBefore;
+
+        if (elapsed < minTime) {
+            continue;
+        }
+        double ns = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+        std::printf("{\"name\":\"%s\",\"iterations\":%zu,\"ns_per_op\":%.1f,\"allocs_per_op\":%.2f,"
+                    "\"bytes_per_op\":%zu",
+                    name, iterations, ns, static_cast<double>(allocs) / iterations, bytesPerOp);
+        if (bytesPerOp) {
+            std::printf(",\"mb_per_s\":%.1f", bytesPerOp / ns * 1e9 / (1024.0 * 1024.0));
+        }
+        std::printf("}\n");
+        std::fflush(stdout);
+        return;
+    }
+}
+
+static string readFile(const string& path) {
+    std::ifstream in{path, std::ios::binary};
+    if (!in) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    std::ostringstream out;
+    out << in.rdbuf();
+    return out.str();
+}
+
+/*
+ * Answers every request on 127.0.0.1 with the same 200 response over
+ * keep-alive connections, one connection at a time, so Client requests
+ * can be timed without the network.
+ */
+class LocalHttpServer {
+    public:
+        explicit LocalHttpServer(const string& body)
+            : response_{"HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: "
+                        + std::to_string(body.size()) + "\r\n\r\n" + body} {
+            listenFd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            socklen_t length = sizeof(addr);
+            if (listenFd_ < 0 || ::bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), length) != 0
+                    || ::listen(listenFd_, 4) != 0
+                    || ::getsockname(listenFd_, reinterpret_cast<sockaddr*>(&addr), &length) != 0) {
+                throw std::runtime_error("Cannot listen on 127.0.0.1");
+            }
+            port_ = ntohs(addr.sin_port);
+            thread_ = std::thread([this] { serve(); });
+        }
+        ~LocalHttpServer() {
+            stop_ = true;
+            thread_.join();
+            ::close(listenFd_);
+        }
+
+        string baseUrl() const { return "http://127.0.0.1:" + std::to_string(port_) + "/"; }
+
+    private:
+        void serve() {
+            while (!stop_) {
+                pollfd listening{listenFd_, POLLIN, 0};
+                if (::poll(&listening, 1, 50) <= 0) continue;
+                int fd = ::accept(listenFd_, nullptr, nullptr);
+                if (fd < 0) continue;
+                string pending;
+                char chunk[4096];
+                while (!stop_) {
+                    pollfd connection{fd, POLLIN, 0};
+                    if (::poll(&connection, 1, 50) <= 0) continue;
+                    ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+                    if (n <= 0) break;
+                    pending.append(chunk, static_cast<std::size_t>(n));
+                    for (std::size_t end; (end = pending.find("\r\n\r\n")) != string::npos; ) {
+                        pending.erase(0, end + 4);
+                        [[maybe_unused]] auto sent = ::send(fd, response_.data(), response_.size(), MSG_NOSIGNAL);
+                    }
+                }
+                ::close(fd);
+            }
+        }
+
+        const string response_;
+        int listenFd_ = -1;
+        std::uint16_t port_ = 0;
+        std::atomic<bool> stop_{false};
+        std::thread thread_;
+};
+
+/*----------------------*/
+/*      Benchmarks      */
+/*----------------------*/
+int main(int argc, char** argv) {
+    string dataDir = argc > 1 ? argv[1] : "bench/data";
+    filter = argc > 2 ? argv[2] : "";
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    // Request building
+    const std::map<string, string> params = {
+        {"symbol", "AAPL"}, {"periodType", "day"}, {"period", "10"},
+        {"frequencyType", "minute"}, {"frequency", "5"},
+        {"startDate", "1704205800000"}, {"endDate", "1705069800000"},
+        {"needExtendedHoursData", "false"}, {"needPreviousClose", "true"}
+    };
+    const string token(92, 'T');    // Schwab access tokens are ~90 characters
+
+    run("schemaLookup", 0, [&] { keep(priceHistorySchema.index("needExtendedHoursData")); });
+    run("schemaValidate", 0, [&] {
+        EndpointUrl<priceHistorySchema> url;
+        keep(!url.set(params) && !url.check());
+    });
+    run("buildUrl", 0, [&] {
+        EndpointUrl<priceHistorySchema> url;
+        url.set(params);
+        keep(url.build(schwabBaseUrl));
+    });
+    run("buildQuotesUrl", 0, [&] {
+        EndpointUrl<quotesSchema> url;
+        keep(url.set("symbols", "AAPL,MSFT,BRK/B,$SPX").set("fields", "quote").set("indicative", false)
+                .build(schwabBaseUrl));
+    });
+    run("datetimeToEpoch", 0, [&] { keep(Client::datetimeToEpoch("19-01-2024 15:30:00")); });
+
+    // Column conversions, one minute apart like intraday candles
+    std::vector<long long> stamps(2000);
+    for (std::size_t i = 0; i < stamps.size(); ++i) {
+        stamps[i] = 1705678200000LL + static_cast<long long>(i) * 60000;
+    }
+    const std::size_t width = dateFormatWidth(DateFormat::DateTime);
+    std::vector<char> formatted(stamps.size() * width);
+    std::vector<std::string_view> texts(stamps.size());
+    formatEpochMs(stamps, formatted, DateFormat::DateTime);
+    for (std::size_t i = 0; i < texts.size(); ++i) {
+        texts[i] = std::string_view(formatted.data() + i * width, width);
+    }
+    std::vector<long long> parsed(stamps.size());
+    run("parseEpochMs_2000", formatted.size(), [&] { keep(parseEpochMs(texts, parsed, DateFormat::DateTime)); });
+    run("formatEpochMs_2000", formatted.size(), [&] { keep(formatEpochMs(stamps, formatted, DateFormat::DateTime)); });
+    run("authHeaders", 0, [&] {
+        struct curl_slist* headers = authHeaders(token);
+        keep(headers);
+        curl_slist_free_all(headers);
+    });
+
+    // Response parsing
+    const string quotes = readFile(dataDir + "/quotes.json");
+    const string chains = readFile(dataDir + "/chains.json");
+    const string history = readFile(dataDir + "/pricehistory.json");
+
+    run("json_parse_quotes", quotes.size(), [&] { keep(nlohmann::json::parse(quotes)); });
+    run("json_parse_chains", chains.size(), [&] { keep(nlohmann::json::parse(chains)); });
+    run("json_parse_pricehistory", history.size(), [&] { keep(nlohmann::json::parse(history)); });
+    run("parseCandles_pricehistory", history.size(), [&] { keep(parseCandles(history)); });
+    JsonDocument document;
+    run("jsonDocument_quotes", quotes.size(), [&] { keep(document.parse(quotes)["AAPL"]["quote"]["bidPrice"].number()); });
+    run("jsonDocument_chains", chains.size(), [&] { keep(document.parse(chains)["underlyingPrice"].number()); });
+    run("jsonDocument_pricehistory", history.size(), [&] { keep(document.parse(history)["candles"].size()); });
+    run("parseOptionChain_chains", chains.size(), [&] { keep(parseOptionChain(chains)); });
+
+    // A quote poll over loopback, returning a new string and writing into a
+    // reused buffer. The responder runs in this process, but reuses its
+    // buffers too, so allocs_per_op is the client's
+    {
+        LocalHttpServer server(quotes);
+        const string tokensFile = "/tmp/bench_tokens_" + std::to_string(::getpid()) + ".json";
+        std::ofstream(tokensFile) << nlohmann::json{
+            {"access_token", token}, {"refresh_token", "R"},
+            {"access_token_expiration", 4102444800LL}, {"refresh_token_expiration", 4102444800LL}
+        };
+        Client client("key", "secret", "http://127.0.0.1/callback", tokensFile,
+                      std::chrono::milliseconds(5000), 1, server.baseUrl());
+        client.rateLimiter().setRate(0, 1);
+        std::pmr::string out;
+        run("client_quote", quotes.size(), [&] { keep(client.quotes("AAPL", "quote")); });
+        run("client_quote_buffered", quotes.size(), [&] { keep(client.quotes("AAPL", "quote", out)); });
+        ::unlink(tokensFile.c_str());
+    }
+
+    // Local pricing: 21 spot moves x 3 vol shifts over the sample chain
+    OptionPricer pricer(parseOptionChain(chains), {.threads = 1});
+    std::vector<Scenario> grid;
+    for (int move = -10; move <= 10; ++move) {
+        for (double vol : {-5.0, 0.0, 5.0}) {
+            grid.push_back({.spotMove = move / 100.0, .volPoints = vol});
+        }
+    }
+    run("optionPricer_grid", 0, [&] { keep(pricer.price(grid)); });
+    run("optionPricer_impliedVolatility", 0, [&] { keep(pricer.impliedVolatility(pricer.price().price)); });
+
+    // Streaming over loopback to the local mock: one quote from publish to
+    // pop, and a 100-quote frame decoded into the queue
+    MockStreamer mock({.heartbeat = std::chrono::milliseconds{0}});
+    Streamer streamer(mock.info(), [] { return string("token"); });
+    std::vector<LevelOneQuote> frame(100);
+    std::vector<string> symbols;
+    for (std::size_t i = 0; i < frame.size(); ++i) {
+        symbols.push_back("SYM" + std::to_string(i));
+        frame[i].symbol.assign(symbols.back());
+        for (auto field : {LevelOneField::Bid, LevelOneField::Ask, LevelOneField::Last, LevelOneField::QuoteTime}) {
+            frame[i].present |= std::uint64_t{1} << static_cast<unsigned>(field);
+        }
+        frame[i].bid = 101.25;
+        frame[i].ask = 101.5;
+        frame[i].last = 101.37;
+        frame[i].quoteTime = 1700000000123;
+    }
+    streamer.subscribe(StreamService::LevelOneEquities, symbols);
+    streamer.start();
+    if (mock.waitForSubscriptions(StreamService::LevelOneEquities, symbols.size(), std::chrono::seconds{5})) {
+        StreamRecord record;
+        run("streamer_roundtrip", 0, [&] {
+            mock.publish(std::span<const LevelOneQuote>(frame.data(), 1));
+            while (!streamer.queue().pop(record)) { }
+        });
+        run("streamer_frame_100quotes", 0, [&] {
+            mock.publish(frame);
+            std::size_t received = 0;
+            while (received < frame.size()) {
+                received += streamer.queue().drain([](const StreamRecord& r) { keep(r); });
+            }
+        });
+    }
+    streamer.stop();
+
+    curl_global_cleanup();
+    return 0;
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "candle_store.hpp"
+#include "candles.hpp"
+#include "rate_limiter.hpp"
+
+class Client;
+
+/*--------------------------------------------------------------*/
+/*      A history backfill: every symbol over [start, end] at   */
+/*      one frequency, fetched in windows short enough for one  */
+/*      priceHistory request each                               */
+/*--------------------------------------------------------------*/
+struct BackfillJob {
+    std::vector<std::string> symbols;
+    long long start = 0;                    // epoch ms, inclusive
+    long long end = 0;
+    std::string frequencyType = "minute";   // minute, daily, weekly, monthly
+    int frequency = 1;
+
+    // Span of one request; zero picks 10 days for minute candles and
+    // 20 years otherwise
+    std::chrono::milliseconds window{0};
+
+    // Extra priceHistory params sent with every window, e.g.
+    // {"needExtendedHoursData", "true"}
+    std::map<std::string, std::string> params;
+};
+
+// One request of a job: candles of symbol with start <= datetime <= end
+struct BackfillWindow {
+    std::string symbol;
+    std::string series;                     // candleSeries(params), e.g. "minute1-day"
+    long long start = 0;
+    long long end = 0;
+    std::map<std::string, std::string> params;     // the priceHistory request
+};
+
+// Splits job into consecutive windows, symbol by symbol, oldest first
+std::vector<BackfillWindow> planBackfill(const BackfillJob& job);
+
+// Sorts candles by datetime, drops those outside [start, end] and keeps the
+// last of any repeated datetime. Returns the number of candles dropped
+std::size_t mergeCandles(Candles& candles, long long start, long long end);
+
+/*--------------------------------------------------------------*/
+/*      Where a backfill's candles go. Calls are serialized     */
+/*      and, per symbol, come in window order. A window may be  */
+/*      written again after a crash that came between its       */
+/*      write and its checkpoint                                */
+/*--------------------------------------------------------------*/
+class BackfillSink {
+    public:
+        virtual ~BackfillSink() = default;
+        virtual void write(const BackfillWindow& window, const Candles& candles) = 0;
+};
+
+// Appends each window to a CandleStore, which drops repeats on read
+class CandleStoreSink : public BackfillSink {
+    public:
+        explicit CandleStoreSink(CandleStore& store) : store_{store} { }
+        void write(const BackfillWindow& window, const Candles& candles) override;
+
+    private:
+        // members
+        CandleStore& store_;
+};
+
+/*--------------------------------------------------------------*/
+/*      Append-only record of the windows already written, so   */
+/*      a rerun of an interrupted job skips them. One line per  */
+/*      window, synced before the next is started; a torn last  */
+/*      line is ignored                                         */
+/*--------------------------------------------------------------*/
+class BackfillJournal {
+    public:
+        // Throws std::runtime_error if path cannot be opened
+        explicit BackfillJournal(const std::string& path);
+        ~BackfillJournal();
+
+        BackfillJournal(const BackfillJournal&) = delete;
+        BackfillJournal& operator=(const BackfillJournal&) = delete;
+
+        bool done(const BackfillWindow& window) const;
+        void markDone(const BackfillWindow& window);
+
+        std::size_t size() const;
+        const std::string& path() const { return path_; }
+
+    private:
+        static std::string key(const BackfillWindow& window);
+
+        // members
+        std::string path_;
+        int fd_ = -1;
+        mutable std::mutex mutex_;
+        std::unordered_set<std::string> done_;
+};
+
+struct BackfillConfig {
+    std::size_t maxInFlight = 4;            // fetcher threads
+    double requestsPerSecond = 1.5;         // the job's own budget, under the client's; <= 0 for none
+    double burst = 4;
+    Priority priority = Priority::Low;
+    std::string journalPath;                // "" runs without checkpoints
+};
+
+struct BackfillStats {
+    std::uint64_t windows = 0;              // planned
+    std::uint64_t resumed = 0;              // skipped, already in the journal
+    std::uint64_t fetched = 0;
+    std::uint64_t failed = 0;               // left for the next run
+    std::uint64_t written = 0;              // windows handed to the sink
+    std::uint64_t candles = 0;              // candles handed to the sink
+    std::uint64_t duplicates = 0;           // dropped by the merge
+};
+
+/*--------------------------------------------------------------*/
+/*      Runs a backfill: the planned windows are fetched by a   */
+/*      pool of threads within a request budget, merged, and    */
+/*      written to the sink in order per symbol, each window    */
+/*      checkpointed once written. Failed windows are logged    */
+/*      and left out of the journal for the next run            */
+/*--------------------------------------------------------------*/
+class Backfill {
+    public:
+        Backfill(Client& client, BackfillSink& sink, BackfillConfig config = {});
+
+        Backfill(const Backfill&) = delete;
+        Backfill& operator=(const Backfill&) = delete;
+
+        // Blocks until every window is written or failed, or cancel()
+        BackfillStats run(const BackfillJob& job);
+
+        // Thread-safe. Windows in flight finish; the rest wait for a rerun
+        void cancel() { cancelled_ = true; }
+
+        // Progress of the current or last run
+        BackfillStats stats() const;
+
+    private:
+        struct Run;
+        enum class Outcome { Resumed, Fetched, Failed };
+
+        void fetchWindows(Run& run);
+        void resolve(Run& run, std::size_t index, Outcome outcome, Candles&& candles = Candles{},
+                     std::size_t duplicates = 0);
+
+        // members
+        Client& client_;
+        BackfillSink& sink_;
+        const BackfillConfig config_;
+        RateLimiter budget_;
+        std::atomic<bool> cancelled_{false};
+
+        mutable std::mutex mutex_;          // guards stats_ and a run's merge state
+        BackfillStats stats_;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <map>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "candles.hpp"
+
+/*--------------------------------------------------------------*/
+/*      A local store of price history. One append-only file    */
+/*      per symbol and frequency, read through mmap. Each       */
+/*      fetched window is appended as a columnar block that     */
+/*      also records which time range it covers                 */
+/*--------------------------------------------------------------*/
+class CandleStore {
+    public:
+        // Closed range of epoch ms
+        using Range = std::pair<long long, long long>;
+
+        explicit CandleStore(const std::string& directory);
+
+        // Candles with start <= datetime <= end, sorted, without duplicates
+        Candles read(
+            const std::string& symbol,
+            const std::string& frequency,
+            long long start,
+            long long end,
+            std::pmr::memory_resource* mr = std::pmr::get_default_resource()
+        ) const;
+
+        // Parts of [start, end] no block covers yet
+        std::vector<Range> gaps(
+            const std::string& symbol,
+            const std::string& frequency,
+            long long start,
+            long long end
+        ) const;
+
+        // Records [start, end] as covered, along with the candles fetched for it
+        void append(
+            const std::string& symbol,
+            const std::string& frequency,
+            long long start,
+            long long end,
+            const Candles& candles
+        );
+
+        const std::string& directory() const { return directory_; }
+
+    private:
+        std::string path(const std::string& symbol, const std::string& frequency) const;
+        std::vector<Range> coverage(const std::string& file) const;
+
+        std::string directory_;
+        mutable std::mutex mutex_;    // serializes appends against reads
+};
+
+// Series name of a priceHistory request: frequencyType and frequency, then
+// periodType and "ext" when extended hours are asked for, since each gives
+// different candles, e.g. "minute1-day-ext"
+std::string candleSeries(const std::map<std::string, std::string>& params);
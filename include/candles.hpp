@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*--------------------------------------------------------------*/
+/*      Price history candles stored column by column so        */
+/*      analytics can scan contiguous arrays. Columns come      */
+/*      from the given memory resource, e.g. an arena           */
+/*--------------------------------------------------------------*/
+struct Candles {
+    explicit Candles(std::pmr::memory_resource* mr = std::pmr::get_default_resource())
+        : datetime{mr}, open{mr}, high{mr}, low{mr}, close{mr}, volume{mr} { }
+
+    std::string symbol;
+    bool empty = true;      // "empty" flag from the response
+
+    std::pmr::vector<long long> datetime;   // epoch ms
+    std::pmr::vector<double> open;
+    std::pmr::vector<double> high;
+    std::pmr::vector<double> low;
+    std::pmr::vector<double> close;
+    std::pmr::vector<long long> volume;
+
+    std::size_t size() const { return datetime.size(); }
+    void reserve(std::size_t n);
+    void clear();
+    void push_back(long long dt, double o, double h, double l, double c, long long v);
+    void pop_back();
+};
+
+// Parses a pricehistory response body straight into columns, without a json DOM
+Candles parseCandles(std::string_view body,
+                     std::pmr::memory_resource* mr = std::pmr::get_default_resource());
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <curl/curl.h>
+
+/*--------------------------------------------------------------*/
+/*      A bounded pool of keep-alive libcurl easy handles       */
+/*      sharing one DNS and TLS session cache. Handles are      */
+/*      checked out per request and returned on release. Each   */
+/*      handle carries a response buffer that is reused from    */
+/*      one request to the next                                 */
+/*--------------------------------------------------------------*/
+class ConnectionPool {
+    public:
+        /*
+         * RAII handle checked out of the pool. Returns the handle
+         * to the pool when it goes out of scope.
+         */
+        class Lease {
+            public:
+                Lease(ConnectionPool* pool, CURL* curl) : pool_{pool}, curl_{curl} { }
+                Lease(Lease&& other) noexcept;
+                Lease& operator=(Lease&& other) noexcept;
+                Lease(const Lease&) = delete;
+                Lease& operator=(const Lease&) = delete;
+                ~Lease();
+
+                CURL* get() const { return curl_; }
+
+            private:
+                ConnectionPool* pool_;
+                CURL* curl_;
+        };
+
+        explicit ConnectionPool(std::size_t capacity = 4);
+        ~ConnectionPool();
+
+        ConnectionPool(const ConnectionPool&) = delete;
+        ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+        // Blocks until a handle is free when all capacity_ handles are in use
+        Lease acquire();
+
+        // As acquire, but an empty lease (get() == nullptr) instead of waiting
+        Lease tryAcquire();
+
+        std::size_t capacity() const { return capacity_; }
+        std::size_t idle() const;
+
+        // Handles outside the pool's capacity (e.g. the request loop's) that
+        // still share its caches and carry a response buffer
+        CURL* createHandle();
+        void resetHandle(CURL* curl);       // clears options, keeps connection and buffer
+        static void destroyHandle(CURL* curl);
+
+        // The handle's reusable response buffer, and a CURLOPT_WRITEFUNCTION
+        // filling it (CURLOPT_WRITEDATA = the handle). The buffer is sized from
+        // Content-Length when the first chunk arrives
+        static std::string& responseBuffer(CURL* curl);
+        static size_t writeToBuffer(char* data, size_t size, size_t nmemb, void* curl);
+
+    private:
+        Lease checkout(std::unique_lock<std::mutex>& lock);
+        void configure(CURL* curl);
+        void release(CURL* curl);
+
+        // CURLSH lock callbacks
+        static void lockShare(CURL* curl, curl_lock_data data, curl_lock_access access, void* userptr);
+        static void unlockShare(CURL* curl, curl_lock_data data, void* userptr);
+
+        // members
+        const std::size_t capacity_;
+        CURLSH* share_ = nullptr;
+        std::mutex shareLocks_[CURL_LOCK_DATA_LAST];
+
+        mutable std::mutex mutex_;
+        std::condition_variable available_;
+        std::vector<CURL*> idle_;
+        std::size_t created_ = 0;
+
+        // Larger buffers are freed on reset rather than kept for the next request
+        static constexpr std::size_t maxRetainedBuffer_ = 16 << 20;
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+
+/*--------------------------------------------------------------*/
+/*      Fixed-format date and time conversion to and from       */
+/*      epoch milliseconds, UTC. Whole columns convert in one   */
+/*      call; bad elements are marked instead of throwing       */
+/*--------------------------------------------------------------*/
+enum class DateFormat : std::uint8_t {
+    Date,           // dd-mm-yyyy
+    DateTime,       // dd-mm-yyyy HH:MM:SS
+    IsoDate,        // yyyy-mm-dd
+    IsoDateTime     // yyyy-mm-ddTHH:MM:SS.sssZ
+};
+
+// Marks an element that failed to parse or format
+inline constexpr long long invalidEpoch = std::numeric_limits<long long>::min();
+
+// Characters per formatted value
+constexpr std::size_t dateFormatWidth(DateFormat format) {
+    switch (format) {
+        case DateFormat::Date:        return 10;
+        case DateFormat::DateTime:    return 19;
+        case DateFormat::IsoDate:     return 10;
+        case DateFormat::IsoDateTime: return 24;
+    }
+    return 0;
+}
+
+/*------------------------------*/
+/*      Calendar math           */
+/*------------------------------*/
+/*
+ * Days from 1970-01-01 to a proleptic Gregorian date, and back
+ * (H. Hinnant's civil calendar algorithms).
+ */
+constexpr std::int64_t daysFromCivil(std::int64_t year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    std::int64_t era = (year >= 0 ? year : year - 399) / 400;
+    auto yearOfEra = static_cast<unsigned>(year - era * 400);
+    unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + static_cast<std::int64_t>(dayOfEra) - 719468;
+}
+
+struct CivilDate {
+    std::int64_t year;
+    unsigned month;
+    unsigned day;
+};
+
+constexpr CivilDate civilFromDays(std::int64_t days) {
+    days += 719468;
+    std::int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    auto dayOfEra = static_cast<unsigned>(days - era * 146097);
+    unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    unsigned mp = (5 * dayOfYear + 2) / 153;
+    unsigned month = mp < 10 ? mp + 3 : mp - 9;
+    return {static_cast<std::int64_t>(yearOfEra) + era * 400 + (month <= 2),
+            month, dayOfYear - (153 * mp + 2) / 5 + 1};
+}
+
+constexpr bool isLeapYear(std::int64_t year) {
+    return year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+}
+
+constexpr unsigned daysInMonth(std::int64_t year, unsigned month) {
+    constexpr unsigned days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    return month == 2 && isLeapYear(year) ? 29 : days[month - 1];
+}
+
+/*------------------------------*/
+/*      Parsing                 */
+/*------------------------------*/
+/*
+ * @brief Parses text strictly in the given format: exact length, digits
+ * and separators in place, and a real calendar date and time of day.
+ * Returns invalidEpoch on any mismatch.
+ */
+long long parseEpochMs(std::string_view text, DateFormat format);
+
+/*
+ * @brief Parses texts[i] into epochMs[i] for every element and returns
+ * how many failed; those are set to invalidEpoch. epochMs must be at
+ * least as long as texts.
+ */
+std::size_t parseEpochMs(std::span<const std::string_view> texts, std::span<long long> epochMs, DateFormat format);
+std::size_t parseEpochMs(std::span<const std::string> texts, std::span<long long> epochMs, DateFormat format);
+
+/*------------------------------*/
+/*      Formatting              */
+/*------------------------------*/
+/*
+ * @brief Formats one value. Returns "" for a year outside 0000-9999 or
+ * invalidEpoch.
+ */
+std::string formatEpochMs(long long epochMs, DateFormat format);
+
+/*
+ * @brief Formats epochMs[i] into out at offset i * dateFormatWidth(format),
+ * without separators or terminators, and returns how many failed; those
+ * are filled with '?'. out must hold epochMs.size() * dateFormatWidth(format)
+ * characters.
+ */
+std::size_t formatEpochMs(std::span<const long long> epochMs, std::span<char> out, DateFormat format);
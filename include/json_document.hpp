@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json_push_parser.hpp"
+
+enum class JsonType : std::uint8_t { Null, Boolean, Number, String, Array, Object };
+
+struct JsonMember;
+
+/*--------------------------------------------------------------*/
+/*      One parsed value. Arrays and objects point to their     */
+/*      children laid out contiguously in the document's arena  */
+/*--------------------------------------------------------------*/
+struct JsonNode {
+    JsonType type = JsonType::Null;
+    std::uint32_t size = 0;             // string bytes, array elements or object members
+    union {
+        double number = 0;
+        bool boolean;
+        const char* text;
+        const JsonNode* elements;
+        const JsonMember* members;
+    };
+};
+
+struct JsonMember {
+    std::string_view key;
+    JsonNode value;
+};
+
+/*--------------------------------------------------------------*/
+/*      Read-only view of a JsonNode with typed accessors.      */
+/*      Lookups that miss, and reads of the wrong type, give    */
+/*      null or the fallback instead of throwing. Valid until   */
+/*      the document is parsed again or cleared                 */
+/*--------------------------------------------------------------*/
+class JsonValue {
+    public:
+        JsonValue() = default;
+        JsonValue(const JsonNode& node) : node_{&node} { }
+
+        JsonType type() const { return node_->type; }
+        bool isNull() const { return type() == JsonType::Null; }
+        bool isBoolean() const { return type() == JsonType::Boolean; }
+        bool isNumber() const { return type() == JsonType::Number; }
+        bool isString() const { return type() == JsonType::String; }
+        bool isArray() const { return type() == JsonType::Array; }
+        bool isObject() const { return type() == JsonType::Object; }
+
+        // Members of an object or elements of an array; 0 otherwise
+        std::size_t size() const { return isArray() || isObject() ? node_->size : 0; }
+
+        // Object member by key (first match), array element by index
+        JsonValue operator[](std::string_view key) const;
+        JsonValue operator[](std::size_t index) const;
+        bool contains(std::string_view key) const { return !(*this)[key].isNull(); }
+
+        double number(double fallback = 0) const { return isNumber() ? node_->number : fallback; }
+        long long integer(long long fallback = 0) const {
+            return isNumber() ? static_cast<long long>(node_->number) : fallback;
+        }
+        bool boolean(bool fallback = false) const { return isBoolean() ? node_->boolean : fallback; }
+        std::string_view string(std::string_view fallback = {}) const {
+            return isString() ? std::string_view(node_->text, node_->size) : fallback;
+        }
+
+        std::span<const JsonMember> members() const {
+            return isObject() ? std::span<const JsonMember>(node_->members, node_->size) : std::span<const JsonMember>();
+        }
+        std::span<const JsonNode> elements() const {
+            return isArray() ? std::span<const JsonNode>(node_->elements, node_->size) : std::span<const JsonNode>();
+        }
+
+    private:
+        static const JsonNode null_;
+        const JsonNode* node_ = &null_;
+};
+
+/*--------------------------------------------------------------*/
+/*      A JSON document meant to be parsed again and again,     */
+/*      e.g. once per poll. Nodes go into a monotonic arena     */
+/*      that is reset, not freed, between parses and grown to   */
+/*      the largest document seen. Strings without escapes are  */
+/*      views into the parsed text rather than copies, so the   */
+/*      text must stay unchanged until the next parse           */
+/*--------------------------------------------------------------*/
+class JsonDocument : private JsonHandler {
+    public:
+        explicit JsonDocument(std::size_t arenaBytes = 64 << 10);
+
+        JsonDocument(const JsonDocument&) = delete;
+        JsonDocument& operator=(const JsonDocument&) = delete;
+
+        /*
+         * Replaces the document with text. Throws std::runtime_error on
+         * malformed JSON, leaving the document null. An empty text, as
+         * an invalid or timed-out request returns, gives null.
+         */
+        JsonValue parse(std::string_view text);
+        JsonValue root() const { return JsonValue(root_); }
+        void clear();
+
+        // A response buffer kept with the document, for the Client calls
+        // that write into a std::pmr::string:
+        //     doc.parse(client.quotes("AAPL", "quote", doc.buffer()));
+        std::pmr::string& buffer() { return buffer_; }
+
+        // Bytes the arena holds, counting what it had to add for the
+        // last document
+        std::size_t arenaBytes() const { return block_.size() + upstream_.bytes; }
+
+    private:
+        // Upstream for the arena that counts what it hands out, so the
+        // first block can be grown to fit on the next clear()
+        class CountingResource : public std::pmr::memory_resource {
+            public:
+                std::size_t bytes = 0;
+
+            private:
+                void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+                void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+                bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+                    return this == &other;
+                }
+        };
+
+        // JsonHandler
+        void startObject() override;
+        void endObject() override;
+        void startArray() override;
+        void endArray() override;
+        void key(std::string_view name) override;
+        void string(std::string_view value) override;
+        void number(double value) override;
+        void boolean(bool value) override;
+        void null() override;
+
+        void push(const JsonNode& node);
+        void close();
+        std::string_view keep(std::string_view text);
+
+        // members
+        std::vector<std::byte> block_;
+        CountingResource upstream_;
+        std::optional<std::pmr::monotonic_buffer_resource> arena_;
+        JsonPushParser parser_{*this};
+
+        std::string_view source_;           // the text being parsed
+        std::string_view key_;              // key of the next value
+        std::vector<JsonMember> stack_;     // values of the open containers, in order
+        std::vector<std::size_t> open_;     // stack_ index of each open container
+        JsonNode root_;
+
+        std::pmr::string buffer_;
+};
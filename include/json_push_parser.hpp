@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*--------------------------------------------------------------*/
+/*      Receives SAX events from JsonPushParser. Views are      */
+/*      only valid for the duration of the call                 */
+/*--------------------------------------------------------------*/
+class JsonHandler {
+    public:
+        virtual ~JsonHandler() = default;
+
+        virtual void startObject() { }
+        virtual void endObject() { }
+        virtual void startArray() { }
+        virtual void endArray() { }
+        virtual void key(std::string_view) { }
+        virtual void string(std::string_view) { }
+        virtual void number(double) { }
+        virtual void boolean(bool) { }
+        virtual void null() { }
+};
+
+/*--------------------------------------------------------------*/
+/*      An incremental JSON parser. Input can be fed in chunks  */
+/*      of any size as it arrives (e.g. from a curl write       */
+/*      callback); events fire as soon as each token is done    */
+/*--------------------------------------------------------------*/
+class JsonPushParser {
+    public:
+        explicit JsonPushParser(JsonHandler& handler) : handler_{handler} { }
+
+        // Throws std::runtime_error on malformed input
+        void feed(const char* data, std::size_t size);
+        void feed(std::string_view chunk) { feed(chunk.data(), chunk.size()); }
+
+        // Checks the document is complete; throws if it was cut short
+        void finish();
+
+        // Ready for a new document; keeps buffer capacity
+        void reset();
+
+        std::size_t bytesConsumed() const { return consumed_; }
+
+    private:
+        enum class State : std::uint8_t {
+            Value,          // expecting a value
+            AfterValue,     // expecting ',' or a closing bracket
+            Key,            // expecting a key or '}'
+            Colon,          // expecting ':'
+            String,         // inside a string
+            Escape,         // after '\' inside a string
+            Unicode,        // inside \uXXXX
+            Number,
+            Literal,        // true / false / null
+            Done
+        };
+
+        void valueDone();
+        void emitString(std::string_view text);
+        void emitNumber();
+        void emitLiteral();
+        void appendUtf8(std::uint32_t codepoint);
+        [[noreturn]] void fail(const char* what) const;
+
+        // members
+        JsonHandler& handler_;
+        State state_ = State::Value;
+        bool stringIsKey_ = false;
+        bool allowClose_ = false;       // just opened, so '}' / ']' may follow
+        std::vector<bool> stack_;       // true = object, false = array
+        std::string scratch_;           // token text split across chunks / unescaped
+        std::uint32_t unicode_ = 0;
+        std::uint32_t highSurrogate_ = 0;
+        int unicodeDigits_ = 0;
+        std::size_t consumed_ = 0;
+};
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+enum class LogLevel : std::uint8_t { Trace, Debug, Info, Warn, Error, Off };
+
+// Verbosity is set per component
+enum class LogComponent : std::uint8_t { Client, Http, Tokens, Loop, Storage, Stream, Count };
+
+const char* logLevelName(LogLevel level);
+const char* logComponentName(LogComponent component);
+
+/*--------------------------------------------------------------*/
+/*      One log line as handed to the sink. message points      */
+/*      into the ring and is only valid during the call         */
+/*--------------------------------------------------------------*/
+struct LogRecord {
+    std::chrono::system_clock::time_point time;
+    LogLevel level;
+    LogComponent component;
+    std::string_view message;
+};
+
+// Called on the logger thread, one record at a time
+using LogSink = std::function<void(const LogRecord&)>;
+
+/*--------------------------------------------------------------*/
+/*      Process-wide asynchronous logger. Callers format into   */
+/*      a slot of a lock-free ring and return; a background     */
+/*      thread drains the ring into the sink. A disabled level  */
+/*      costs one relaxed load, and a full ring drops the line  */
+/*      rather than block the caller                            */
+/*--------------------------------------------------------------*/
+class Logger {
+    public:
+        static constexpr std::size_t slotCount = 1024;
+        static constexpr std::size_t maxMessage = 500;     // longer lines are truncated
+
+        static Logger& instance();
+
+        bool enabled(LogComponent component, LogLevel level) const {
+            return level >= levels_[static_cast<std::size_t>(component)].load(std::memory_order_relaxed);
+        }
+        void setLevel(LogComponent component, LogLevel level);
+        void setLevel(LogLevel level);       // every component
+        LogLevel level(LogComponent component) const;
+
+        // Replaces the sink; the default writes formatted lines to stderr
+        void setSink(LogSink sink);
+
+        // Formats the arguments (strings, numbers, chars) back to back
+        template <typename... Args>
+        void log(LogComponent component, LogLevel level, const Args&... args) {
+            if (!enabled(component, level)) {
+                return;
+            }
+            Line line;
+            (line.append(args), ...);
+            write(component, level, line.view());
+        }
+        void write(LogComponent component, LogLevel level, std::string_view message);
+
+        // Blocks until everything logged so far has reached the sink
+        void flush();
+
+        // Lines lost to a full ring
+        std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+        // "2026-01-02T15:04:05.123Z INFO  tokens: message"
+        static std::string format(const LogRecord& record);
+
+    private:
+        Logger();
+        ~Logger() = default;     // never destroyed; stop() runs at exit
+        void stop();
+        void run();
+        bool drain();            // true if anything was written
+
+        // Fixed-size formatting buffer, so logging never allocates
+        class Line {
+            public:
+                void append(std::string_view text);
+                void append(const char* text) { append(std::string_view(text ? text : "(null)")); }
+                void append(const std::string& text) { append(std::string_view(text)); }
+                void append(char c) { append(std::string_view(&c, 1)); }
+                void append(bool value) { append(std::string_view(value ? "true" : "false")); }
+                template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+                void append(T value) {
+                    auto [end, ec] = std::to_chars(data_ + size_, data_ + maxMessage, value);
+                    if (ec == std::errc()) {
+                        size_ = static_cast<std::size_t>(end - data_);
+                    }
+                }
+                std::string_view view() const { return {data_, size_}; }
+
+            private:
+                char data_[maxMessage];
+                std::size_t size_ = 0;
+        };
+
+        // Bounded multi-producer ring (Vyukov); sequence says whose turn a slot is
+        struct Slot {
+            std::atomic<std::size_t> sequence{0};
+            std::chrono::system_clock::time_point time;
+            LogLevel level;
+            LogComponent component;
+            std::uint16_t size;
+            char message[maxMessage];
+        };
+
+        // members
+        std::array<std::atomic<LogLevel>, static_cast<std::size_t>(LogComponent::Count)> levels_;
+        std::unique_ptr<Slot[]> slots_;
+        alignas(64) std::atomic<std::size_t> enqueuePos_{0};
+        alignas(64) std::atomic<std::size_t> dequeuePos_{0};    // logger thread only writes
+        std::atomic<std::uint64_t> dropped_{0};
+        std::atomic<bool> sleeping_{false};
+        std::atomic<bool> running_{true};
+
+        std::mutex sinkMutex_;      // guards sink_ swaps and writes after stop()
+        LogSink sink_;
+        std::thread thread_;
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <curl/curl.h>
+
+/*--------------------------------------------------------------*/
+/*      Snapshot of one histogram. Percentiles are accurate     */
+/*      to the bucket width, about 3% of the value              */
+/*--------------------------------------------------------------*/
+struct HistogramSnapshot {
+    std::uint64_t count = 0;
+    std::uint64_t sumUs = 0;
+    std::uint64_t maxUs = 0;
+    std::vector<std::uint64_t> buckets;
+
+    double percentileUs(double q) const;     // q in [0, 1]
+    double meanUs() const { return count ? static_cast<double>(sumUs) / count : 0.0; }
+};
+
+/*--------------------------------------------------------------*/
+/*      HDR-style latency histogram in microseconds. Buckets    */
+/*      are log-linear: 32 per power of two. Recording is a     */
+/*      few relaxed atomic adds and never blocks                */
+/*--------------------------------------------------------------*/
+class LatencyHistogram {
+    public:
+        static constexpr int subBits = 5;
+        static constexpr int maxBits = 32;          // values clamp at 2^32 us, ~71 min
+        static constexpr std::size_t bucketCount = (maxBits - subBits + 1) << subBits;
+
+        void record(std::uint64_t us);
+        void record(std::chrono::steady_clock::duration elapsed) {
+            record(static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+        }
+        HistogramSnapshot snapshot() const;
+
+        static std::size_t bucketOf(std::uint64_t us);
+        static std::uint64_t bucketUpper(std::size_t bucket);   // exclusive
+
+    private:
+        std::array<std::atomic<std::uint64_t>, bucketCount> buckets_{};
+        std::atomic<std::uint64_t> sum_{0};
+        std::atomic<std::uint64_t> max_{0};
+};
+
+/*--------------------------------------------------------------*/
+/*      Counters and phase timings for one API endpoint         */
+/*--------------------------------------------------------------*/
+struct EndpointSnapshot {
+    std::string endpoint;
+    std::uint64_t requests = 0, errors = 0, status429 = 0, retries = 0;
+    std::uint64_t coalesced = 0;    // calls that shared an identical request in flight
+    std::uint64_t errorRetries = 0, hedges = 0, hedgeWins = 0, deadlineExceeded = 0;
+    std::uint64_t bytesIn = 0, bytesOut = 0, connectionsOpened = 0;
+
+    // dns, connect, tls: new connections only.
+    // server: request sent to first byte; transfer: first byte to done
+    HistogramSnapshot dns, connect, tls, server, transfer, total, parse;
+};
+
+class EndpointMetrics {
+    public:
+        explicit EndpointMetrics(const char* name) : name_{name} { }
+
+        // Reads the timings of a finished transfer from its handle
+        void record(CURL* curl, CURLcode rc, long status);
+        void retried() { retries_.fetch_add(1, std::memory_order_relaxed); }
+        void coalesced() { coalesced_.fetch_add(1, std::memory_order_relaxed); }
+        void errorRetried() { errorRetries_.fetch_add(1, std::memory_order_relaxed); }
+        void hedged() { hedges_.fetch_add(1, std::memory_order_relaxed); }
+        void hedgeWon() { hedgeWins_.fetch_add(1, std::memory_order_relaxed); }
+        void deadlineExceeded() { deadlineExceeded_.fetch_add(1, std::memory_order_relaxed); }
+
+        const char* name() const { return name_; }
+        LatencyHistogram& parse() { return parse_; }
+        const LatencyHistogram& total() const { return total_; }
+        EndpointSnapshot snapshot() const;
+
+    private:
+        const char* name_;
+        std::atomic<std::uint64_t> requests_{0}, errors_{0}, status429_{0}, retries_{0}, coalesced_{0};
+        std::atomic<std::uint64_t> errorRetries_{0}, hedges_{0}, hedgeWins_{0}, deadlineExceeded_{0};
+        std::atomic<std::uint64_t> bytesIn_{0}, bytesOut_{0}, connectionsOpened_{0};
+        LatencyHistogram dns_, connect_, tls_, server_, transfer_, total_, parse_;
+};
+
+/*--------------------------------------------------------------*/
+/*      All client metrics. Endpoints are fixed up front, so    */
+/*      lookups and updates take no locks                       */
+/*--------------------------------------------------------------*/
+struct MetricsSnapshot {
+    std::vector<EndpointSnapshot> endpoints;
+    std::uint64_t tokenRefreshes = 0;
+    std::uint64_t tokenRefreshFailures = 0;
+    HistogramSnapshot tokenRefresh;
+};
+
+class Metrics {
+    public:
+        Metrics();
+
+        // Endpoint for a request URL, e.g. ".../marketdata/v1/chains?..." -> "chains"
+        EndpointMetrics& endpoint(std::string_view url);
+
+        void tokenRefreshed(std::chrono::steady_clock::duration elapsed, bool ok);
+
+        MetricsSnapshot snapshot() const;
+
+        // Prometheus text exposition format
+        std::string prometheus() const;
+
+    private:
+        std::deque<EndpointMetrics> endpoints_;     // fixed after construction
+        std::atomic<std::uint64_t> tokenRefreshes_{0}, tokenRefreshFailures_{0};
+        LatencyHistogram tokenRefresh_;
+};
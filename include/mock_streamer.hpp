@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "streamer.hpp"
+
+enum class WsOpcode : std::uint8_t;
+class WsReader;
+
+struct MockStreamerConfig {
+    std::uint16_t port = 0;                         // 0: any free port
+    int loginCode = 0;                              // nonzero rejects every login with this code
+    std::chrono::milliseconds heartbeat{10000};     // notify frames while logged in; 0 disables
+};
+
+/*--------------------------------------------------------------*/
+/*      A local stand-in for the Schwab streamer on 127.0.0.1,  */
+/*      speaking the same WebSocket protocol: it answers        */
+/*      LOGIN / SUBS / ADD / UNSUBS / LOGOUT, tracks the        */
+/*      subscriptions and sends whatever data frames the test   */
+/*      publishes. One client at a time; plain ws://, no TLS    */
+/*--------------------------------------------------------------*/
+class MockStreamer {
+    public:
+        // Throws std::runtime_error if it cannot listen
+        explicit MockStreamer(MockStreamerConfig config = {});
+        ~MockStreamer();
+
+        MockStreamer(const MockStreamer&) = delete;
+        MockStreamer& operator=(const MockStreamer&) = delete;
+
+        std::uint16_t port() const { return port_; }
+
+        // Connection details for a Streamer pointed at this mock
+        StreamerInfo info() const;
+
+        std::size_t logins() const { return logins_.load(); }
+        std::vector<std::string> subscriptions(StreamService service) const;
+
+        // Waits until the client is logged in with at least count symbols of service
+        bool waitForSubscriptions(StreamService service, std::size_t count, std::chrono::milliseconds timeout);
+
+        // Encode updates into one data frame and send it on the caller's
+        // thread. Only set level-one fields are sent, as the server does.
+        // False when no client is logged in
+        bool publish(std::span<const LevelOneQuote> quotes);
+        bool publish(std::span<const ChartBar> bars);
+
+        // Sends frame as one text message
+        bool publishRaw(std::string_view frame);
+
+        // Drops the client's connection, to exercise reconnects
+        void disconnect();
+
+    private:
+        void run();
+        void acceptClient();
+        bool readClient();
+        bool upgrade();
+        void handleRequests(std::string_view text);
+        bool sendFrame(WsOpcode opcode, std::string_view payload);
+        void closeClient();
+
+        // members
+        const MockStreamerConfig config_;
+        int listenFd_ = -1;
+        std::uint16_t port_ = 0;
+        int wakeFds_[2] = {-1, -1};
+
+        std::mutex sendMutex_;                  // guards clientFd_ and writes to it
+        int clientFd_ = -1;
+        std::string inbound_;                   // mock thread only: handshake bytes
+        bool upgraded_ = false;
+        std::unique_ptr<WsReader> reader_;
+
+        mutable std::mutex stateMutex_;
+        std::condition_variable stateChanged_;
+        bool loggedIn_ = false;
+        std::set<std::string> symbols_[2];      // by StreamService
+
+        std::atomic<std::size_t> logins_{0};
+        std::atomic<bool> running_{true};
+        std::thread thread_;
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "json_push_parser.hpp"
+
+/*--------------------------------------------------------------*/
+/*      Strings packed end to end in one buffer and referred    */
+/*      to by id. intern() returns the same id for repeats      */
+/*--------------------------------------------------------------*/
+class StringPool {
+    public:
+        std::uint32_t add(std::string_view text);
+        std::uint32_t intern(std::string_view text);
+
+        std::string_view view(std::uint32_t id) const {
+            return std::string_view(chars_).substr(offsets_[id], offsets_[id + 1] - offsets_[id]);
+        }
+        std::size_t size() const { return offsets_.size() - 1; }
+        void reserve(std::size_t strings, std::size_t chars);
+        void clear();
+
+    private:
+        // Lets interned_ be searched with a string_view
+        struct Hash {
+            using is_transparent = void;
+            std::size_t operator()(std::string_view text) const { return std::hash<std::string_view>{}(text); }
+        };
+
+        std::string chars_;
+        std::vector<std::uint32_t> offsets_{0};
+        std::unordered_map<std::string, std::uint32_t, Hash, std::equal_to<>> interned_;
+};
+
+/*--------------------------------------------------------------*/
+/*      A whole option chain as one flat table. Row i of every  */
+/*      column describes contract i; expiries and contract      */
+/*      symbols are ids into the string pool                    */
+/*--------------------------------------------------------------*/
+struct OptionChainTable {
+    // Underlying
+    std::string symbol;
+    std::string status;
+    double underlyingPrice = 0;
+    double interestRate = 0;
+    double volatility = 0;
+
+    // Contracts
+    std::vector<std::uint32_t> contractSymbol;  // pool id, e.g. "AAPL  240119C00150000"
+    std::vector<std::uint32_t> expiry;          // pool id, "yyyy-mm-dd"
+    std::vector<std::int32_t> daysToExpiration;
+    std::vector<double> strike;
+    std::vector<char> putCall;                  // 'C' or 'P'
+    std::vector<double> bid;
+    std::vector<double> ask;
+    std::vector<double> last;
+    std::vector<double> mark;
+    std::vector<double> impliedVolatility;      // percent, as sent by the server
+    std::vector<double> delta;
+    std::vector<double> gamma;
+    std::vector<double> theta;
+    std::vector<double> vega;
+    std::vector<double> rho;
+    std::vector<std::int64_t> openInterest;
+    std::vector<std::int64_t> totalVolume;
+    std::vector<std::int32_t> multiplier;
+
+    StringPool strings;
+
+    std::size_t size() const { return strike.size(); }
+    std::string_view symbolAt(std::size_t i) const { return strings.view(contractSymbol[i]); }
+    std::string_view expiryAt(std::size_t i) const { return strings.view(expiry[i]); }
+    void reserve(std::size_t contracts);
+    void clear();
+};
+
+/*--------------------------------------------------------------*/
+/*      JsonHandler that fills an OptionChainTable from a       */
+/*      chains response as it is parsed                         */
+/*--------------------------------------------------------------*/
+class OptionChainBuilder : public JsonHandler {
+    public:
+        explicit OptionChainBuilder(OptionChainTable& out) : out_{out} { }
+
+        void startObject() override;
+        void endObject() override;
+        void startArray() override;
+        void endArray() override;
+        void key(std::string_view name) override;
+        void string(std::string_view value) override;
+        void number(double value) override;
+        void boolean(bool) override { }
+        void null() override { }
+
+    private:
+        enum class Field : std::uint8_t {
+            None, Symbol, PutCall, Bid, Ask, Last, Mark, Volatility, Delta, Gamma, Theta,
+            Vega, Rho, OpenInterest, TotalVolume, StrikePrice, DaysToExpiration, Multiplier
+        };
+        static Field contractField(std::string_view name);
+        void setNumber(Field field, double value);
+
+        struct Row {
+            std::uint32_t contractSymbol = 0;
+            std::int32_t daysToExpiration = 0;
+            double strike = 0;
+            char putCall = '?';
+            double bid, ask, last, mark, impliedVolatility, delta, gamma, theta, vega, rho;
+            std::int64_t openInterest = 0, totalVolume = 0;
+            std::int32_t multiplier = 100;
+        };
+
+        OptionChainTable& out_;
+        int depth_ = 0;
+        char side_ = 0;                 // 'C' / 'P' inside an exp date map
+        std::string rootKey_;           // current key at depth 1
+        std::uint32_t expiry_ = 0;
+        std::int32_t expiryDays_ = 0;
+        double mapStrike_ = 0;
+        Field field_ = Field::None;
+        Row row_;
+};
+
+// Parses a complete chains response body
+OptionChainTable parseOptionChain(std::string_view body);
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "option_chain.hpp"
+
+enum class PricingModel : std::uint8_t {
+    BlackScholes,   // spot underlying with a continuous dividend yield
+    Black76         // underlyingPrice is a futures price
+};
+
+/*--------------------------------------------------------------*/
+/*      A what-if applied to a whole chain. Units follow the    */
+/*      chain: vols and rates in percent points                 */
+/*--------------------------------------------------------------*/
+struct Scenario {
+    double spotMove = 0;        // relative: 0.05 prices with the underlying 5% higher
+    double volPoints = 0;       // added to every contract's implied vol
+    double ratePoints = 0;      // added to the chain's interest rate
+    double daysForward = 0;     // calendar days to roll forward
+};
+
+struct PricingConfig {
+    PricingModel model = PricingModel::BlackScholes;
+    double dividendYield = 0;   // percent, continuous; Black-Scholes only
+    double daysPerYear = 365;
+    unsigned threads = 0;       // 0: one per hardware thread
+};
+
+/*--------------------------------------------------------------*/
+/*      Prices and Greeks, one row per contract of the chain    */
+/*      in the chain's order. Conventions match the server's:   */
+/*      theta per day, vega and rho per percent point           */
+/*--------------------------------------------------------------*/
+struct OptionGreeks {
+    std::vector<double> price;
+    std::vector<double> delta;
+    std::vector<double> gamma;
+    std::vector<double> theta;
+    std::vector<double> vega;
+    std::vector<double> rho;
+
+    std::size_t size() const { return price.size(); }
+};
+
+/*--------------------------------------------------------------*/
+/*      European Black-Scholes / Black-76 pricing of a fetched  */
+/*      chain under local scenarios, so what-ifs need no round  */
+/*      trip. Contracts are grouped by expiry and the groups    */
+/*      are priced in parallel over structure-of-arrays inputs  */
+/*--------------------------------------------------------------*/
+class OptionPricer {
+    public:
+        // Copies what it needs from chain. Each contract's vol is the server's
+        // implied vol, or solved from its mark when the server sent none
+        explicit OptionPricer(const OptionChainTable& chain, PricingConfig config = {});
+
+        OptionGreeks price(const Scenario& scenario = {}) const;
+
+        // One result per scenario, priced in one parallel pass
+        std::vector<OptionGreeks> price(std::span<const Scenario> scenarios) const;
+
+        // Implied vols in percent that reproduce prices[i] for contract i; NaN
+        // where the price is outside the no-arbitrage bounds
+        std::vector<double> impliedVolatility(std::span<const double> prices) const;
+
+        // The vols price() starts from, in percent, in chain order
+        std::vector<double> volatility() const;
+        std::size_t size() const { return order_.size(); }
+
+    private:
+        struct Group {
+            std::size_t begin, end;     // range in order_, all one expiry
+        };
+
+        void priceGroup(const Group& group, const Scenario& scenario, OptionGreeks& out) const;
+        void solveGroup(const Group& group, std::span<const double> prices, std::vector<double>& out) const;
+
+        // Runs fn(i) for i in [0, count) across the worker threads; contracts
+        // is the total work, which decides whether threads are worth it
+        template <typename Fn>
+        void parallelFor(std::size_t count, std::size_t contracts, Fn&& fn) const;
+
+        // members
+        PricingConfig config_;
+        double spot_, rate_, dividend_;                 // decimals
+
+        // Inputs sorted by expiry; position j holds chain row order_[j]
+        std::vector<std::size_t> order_;
+        std::vector<double> strike_, logStrike_, days_, sign_;  // sign: +1 call, -1 put
+        std::vector<double> vol_;                       // decimal
+        std::vector<Group> groups_;
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include <nlohmann/json.hpp>
+
+/*--------------------------------------------------------------*/
+/*      Merges the response objects of several quotes batches  */
+/*      into one. Symbol members are spliced in as raw text;    */
+/*      each batch's "errors" member is parsed and combined,    */
+/*      so the result has a single "errors" entry               */
+/*--------------------------------------------------------------*/
+class QuoteBatchMerger {
+    public:
+        // Adds the members of one response object. Returns false, adding
+        // nothing, if body is not a single json object
+        bool add(std::string_view body);
+
+        // The merged object, with "errors" last when any batch had one
+        std::string str() const;
+
+    private:
+        std::string members_;                                   // comma separated, no braces
+        nlohmann::json errors_ = nlohmann::json::object();
+};
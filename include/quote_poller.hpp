@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "streamer.hpp"
+
+class Client;
+
+struct QuotePollerConfig {
+    std::chrono::milliseconds interval{1000};
+    std::size_t maxInFlight = 8;        // batched requests outstanding at once
+};
+
+struct QuotePollerStats {
+    std::uint64_t polls = 0;
+    std::uint64_t failedPolls = 0;
+    std::uint64_t symbolsPolled = 0;    // summed over polls
+    std::uint64_t changed = 0;          // symbols with at least one new field
+    std::uint64_t unchanged = 0;        // symbols polled with nothing new
+    std::uint64_t deliveries = 0;       // records handed to subscribers
+};
+
+/*--------------------------------------------------------------*/
+/*      One quote poller shared by every component of the      */
+/*      process. Interest from all subscribers is merged into   */
+/*      one symbol set that is fetched once per interval, in    */
+/*      as few batched requests as the server's limits allow.   */
+/*      The last snapshot of each symbol is kept, and each      */
+/*      subscriber is sent only what changed in its symbols     */
+/*--------------------------------------------------------------*/
+class QuotePoller {
+    public:
+        using SubscriptionId = std::uint64_t;
+
+        // Called on the polling thread with the subscriber's symbols that
+        // changed. Each record holds the symbol's latest values; present
+        // marks the fields that changed. A new subscriber's first delivery
+        // marks every field the symbol has
+        using DeltaHandler = std::function<void(std::span<const LevelOneQuote> changes)>;
+
+        explicit QuotePoller(Client& client, QuotePollerConfig config = {});
+        ~QuotePoller();     // stops the thread
+
+        QuotePoller(const QuotePoller&) = delete;
+        QuotePoller& operator=(const QuotePoller&) = delete;
+
+        // Thread-safe, also from inside a handler. A handler may still see
+        // one delivery that was under way when it unsubscribed
+        SubscriptionId subscribe(const std::vector<std::string>& symbols, DeltaHandler handler);
+        void unsubscribe(SubscriptionId id);
+
+        // Polls every interval on a background thread
+        void start();
+        void stop();
+
+        // One poll on the calling thread; returns false if the request failed
+        bool pollNow();
+
+        // The last values polled for symbol; false before its first poll
+        bool snapshot(std::string_view symbol, LevelOneQuote& quote) const;
+
+        // Distinct symbols polled each interval
+        std::size_t symbolCount() const;
+        QuotePollerStats stats() const;
+
+    private:
+        struct Subscriber {
+            std::vector<std::uint32_t> rows;
+            DeltaHandler handler;
+            bool fresh = true;          // no delivery yet: send it everything
+        };
+        class ResponseDecoder;
+
+        void run();
+        std::uint32_t rowFor(const std::string& symbol);
+
+        // members
+        Client& client_;
+        const QuotePollerConfig config_;
+
+        // Subscribers and the symbol table, guarded by mutex_. Each symbol
+        // has a row; interest_ counts the subscribers that want it
+        mutable std::mutex mutex_;
+        std::map<SubscriptionId, Subscriber> subscribers_;
+        SubscriptionId nextId_ = 1;
+        std::unordered_map<std::string, std::uint32_t> rowOf_;
+        std::vector<std::string> symbols_;
+        std::vector<std::uint32_t> interest_;
+        std::vector<LevelOneQuote> last_;
+        std::vector<std::uint64_t> changed_;        // this poll's changed fields, by row
+        std::vector<std::string> active_;           // symbols with interest; rebuilt when dirty
+        bool activeDirty_ = false;
+
+        std::mutex pollMutex_;                      // one poll at a time
+        std::mutex waitMutex_;
+        std::condition_variable wakeup_;
+        bool running_ = false;                      // guarded by waitMutex_
+        std::thread thread_;
+
+        std::atomic<std::uint64_t> polls_{0}, failedPolls_{0}, symbolsPolled_{0};
+        std::atomic<std::uint64_t> changedCount_{0}, unchanged_{0}, deliveries_{0};
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <utility>
+
+// Order in which queued requests are let through; High goes first
+enum class Priority { High = 0, Normal = 1, Low = 2 };
+
+/*--------------------------------------------------------------*/
+/*      A token bucket shared by every request a Client makes.  */
+/*      Callers queue by priority, then arrival, and are told   */
+/*      how long they waited                                    */
+/*--------------------------------------------------------------*/
+class RateLimiter {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        struct Stats {
+            std::uint64_t granted[3]{};         // indexed by Priority
+            std::uint64_t delayed[3]{};         // granted after queueing
+            Clock::duration totalWait[3]{};
+            Clock::duration maxWait{};
+            std::size_t queued = 0;             // blocking callers waiting now
+        };
+
+        // Schwab allows 120 market data requests per minute
+        explicit RateLimiter(double perSecond = 2.0, double burst = 20.0);
+
+        // perSecond <= 0 turns limiting off
+        void setRate(double perSecond, double burst);
+
+        // Blocks until a token is free and returns the time spent waiting
+        Clock::duration acquire(Priority priority);
+
+        // As acquire, but gives up at deadline without taking a token and
+        // returns false. Yields to blocking callers of equal or higher
+        // priority, like tryAcquire
+        bool acquireUntil(Priority priority, Clock::time_point deadline);
+
+        // Non-blocking form for the request loop. On refusal, retryIn is
+        // how long to wait before asking again.
+        bool tryAcquire(Priority priority, Clock::time_point queuedSince, Clock::duration& retryIn);
+
+        // Expected wait for a request issued now at this priority
+        Clock::duration estimateWait(Priority priority) const;
+
+        Stats stats() const;
+
+    private:
+        using Ticket = std::pair<int, std::uint64_t>;   // (priority, arrival)
+
+        void refill(Clock::time_point now);
+        Clock::duration untilNextToken() const;
+        void record(Priority priority, Clock::duration waited);
+
+        // members
+        mutable std::mutex mutex_;
+        std::condition_variable changed_;
+        double rate_;
+        double burst_;
+        double tokens_;
+        Clock::time_point last_;
+        std::uint64_t nextTicket_ = 0;
+        std::set<Ticket> waiting_;
+        Stats stats_;
+};
+
+/*--------------------------------------------------------------*/
+/*      Overrides the priority of every request the current     */
+/*      thread makes while in scope, e.g. for a backfill job    */
+/*--------------------------------------------------------------*/
+class PriorityScope {
+    public:
+        explicit PriorityScope(Priority priority);
+        ~PriorityScope();
+
+        PriorityScope(const PriorityScope&) = delete;
+        PriorityScope& operator=(const PriorityScope&) = delete;
+
+        // The innermost scope's priority, or fallback outside any scope
+        static Priority resolve(Priority fallback);
+
+    private:
+        std::optional<Priority> previous_;
+};
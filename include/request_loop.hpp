@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <curl/curl.h>
+
+#include "connection_pool.hpp"
+#include "metrics.hpp"
+#include "rate_limiter.hpp"
+
+/*--------------------------------------------------------------*/
+/*      A curl_multi event loop running on its own thread.      */
+/*      Drives many transfers at once, admitting them through   */
+/*      the rate limiter in priority order, and reports each    */
+/*      one through a completion callback                       */
+/*--------------------------------------------------------------*/
+class RequestLoop {
+    public:
+        // Invoked on the loop thread once the transfer has finished;
+        // status is the HTTP response code (0 if none was received)
+        using Completion = std::function<void(CURLcode rc, long status, std::string&& body)>;
+
+        struct Transfer {
+            CURL* curl = nullptr;               // from checkout(), writing to its responseBuffer
+            std::shared_ptr<struct curl_slist> headers;  // may be shared; held until done
+            Completion done;
+            Priority priority = Priority::Normal;
+            RateLimiter::Clock::time_point queuedAt = RateLimiter::Clock::now();
+            EndpointMetrics* metrics = nullptr;  // timings recorded here when set
+            RateLimiter::Clock::time_point notBefore{};   // held back until then, e.g. a retry's backoff
+            RateLimiter::Clock::time_point deadline = RateLimiter::Clock::time_point::max();   // not sent after
+            std::chrono::seconds retryAfter{0};  // the response's Retry-After, set before done runs
+        };
+
+        RequestLoop(ConnectionPool& pool, RateLimiter& limiter);
+        ~RequestLoop();   // aborts anything still in flight
+
+        RequestLoop(const RequestLoop&) = delete;
+        RequestLoop& operator=(const RequestLoop&) = delete;
+
+        // Handles owned by the loop, configured with the pool's shared caches
+        // and each carrying a reusable response buffer
+        CURL* checkout();
+        void checkin(CURL* curl);
+
+        // Thread-safe; may also be called from inside a completion
+        void submit(std::unique_ptr<Transfer> transfer);
+
+        // Runs task on the loop thread, for completions that need no transfer
+        void post(std::function<void()> task);
+
+        std::size_t inFlight() const { return inFlight_.load(); }
+
+    private:
+        void start();
+        void run();
+        void addPending();
+        void runPosted();
+        long admit();     // returns the poll timeout in ms
+        void finish(CURL* curl, CURLcode rc);
+
+        // members
+        ConnectionPool& pool_;
+        RateLimiter& limiter_;
+        CURLM* multi_ = nullptr;
+
+        std::mutex mutex_;
+        std::vector<std::unique_ptr<Transfer>> pending_;
+        std::vector<std::function<void()>> posted_;
+        std::vector<CURL*> idle_;
+        std::deque<std::unique_ptr<Transfer>> throttled_[3];            // loop thread only, by priority
+        std::unordered_map<CURL*, std::unique_ptr<Transfer>> active_;   // loop thread only
+        std::multimap<RateLimiter::Clock::time_point, std::unique_ptr<Transfer>> delayed_;   // loop thread only
+
+        std::once_flag started_;
+        std::atomic<bool> running_{false};
+        std::atomic<std::size_t> inFlight_{0};
+        std::thread thread_;
+
+        static constexpr std::size_t maxIdleHandles_ = 64;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class MappedFile;
+
+/*--------------------------------------------------------------*/
+/*      An append-only archive of API responses keyed by        */
+/*      request URL. Recording appends one record per           */
+/*      response; replaying maps the file and serves the        */
+/*      recorded responses for each URL in the order they       */
+/*      were recorded                                           */
+/*--------------------------------------------------------------*/
+class ResponseArchive {
+    public:
+        enum class Mode { Record, Replay };
+
+        struct Response {
+            long status;
+            std::string_view body;      // points into the mapped file
+            long long recordedAt;       // epoch ms
+        };
+
+        // Record mode appends to path (creating it); Replay mode maps and
+        // indexes it, throwing if it does not exist
+        ResponseArchive(const std::string& path, Mode mode);
+        ~ResponseArchive();
+
+        ResponseArchive(const ResponseArchive&) = delete;
+        ResponseArchive& operator=(const ResponseArchive&) = delete;
+
+        // Record mode. Thread-safe
+        void append(std::string_view url, long status, std::string_view body);
+
+        // Replay mode. Thread-safe. The next recorded response for url; the
+        // last one repeats once the recording runs out. Empty if the url
+        // was never recorded
+        std::optional<Response> next(std::string_view url);
+
+        // Replay mode. Starts every url over from its first response
+        void rewind();
+
+        Mode mode() const { return mode_; }
+        const std::string& path() const { return path_; }
+        std::size_t size() const { return records_; }     // records in the file
+
+    private:
+        // Offsets of one url's records, in recording order
+        struct Series {
+            std::vector<std::size_t> offsets;
+            std::size_t next = 0;
+        };
+
+        std::string path_;
+        Mode mode_;
+        std::size_t records_ = 0;
+        std::mutex mutex_;
+
+        // Record mode
+        int fd_ = -1;
+
+        // Replay mode
+        std::unique_ptr<MappedFile> mapped_;
+        std::unordered_map<std::string_view, Series> index_;   // keys point into mapped_
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+/*--------------------------------------------------------------*/
+/*      An LRU cache of response bodies keyed by request URL,   */
+/*      with a TTL per endpoint, a memory budget and an         */
+/*      optional on-disk tier that survives restarts            */
+/*--------------------------------------------------------------*/
+class ResponseCache {
+    public:
+        using Clock = std::chrono::system_clock;
+
+        struct Stats {
+            std::uint64_t hits = 0;         // memory + disk
+            std::uint64_t diskHits = 0;
+            std::uint64_t misses = 0;
+            std::uint64_t evictions = 0;
+            std::size_t entries = 0;
+            std::size_t bytes = 0;
+        };
+
+        explicit ResponseCache(std::size_t maxBytes = 16 * 1024 * 1024);
+
+        // A ttl of zero disables caching for that endpoint
+        void setTtl(const std::string& endpoint, std::chrono::seconds ttl);
+        std::chrono::seconds ttl(const std::string& endpoint) const;
+
+        void setMaxBytes(std::size_t maxBytes);
+        void setDiskDirectory(const std::string& directory);   // "" disables the disk tier
+
+        std::optional<std::string> get(const std::string& url);
+        void put(const std::string& endpoint, const std::string& url, const std::string& body);
+        void clear();   // memory tier only
+
+        Stats stats() const;
+
+    private:
+        struct Entry {
+            std::string url;
+            std::string body;
+            Clock::time_point expiresAt;
+        };
+
+        void insert(Entry entry);
+        void evict();
+        std::string diskPath(const std::string& directory, const std::string& url) const;
+        std::optional<Entry> readDisk(const std::string& directory, const std::string& url) const;
+        void writeDisk(const std::string& directory, const Entry& entry) const;
+
+        // members
+        mutable std::mutex mutex_;
+        std::list<Entry> lru_;      // most recently used first
+        std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+        std::map<std::string, std::chrono::seconds> ttls_;
+        std::size_t maxBytes_;
+        std::size_t bytes_ = 0;
+        std::string diskDirectory_;
+        Stats stats_;
+};
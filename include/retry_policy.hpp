@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include <curl/curl.h>
+
+/*--------------------------------------------------------------*/
+/*      When and how often a failed GET is tried again. Every   */
+/*      endpoint the client calls is an idempotent GET, so any  */
+/*      of them may be repeated                                 */
+/*--------------------------------------------------------------*/
+struct RetryPolicy {
+    int maxAttempts = 3;                        // 1 turns retries off
+    std::chrono::milliseconds baseDelay{250};
+    std::chrono::milliseconds maxDelay{8000};
+    bool retryTimeouts = true;
+
+    // 408, 429, 500, 502, 503 and 504 responses, dropped or refused
+    // connections, and timeouts when retryTimeouts is set
+    bool retryable(CURLcode rc, long status) const;
+
+    // Full jitter: uniform in [0, min(maxDelay, baseDelay * 2^(attempt - 1))],
+    // attempt counting from 1
+    std::chrono::milliseconds backoff(int attempt) const;
+};
+
+/*--------------------------------------------------------------*/
+/*      Opt-in hedging: when an attempt is still unanswered at  */
+/*      the endpoint's observed quantile, a duplicate goes out  */
+/*      on another pooled handle and whichever answers first    */
+/*      is kept. A hedge needs a spare handle and a rate        */
+/*      limiter token, and is skipped without them              */
+/*--------------------------------------------------------------*/
+struct HedgePolicy {
+    bool enabled = false;
+    double quantile = 0.95;
+    std::chrono::milliseconds minDelay{50};     // never hedge sooner than this
+    std::uint64_t minSamples = 20;              // requests timed before the quantile is trusted
+};
+
+/*--------------------------------------------------------------*/
+/*      Gives every request the current thread makes while in   */
+/*      scope a deadline, covering retries and backoff. Nested  */
+/*      scopes keep the earlier deadline. Each attempt's        */
+/*      timeout is cut to the time left                         */
+/*--------------------------------------------------------------*/
+class DeadlineScope {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        explicit DeadlineScope(std::chrono::milliseconds budget);
+        explicit DeadlineScope(Clock::time_point deadline);
+        ~DeadlineScope();
+
+        DeadlineScope(const DeadlineScope&) = delete;
+        DeadlineScope& operator=(const DeadlineScope&) = delete;
+
+        // The thread's deadline, or Clock::time_point::max() outside any scope
+        static Clock::time_point current();
+
+    private:
+        // members
+        Clock::time_point previous_;
+};
@@ -2,8 +2,18 @@
 
 #include <string>
 #include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
 #include <set>
+#include <stdexcept>
+#include <string_view>
 #include <thread>
 #include <atomic>
 #include <fstream>
@@ -13,13 +23,68 @@
 #include <nlohmann/json.hpp>
 #include <curl/curl.h>
 
+#include "backfill.hpp"
+#include "candle_store.hpp"
+#include "candles.hpp"
+#include "connection_pool.hpp"
+#include "datetime.hpp"
+#include "json_document.hpp"
+#include "logger.hpp"
+#include "metrics.hpp"
+#include "option_chain.hpp"
+#include "option_pricer.hpp"
+#include "quote_poller.hpp"
+#include "rate_limiter.hpp"
+#include "request_loop.hpp"
+#include "response_archive.hpp"
+#include "response_cache.hpp"
+#include "retry_policy.hpp"
+#include "single_flight.hpp"
+#include "streamer.hpp"
+
 using string = std::string;
 using json = nlohmann::json;
 using Clock = std::chrono::system_clock;
 
+// Receives a response body, or the error the blocking call would have thrown
+using ResponseCallback = std::function<void(const string& body, std::exception_ptr error)>;
+
+// Thrown by Client::quotes for a list of symbols when some of its batches
+// failed (an HTTP error, a timeout or a transport error). partial holds
+// the merged quotes of the batches that succeeded
+struct QuoteBatchError : std::runtime_error {
+    QuoteBatchError(const string& what, string partial, std::size_t failed, std::size_t batches)
+        : std::runtime_error{what}, partial{std::move(partial)}, failedBatches{failed}, batches{batches} { }
+
+    string partial;
+    std::size_t failedBatches;
+    std::size_t batches;
+};
+
+// Where Client requests go: the API, the API with every response archived,
+// or an archive only (no network)
+enum class Transport { Live, Record, Replay };
+
+inline const string schwabBaseUrl = "https://api.schwabapi.com/";
+
+/*--------------------------------------------------------------*/
+/*      Immutable token state. Tokens publishes a new one on    */
+/*      every create / refresh, so readers never see a torn     */
+/*      pair and never block                                    */
+/*--------------------------------------------------------------*/
+struct TokenSnapshot {
+    string accessToken;
+    string refreshToken;
+    Clock::time_point expiresAt;
+    Clock::time_point refreshExpiresAt;
+};
+
 /*--------------------------------------------------------------*/
 /*      A class to handle creating tokens to access the         */
-/*      Charles Schwab API and refresh tokens automatically     */
+/*      Charles Schwab API and refresh tokens automatically.    */
+/*      Construction returns at once: saved tokens are checked, */
+/*      refreshed or replaced by a new authorization on the     */
+/*      background thread, and accessors wait until then        */
 /*--------------------------------------------------------------*/
 class Tokens {
     public:
@@ -28,19 +93,36 @@ class Tokens {
             const string appSecret,
             const string callbackUrl,
             const string tokensFile,
-            bool autoRefresh = true
+            bool autoRefresh = true,
+            const string baseUrl = schwabBaseUrl,
+            Metrics* metrics = nullptr      // refresh timings, if given
         );
 
         ~Tokens();  // stops background thread
 
-        // Accessor methods
+        // Accessor methods. Lock-free once ready(); before that they wait
+        // for startup, up to readyTimeout_ or the thread's DeadlineScope,
+        // and throw std::runtime_error if it does not finish in time
         string accessToken() const;
         string refreshToken() const;
+        std::shared_ptr<const TokenSnapshot> snapshot() const;   // never waits
+        std::shared_ptr<const TokenSnapshot> readySnapshot() const;  // waits like accessToken()
+
+        // Whether usable tokens have been loaded, refreshed or created.
+        // waitUntilReady returns false early if startup failed for good
+        bool ready() const;
+        bool waitUntilReady(std::chrono::milliseconds timeout) const;
 
-        // Forces immediate token creation / refresh
+        // Forces immediate token creation / refresh. createTokens prints the
+        // authorization URL and waits for the redirect on the callback
+        // URL's host and port, or for it to be pasted on stdin
         void createTokens();
         void refreshTokens();
 
+        // Single-flight refresh after a 401. Refreshes only if staleAccessToken
+        // is still current; concurrent callers wait for the one refresh.
+        bool refreshIfStale(const string& staleAccessToken);
+
     private:
         // HTTP post helper
         string httpPost(
@@ -53,6 +135,19 @@ class Tokens {
         void loadFromFile(string& path);
         void writeToFile(string& path);
 
+        // Publishes new token state, marks the tokens ready and wakes the
+        // refresh thread
+        void publish(std::shared_ptr<const TokenSnapshot> next);
+        void refreshLocked();
+        void refreshRequest();
+
+        // Brings unusable saved tokens back: refreshes them, or authorizes
+        // anew when there is no refresh token or it was rejected. Retries
+        // until it succeeds; false on shutdown, or at once when there is
+        // no way to receive an authorization code
+        bool startup();
+        void awaitReady() const;
+
         // Timing
         void startBackgroundRefresh();
         void stopBackgroundRefresh();
@@ -60,21 +155,32 @@ class Tokens {
 
         // members
         const string appKey_, appSecret_, callbackUrl_;
-        const string baseUrl_ = "https://api.schwabapi.com/v1/";
+        const string baseUrl_;          // ends in "v1/"
         string tokensFile_;
+        Metrics* metrics_;
+        const bool autoRefresh_;
 
-        std::atomic<bool> running_{false};
+        bool running_ = false;          // guarded by waitMutex_
+        std::atomic<bool> stopping_{false};     // ends a wait for authorization
+        std::mutex waitMutex_;
+        std::condition_variable wakeup_;
         std::thread refreshThread_;
 
+        std::atomic<bool> ready_{false};
+        std::atomic<bool> startupFailed_{false};        // no retry will help
+        mutable std::mutex readyMutex_;
+        mutable std::condition_variable readyChanged_;
+
         // token data
-        string accessToken_;
-        string refreshToken_;
-        Clock::time_point expiresAt_;
-        Clock::time_point refreshExpiresAt_;
+        std::atomic<std::shared_ptr<const TokenSnapshot>> snapshot_;
+        std::mutex refreshMutex_;       // one refresh at a time
 
         // Timeouts
         std::chrono::seconds accessTimeoutSeconds_{30 * 60};
         std::chrono::hours refreshTimeoutHours_{7 * 24};
+        std::chrono::seconds refreshLead_{2 * 60};      // refresh this long before expiry
+        std::chrono::seconds retryDelay_{15};           // after a failed refresh
+        std::chrono::minutes readyTimeout_{5};          // accessors' wait for startup
 };
 
 /*----------------------------------------------------------*/
@@ -89,15 +195,60 @@ class Client {
             const string appSecret,
             const string callbackUrl,
             const string tokensFile,
-            std::chrono::milliseconds timeoutMs
+            std::chrono::milliseconds timeoutMs,
+            std::size_t poolSize = 4,    // keep-alive handles shared across threads
+            const string baseUrl = schwabBaseUrl
         );
+
+        // Offline client serving every request from a recorded archive.
+        // Needs no tokens and never touches the network
+        explicit Client(const string replayArchive, std::size_t poolSize = 4);
         ~Client();
 
-        long long datetimeToEpoch(const string& datetime);
-        long long dateToEpoch(const string& date);
+        // Switches between live requests, recording them to archivePath and
+        // replaying archivePath. Not safe while requests are in flight
+        void setTransport(Transport mode, const string& archivePath = "");
+        Transport transport() const { return transport_; }
+        ResponseArchive* archive() { return archive_.get(); }
+
+        static long long datetimeToEpoch(const string& datetime);
+        static long long dateToEpoch(const string& date);
 
         string priceHistory(const std::map<string, string>& params);
+        Candles priceHistoryCandles(
+            const std::map<string, string>& params,
+            std::pmr::memory_resource* mr = std::pmr::get_default_resource()
+        );
+        Candles priceHistory(
+            const std::map<string, string>& params,
+            CandleStore& store,
+            std::pmr::memory_resource* mr = std::pmr::get_default_resource()
+        );
         string optionChains(const std::map<string, string>& params);
+        OptionChainTable optionChainsTable(const std::map<string, string>& params);
+
+        // As above, but threads asking for the same query at the same time
+        // share one request and one immutable result. The value-returning
+        // versions go through these and copy, except priceHistoryCandles
+        // with a non-default mr, which always makes its own request
+        std::shared_ptr<const string> priceHistoryShared(const std::map<string, string>& params);
+        std::shared_ptr<const Candles> priceHistoryCandlesShared(const std::map<string, string>& params);
+        std::shared_ptr<const string> optionChainsShared(const std::map<string, string>& params);
+        std::shared_ptr<const OptionChainTable> optionChainsTableShared(const std::map<string, string>& params);
+
+        // As above, but the body is written into out and a view of it is
+        // returned. out keeps its capacity from call to call; one built on
+        // an arena holds the body there. Not shared with identical calls in
+        // flight. Once the pool, out and the auth headers are warm, these
+        // make no heap allocations of their own
+        std::string_view priceHistory(const std::map<string, string>& params, std::pmr::string& out);
+        std::string_view optionChains(const std::map<string, string>& params, std::pmr::string& out);
+        std::string_view movers(const string& indexSymbol, const string& sort, const int& frequency,
+                                std::pmr::string& out);
+        std::string_view quotes(const string& symbols, const string& fields, const bool& indicative,
+                                std::pmr::string& out);
+        std::string_view quotes(const string& symbol, const string& fields, std::pmr::string& out);
+
         string optionExpirationChains(const string& symbol);
         string marketHours(const string& markets, const string& date);
         string movers(const string& indexSymbol, const string&sort, const int& frequency);
@@ -105,12 +256,174 @@ class Client {
         string instruments(const string& cupid);
         string quotes(const string& symbols, const string& fields, const bool& indicative);
         string quotes(const string& symbol, const string& fields);
+        string quotes(
+            const std::vector<string>& symbols,
+            const string& fields,
+            const bool& indicative,
+            std::size_t maxInFlight = 8
+        );
+
+        // TTLs, memory budget, disk tier and counters for cached endpoints
+        // (marketHours, optionExpirationChains, instruments)
+        ResponseCache& cache() { return cache_; }
+
+        // Request budget shared by all calls; see RateLimiter::setRate
+        RateLimiter& rateLimiter() { return limiter_; }
+
+        // Per-endpoint latency histograms and counters
+        Metrics& metrics() { return metrics_; }
+
+        // Retries with backoff for blocking and asynchronous GETs, and
+        // opt-in hedging for blocking ones. Set before making requests;
+        // per-call deadlines come from a DeadlineScope
+        void setRetryPolicy(const RetryPolicy& policy) { retry_ = policy; }
+        const RetryPolicy& retryPolicy() const { return retry_; }
+        void setHedgePolicy(const HedgePolicy& policy) { hedge_ = policy; }
+        const HedgePolicy& hedgePolicy() const { return hedge_; }
+
+        // Requests made and requests saved by sharing in-flight calls
+        SingleFlightStats singleFlightStats() const;
+
+        // Non-blocking requests driven by the request loop
+        std::future<string> priceHistoryAsync(const std::map<string, string>& params);
+        void priceHistoryAsync(const std::map<string, string>& params, ResponseCallback done);
+        std::future<string> optionChainsAsync(const std::map<string, string>& params);
+        void optionChainsAsync(const std::map<string, string>& params, ResponseCallback done);
+        std::future<string> quotesAsync(const string& symbols, const string& fields, const bool& indicative);
+        void quotesAsync(const string& symbols, const string& fields, const bool& indicative, ResponseCallback done);
+
+        // Concurrent batch, results in input order
+        std::vector<string> priceHistoryMany(
+            const std::vector<std::map<string, string>>& paramsList,
+            std::size_t maxInFlight = 16
+        );
+
+        // Streamer connection details from trader/v1/userPreference, and a
+        // Streamer that logs in with this client's tokens. The streamer must
+        // not outlive the client
+        StreamerInfo streamerInfo();
+        std::unique_ptr<Streamer> streamer(StreamerConfig config = {});
     private:
         std::chrono::milliseconds timeoutMs_;
-        const string baseUrl_ = "https://api.schwabapi.com/";
-        Tokens tokens_;
-        
+        const string baseUrl_;
+        Metrics metrics_;                       // before tokens_, which reports to it
+        std::unique_ptr<Tokens> tokens_;        // null for a replay-only client
+
+        // Authorization and Accept headers for one access token, built once
+        // and shared by every request sent with it
+        struct AuthHeaders {
+            std::shared_ptr<const TokenSnapshot> token;
+            struct curl_slist* list = nullptr;
+            ~AuthHeaders() { curl_slist_free_all(list); }
+        };
+        std::atomic<std::shared_ptr<const AuthHeaders>> authHeaders_;
+
+        Transport transport_ = Transport::Live;
+        std::unique_ptr<ResponseArchive> archive_;
+
+        RetryPolicy retry_;
+        HedgePolicy hedge_;
+
+        // Server limits for one quotes request
+        static constexpr std::size_t maxQuoteSymbols_ = 500;
+        static constexpr std::size_t maxQuoteSymbolBytes_ = 6000;   // encoded "symbols" value
+
+        ConnectionPool pool_;
+        RateLimiter limiter_;
+        RequestLoop loop_;     // declared after pool_ and limiter_, which it uses
+
+        std::mutex offLoopMutex_;
+        std::condition_variable offLoopWake_;
+        std::deque<std::function<void()>> offLoopTasks_;
+        std::thread offLoopThread_;
+        bool offLoopStopping_ = false;
+        ResponseCache cache_;
+
+        // In-flight calls by canonical URL; raw bodies and parsed results apart
+        SingleFlight<string> bodyFlights_;
+        SingleFlight<Candles> candleFlights_;
+        SingleFlight<OptionChainTable> chainFlights_;
+
         bool valideKeys(const std::map<string, string>& params, const std::set<string>& valKeys);
-        bool containsReqArgs(const std::map<string, string>& params, const std::set<string>& reqArgNames);
-        string httpGet(const string& fullUrl, CURL* curl);
+        long long paramToEpoch(const string& value);
+        string priceHistoryUrl(const std::map<string, string>& params);
+        string optionChainsUrl(const std::map<string, string>& params);
+        string quotesUrl(const string& symbols, const string& fields, const bool& indicative);
+        // As above, into url (reusing its capacity); false when invalid
+        bool priceHistoryUrl(const std::map<string, string>& params, string& url);
+        bool optionChainsUrl(const std::map<string, string>& params, string& url);
+        bool quotesUrl(const string& symbols, const string& fields, const bool& indicative, string& url);
+        bool moversUrl(const string& indexSymbol, const string& sort, const int& frequency, string& url);
+        bool quoteUrl(const string& symbol, const string& fields, string& url);
+
+        void setDefaultTtls();
+        std::string_view archiveKey(const string& fullUrl) const;
+        ResponseArchive::Response replayed(const string& fullUrl);
+        // One GET attempt, and the state carried from one to the next
+        struct Attempt {
+            CURLcode rc = CURLE_OK;
+            long status = 0;
+            CURL* curl = nullptr;                   // the handle holding the response
+            std::chrono::seconds retryAfter{0};
+        };
+        struct AttemptState {
+            Priority priority = Priority::Normal;
+            DeadlineScope::Clock::time_point deadline = DeadlineScope::Clock::time_point::max();
+            int number = 1;
+            bool refreshed = false;                 // token already refreshed after a 401
+        };
+
+        std::shared_ptr<const AuthHeaders> currentHeaders();
+        void prepareGet(
+            CURL* curl,
+            const string& fullUrl,
+            struct curl_slist* headers,
+            DeadlineScope::Clock::time_point deadline = DeadlineScope::Clock::time_point::max(),
+            DeadlineScope::Clock::time_point notBefore = {}
+        );
+        bool checkResult(CURLcode rc);
+        bool shouldRetry(EndpointMetrics& metrics, const AttemptState& state, CURLcode rc, long status,
+                        std::chrono::seconds retryAfter, DeadlineScope::Clock::duration& delay);
+        DeadlineScope::Clock::duration hedgeDelay(const EndpointMetrics& metrics) const;
+        Attempt perform(CURL* curl, const string& fullUrl, struct curl_slist* headers, const AttemptState& state,
+                        EndpointMetrics& metrics, ConnectionPool::Lease& hedge);
+        // Each attempt takes a pooled handle after its rate-limiter token
+        string httpGet(const string& fullUrl, Priority priority, long* status = nullptr);
+        template <typename Body>
+        void httpGetInto(const string& fullUrl, Priority priority, Body& out, long* status = nullptr);
+        std::string_view fetchInto(const string& fullUrl, Priority priority, std::pmr::string& out);
+        string cachedGet(const string& endpoint, const string& fullUrl);
+        OptionChainTable fetchOptionChainsTable(const string& fullUrl);
+        // Like ResponseCallback, with the final HTTP status (0 if none)
+        using StatusCallback = std::function<void(long status, const string& body, std::exception_ptr error)>;
+        struct Fetched {
+            long status = 0;
+            string body;
+            std::exception_ptr error;
+        };
+        void submitGet(CURL* curl, const string& fullUrl, StatusCallback done, Priority priority);
+        void submitAttempt(
+            CURL* curl,
+            const string& fullUrl,
+            StatusCallback&& done,      // left untouched if this throws
+            AttemptState state,
+            RateLimiter::Clock::time_point notBefore = {}
+        );
+        void resubmit(const string& fullUrl, StatusCallback& done, AttemptState state,
+                      RateLimiter::Clock::time_point notBefore = {});
+        void finishGet(const string& fullUrl, CURLcode rc, long status, string& body, const StatusCallback& done);
+
+        // Runs work a completion must not block the loop thread with, such
+        // as a token refresh after a 401, in order on a helper thread
+        // started on first use. Once the client is being destroyed, runs
+        // task on the calling thread instead
+        void runOffLoop(std::function<void()> task);
+        void offLoopRun();
+        void submitPriceHistory(const std::map<string, string>& params, StatusCallback done);
+        void submitQuotes(const string& symbols, const string& fields, const bool& indicative, StatusCallback done);
+        std::vector<Fetched> fanOut(
+            std::size_t count,
+            std::size_t maxInFlight,
+            const std::function<void(std::size_t, StatusCallback)>& start
+        );
 };
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+struct SingleFlightStats {
+    std::uint64_t calls = 0;        // work actually run
+    std::uint64_t shared = 0;       // callers that joined a call in flight instead
+};
+
+/*--------------------------------------------------------------*/
+/*      Collapses concurrent calls for the same key into one.   */
+/*      The first caller runs the work; callers arriving while  */
+/*      it is in flight wait for it and share its immutable     */
+/*      result, or its exception. Nothing is kept once the      */
+/*      call finishes, so this is not a cache                   */
+/*--------------------------------------------------------------*/
+template <typename Value>
+class SingleFlight {
+    public:
+        using Result = std::shared_ptr<const Value>;
+
+        using Stats = SingleFlightStats;
+
+        /*
+         * @brief Runs fn() for key unless a call for key is already in
+         * flight, in which case it waits for that call, but no later than
+         * deadline; a caller that gives up gets a null result. fn's
+         * exception is rethrown to every caller that waited on it.
+         *
+         * @param joined: set to whether this caller shared another's call
+         */
+        template <typename Fn>
+        Result run(const std::string& key, Fn&& fn, bool* joined = nullptr,
+                   std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max()) {
+            std::shared_ptr<Call> call;
+            bool leader;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto [it, added] = calls_.try_emplace(key);
+                leader = added;
+                if (leader) {
+                    it->second = std::make_shared<Call>();
+                    ++stats_.calls;
+                } else {
+                    ++stats_.shared;
+                }
+                call = it->second;
+            }
+            if (joined) {
+                *joined = !leader;
+            }
+            if (!leader) {
+                if (deadline != std::chrono::steady_clock::time_point::max()
+                        && call->result.wait_until(deadline) != std::future_status::ready) {
+                    return nullptr;
+                }
+                return call->result.get();
+            }
+
+            Result result;
+            std::exception_ptr error;
+            try {
+                result = std::make_shared<const Value>(fn());
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            // Later callers start a fresh request rather than see this one
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                calls_.erase(key);
+            }
+            if (error) {
+                call->promise.set_exception(error);
+                std::rethrow_exception(error);
+            }
+            call->promise.set_value(result);
+            return result;
+        }
+
+        Stats stats() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return stats_;
+        }
+
+        std::size_t inFlight() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return calls_.size();
+        }
+
+    private:
+        struct Call {
+            std::promise<Result> promise;
+            std::shared_future<Result> result{promise.get_future()};
+        };
+
+        // members
+        mutable std::mutex mutex_;
+        std::unordered_map<std::string, std::shared_ptr<Call>> calls_;
+        Stats stats_;
+};
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <variant>
+#include <vector>
+
+/*--------------------------------------------------------------*/
+/*      Typed records decoded from streamer data frames.        */
+/*      Level-one updates only carry the fields that changed,   */
+/*      so each record says which of its fields are set         */
+/*--------------------------------------------------------------*/
+enum class StreamService : std::uint8_t { LevelOneEquities, ChartEquity };
+
+// Fixed-size so records copy into the queue without allocating
+struct StreamSymbol {
+    std::array<char, 31> chars{};
+    std::uint8_t length = 0;
+
+    void assign(std::string_view text) {
+        length = static_cast<std::uint8_t>(std::min(text.size(), chars.size()));
+        std::copy_n(text.data(), length, chars.data());
+    }
+    std::string_view view() const { return {chars.data(), length}; }
+};
+
+// LEVELONE_EQUITIES field numbers, as the server sends them
+enum class LevelOneField : std::uint8_t {
+    Bid = 1, Ask = 2, Last = 3, BidSize = 4, AskSize = 5,
+    TotalVolume = 8, LastSize = 9, High = 10, Low = 11, Close = 12,
+    Open = 17, NetChange = 18, High52Week = 19, Low52Week = 20,
+    Mark = 33, QuoteTime = 34, TradeTime = 35, NetPercentChange = 42
+};
+
+struct LevelOneQuote {
+    StreamSymbol symbol;
+    long long serverTime = 0;       // frame timestamp, epoch ms
+    std::uint64_t present = 0;      // bit n set when field n came in this update
+
+    double bid = 0, ask = 0, last = 0;
+    double bidSize = 0, askSize = 0, lastSize = 0;
+    double totalVolume = 0;
+    double open = 0, high = 0, low = 0, close = 0;
+    double netChange = 0, netPercentChange = 0, mark = 0;
+    double high52Week = 0, low52Week = 0;
+    long long quoteTime = 0, tradeTime = 0;     // epoch ms
+
+    bool has(LevelOneField field) const { return present >> static_cast<unsigned>(field) & 1; }
+};
+
+// One CHART_EQUITY minute bar
+struct ChartBar {
+    StreamSymbol symbol;
+    long long serverTime = 0;       // frame timestamp, epoch ms
+    double open = 0, high = 0, low = 0, close = 0, volume = 0;
+    long long sequence = 0;
+    long long time = 0;             // bar start, epoch ms
+    int chartDay = 0;
+};
+
+using StreamRecord = std::variant<LevelOneQuote, ChartBar>;
+
+/*--------------------------------------------------------------*/
+/*      Bounded single-producer single-consumer ring. The       */
+/*      streamer thread pushes; one consumer thread pops.       */
+/*      A full ring drops the record instead of blocking        */
+/*--------------------------------------------------------------*/
+class StreamQueue {
+    public:
+        // Capacity is rounded up to a power of two
+        explicit StreamQueue(std::size_t capacity)
+            : mask_{std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1},
+              slots_{std::make_unique<StreamRecord[]>(mask_ + 1)} { }
+
+        // Producer only
+        bool push(const StreamRecord& record) {
+            std::size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - headCache_ > mask_) {
+                headCache_ = head_.load(std::memory_order_acquire);
+                if (tail - headCache_ > mask_) {
+                    return false;
+                }
+            }
+            slots_[tail & mask_] = record;
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer only
+        bool pop(StreamRecord& record) {
+            std::size_t head = head_.load(std::memory_order_relaxed);
+            if (head == tailCache_) {
+                tailCache_ = tail_.load(std::memory_order_acquire);
+                if (head == tailCache_) {
+                    return false;
+                }
+            }
+            record = slots_[head & mask_];
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer only: hands up to max records to fn and returns how many
+        template <typename Fn>
+        std::size_t drain(Fn&& fn, std::size_t max = SIZE_MAX) {
+            std::size_t head = head_.load(std::memory_order_relaxed);
+            std::size_t tail = tail_.load(std::memory_order_acquire);
+            std::size_t count = std::min(tail - head, max);
+            for (std::size_t i = 0; i < count; ++i) {
+                fn(static_cast<const StreamRecord&>(slots_[(head + i) & mask_]));
+            }
+            head_.store(head + count, std::memory_order_release);
+            return count;
+        }
+
+        std::size_t size() const { return tail_.load() - head_.load(); }
+        std::size_t capacity() const { return mask_ + 1; }
+
+    private:
+        // members
+        const std::size_t mask_;
+        std::unique_ptr<StreamRecord[]> slots_;
+        alignas(64) std::atomic<std::size_t> head_{0};     // next to pop
+        std::size_t tailCache_ = 0;                         // consumer's view of tail_
+        alignas(64) std::atomic<std::size_t> tail_{0};     // next to push
+        std::size_t headCache_ = 0;                         // producer's view of head_
+};
+
+/*--------------------------------------------------------------*/
+/*      Where and as whom to connect, from the streamerInfo     */
+/*      of GET trader/v1/userPreference                         */
+/*--------------------------------------------------------------*/
+struct StreamerInfo {
+    std::string socketUrl;          // wss://… (ws:// for a local mock)
+    std::string customerId;
+    std::string correlId;
+    std::string channel;
+    std::string functionId;
+
+    // Throws std::runtime_error when the response has no streamerInfo
+    static StreamerInfo fromUserPreference(const std::string& body);
+};
+
+struct StreamerConfig {
+    std::size_t queueCapacity = 1 << 16;                // records, for services without a handler
+    std::chrono::milliseconds connectTimeout{10000};
+    std::chrono::milliseconds idleTimeout{30000};       // reconnect after this long without a frame
+    std::chrono::milliseconds maxBackoff{30000};        // between reconnect attempts
+};
+
+enum class StreamerState : std::uint8_t {
+    Stopped,
+    Connecting,     // opening the socket or waiting for the login response
+    Streaming,      // logged in; subscriptions are live
+    Backoff         // waiting to reconnect after a failure
+};
+
+struct StreamerStats {
+    std::uint64_t frames = 0;       // data and control messages received
+    std::uint64_t records = 0;      // quotes and bars decoded
+    std::uint64_t dropped = 0;      // records lost to a full queue
+    std::uint64_t bytes = 0;        // received, framing included
+    std::uint64_t reconnects = 0;
+};
+
+/*--------------------------------------------------------------*/
+/*      A push client for the Schwab streamer. Logs in over a   */
+/*      WebSocket, keeps the subscription set across            */
+/*      reconnects and decodes level-one quotes and chart bars  */
+/*      on its own thread, handing them to a callback or to     */
+/*      queue() for a consumer thread                           */
+/*--------------------------------------------------------------*/
+class Streamer {
+    public:
+        using QuoteHandler = std::function<void(const LevelOneQuote&)>;
+        using ChartHandler = std::function<void(const ChartBar&)>;
+
+        // accessToken is called at every login, so it can follow refreshes
+        Streamer(StreamerInfo info, std::function<std::string()> accessToken, StreamerConfig config = {});
+        ~Streamer();    // logs out and joins the thread
+
+        Streamer(const Streamer&) = delete;
+        Streamer& operator=(const Streamer&) = delete;
+
+        // Called on the streamer thread. Set before start(); services
+        // without a handler go to queue()
+        void onQuote(QuoteHandler handler) { quoteHandler_ = std::move(handler); }
+        void onChart(ChartHandler handler) { chartHandler_ = std::move(handler); }
+
+        void start();
+        void stop();
+
+        // Thread-safe. Symbols are kept across reconnects and may be
+        // changed before start()
+        void subscribe(StreamService service, const std::vector<std::string>& symbols);
+        void unsubscribe(StreamService service, const std::vector<std::string>& symbols);
+        std::vector<std::string> subscriptions(StreamService service) const;
+
+        StreamQueue& queue() { return queue_; }
+        StreamerState state() const { return state_.load(std::memory_order_relaxed); }
+        StreamerStats stats() const;
+
+    private:
+        struct Command {
+            StreamService service;
+            bool add;
+            std::vector<std::string> symbols;
+        };
+        class Connection;
+        class FrameDecoder;
+
+        void run();
+        void session(Connection& connection);
+        void sendLogin(Connection& connection);
+        void sendSubscriptions(Connection& connection);
+        void sendCommands(Connection& connection, std::vector<Command>& commands, bool live);
+        void handleControl(Connection& connection, std::string_view frame);
+        void deliver(const LevelOneQuote& quote);
+        void deliver(const ChartBar& bar);
+        std::string request(StreamService service, std::string_view command, std::string_view keys);
+        std::string adminRequest(std::string_view command, std::string_view parameters);
+        bool waitForWake(std::chrono::milliseconds timeout);
+        void wake();
+
+        // members
+        const StreamerInfo info_;
+        const std::function<std::string()> accessToken_;
+        const StreamerConfig config_;
+        QuoteHandler quoteHandler_;
+        ChartHandler chartHandler_;
+        StreamQueue queue_;
+
+        mutable std::mutex mutex_;
+        std::vector<Command> commands_;         // from subscribe() / unsubscribe(), not yet applied
+        std::set<std::string> symbols_[2];      // by StreamService; the set the server should have
+
+        std::atomic<StreamerState> state_{StreamerState::Stopped};
+        std::atomic<bool> running_{false};
+        std::atomic<bool> loggedIn_{false};
+        int wakeFds_[2] = {-1, -1};             // pipe: stop and new commands interrupt poll()
+        std::thread thread_;
+        long long requestId_ = 0;               // streamer thread only
+
+        std::atomic<std::uint64_t> frames_{0}, records_{0}, dropped_{0}, bytes_{0}, reconnects_{0};
+};
@@ -0,0 +1,361 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "backfill.hpp"
+#include "file_io.hpp"
+#include "logger.hpp"
+#include "schwab_api.hpp"
+
+using string = std::string;
+
+static constexpr long long dayMs = 24LL * 60 * 60 * 1000;
+
+//==============================================================================
+//                              Planner
+//==============================================================================
+/*
+ * Windows are [start, start + window - 1] back to back, the last one cut
+ * at job.end. Repeated or empty symbols are planned once or not at all.
+ */
+std::vector<BackfillWindow> planBackfill(const BackfillJob& job) {
+    std::vector<BackfillWindow> plan;
+    bool minutes = job.frequencyType == "minute";
+    long long window = job.window.count() > 0 ? job.window.count()
+                     : minutes ? 10 * dayMs : 20 * 365 * dayMs;
+
+    std::set<string> planned;
+    for (const auto& symbol : job.symbols) {
+        if (symbol.empty() || !planned.insert(symbol).second) {
+            continue;
+        }
+        for (long long start = job.start; start <= job.end; start += window) {
+            long long end = job.end - start < window ? job.end : start + window - 1;
+
+            BackfillWindow entry{symbol, "", start, end, job.params};
+            entry.params["symbol"] = symbol;
+            entry.params.try_emplace("periodType", minutes ? "day" : "year");
+            entry.params["frequencyType"] = job.frequencyType;
+            entry.params["frequency"] = std::to_string(job.frequency);
+            entry.params["startDate"] = std::to_string(start);
+            entry.params["endDate"] = std::to_string(end);
+            entry.series = candleSeries(entry.params);
+            plan.push_back(std::move(entry));
+
+            if (end == job.end) {
+                break;
+            }
+        }
+    }
+    return plan;
+}
+
+//==============================================================================
+//                              Merge
+//==============================================================================
+/*
+ * Windows overlap at their edges and a response may repeat a candle, so
+ * each window is cut to its own range and reduced to one candle per
+ * datetime. Columns are only rebuilt when something moved or went.
+ */
+std::size_t mergeCandles(Candles& candles, long long start, long long end) {
+    const auto& datetime = candles.datetime;
+    std::vector<std::uint32_t> order;
+    order.reserve(candles.size());
+    for (std::uint32_t i = 0; i < candles.size(); ++i) {
+        if (datetime[i] >= start && datetime[i] <= end) {
+            order.push_back(i);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](std::uint32_t a, std::uint32_t b) { return datetime[a] < datetime[b]; });
+
+    // Of equal datetimes, the last one received wins
+    std::vector<std::uint32_t> kept;
+    kept.reserve(order.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        if (i + 1 == order.size() || datetime[order[i + 1]] != datetime[order[i]]) {
+            kept.push_back(order[i]);
+        }
+    }
+
+    std::size_t dropped = candles.size() - kept.size();
+    bool inPlace = dropped == 0;
+    for (std::size_t i = 0; inPlace && i < kept.size(); ++i) {
+        inPlace = kept[i] == i;
+    }
+    if (inPlace) {
+        return 0;
+    }
+
+    auto gather = [&](auto& column) {
+        std::remove_reference_t<decltype(column)> out(column.get_allocator());
+        out.reserve(kept.size());
+        for (std::uint32_t i : kept) {
+            out.push_back(column[i]);
+        }
+        column = std::move(out);
+    };
+    gather(candles.open);
+    gather(candles.high);
+    gather(candles.low);
+    gather(candles.close);
+    gather(candles.volume);
+    gather(candles.datetime);
+    return dropped;
+}
+
+//==============================================================================
+//                              Sinks
+//==============================================================================
+void CandleStoreSink::write(const BackfillWindow& window, const Candles& candles) {
+    store_.append(window.symbol, window.series, window.start, window.end, candles);
+}
+
+//==============================================================================
+//                              BackfillJournal
+//==============================================================================
+BackfillJournal::BackfillJournal(const string& path)
+    : path_{path}
+{
+    std::size_t valid = 0;
+    {
+        MappedFile file(path_);
+        std::string_view text(file.data() ? file.data() : "", file.size());
+        for (std::size_t at = 0; at < text.size(); ) {
+            std::size_t newline = text.find('\n', at);
+            if (newline == std::string_view::npos) {
+                break;      // torn by a crash mid-append
+            }
+            done_.emplace(text.substr(at, newline - at));
+            at = valid = newline + 1;
+        }
+    }
+
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Failed to open journal " + path_ + ": " + std::strerror(errno));
+    }
+    // Drop a torn tail so the next line starts clean
+    if (::ftruncate(fd_, static_cast<off_t>(valid)) != 0) {
+        ::close(fd_);
+        throw std::runtime_error("Failed to truncate journal " + path_ + ": " + std::strerror(errno));
+    }
+}
+
+BackfillJournal::~BackfillJournal() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+string BackfillJournal::key(const BackfillWindow& window) {
+    return window.symbol + '\t' + window.series + '\t' + std::to_string(window.start)
+         + '\t' + std::to_string(window.end);
+}
+
+bool BackfillJournal::done(const BackfillWindow& window) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return done_.count(key(window)) > 0;
+}
+
+void BackfillJournal::markDone(const BackfillWindow& window) {
+    string line = key(window);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (done_.count(line) > 0) {
+        return;
+    }
+    line += '\n';
+    writeAll(fd_, line.data(), line.size(), path_);
+    ::fdatasync(fd_);
+    line.pop_back();
+    done_.insert(std::move(line));
+}
+
+std::size_t BackfillJournal::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return done_.size();
+}
+
+//==============================================================================
+//                              Backfill
+//==============================================================================
+/*
+ * One run's windows and its in-order release. The plan is symbol by
+ * symbol, so each symbol's windows are a contiguous group; a window is
+ * written once it and every earlier window of its group are resolved.
+ */
+struct Backfill::Run {
+    enum State : char { Pending, Ready, Resolved };
+
+    std::vector<BackfillWindow> plan;
+    std::unique_ptr<BackfillJournal> journal;
+    std::atomic<std::size_t> next{0};
+
+    // Guarded by Backfill::mutex_
+    std::vector<State> state;
+    std::vector<Candles> ready;
+    std::vector<std::size_t> group;         // by window
+    std::vector<std::size_t> cursor;        // by group: next window to write
+    std::vector<std::size_t> groupEnd;
+    std::exception_ptr error;               // first sink failure
+};
+
+Backfill::Backfill(Client& client, BackfillSink& sink, BackfillConfig config)
+    : client_{client},
+      sink_{sink},
+      config_{config},
+      budget_{config.requestsPerSecond, config.burst}
+{ }
+
+BackfillStats Backfill::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+/*
+ * @brief Plans job, skips what the journal already has, and fetches the
+ * rest on up to maxInFlight threads. Rethrows the first error the sink
+ * or journal raised, after cancelling the windows not yet started.
+ */
+BackfillStats Backfill::run(const BackfillJob& job) {
+    Run run;
+    run.plan = planBackfill(job);
+    if (!config_.journalPath.empty()) {
+        run.journal = std::make_unique<BackfillJournal>(config_.journalPath);
+    }
+
+    std::size_t count = run.plan.size();
+    run.state.assign(count, Run::Pending);
+    run.ready.resize(count);
+    run.group.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (i == 0 || run.plan[i].symbol != run.plan[i - 1].symbol) {
+            run.cursor.push_back(i);
+            run.groupEnd.push_back(i);
+        }
+        run.group[i] = run.cursor.size() - 1;
+        run.groupEnd.back() = i + 1;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_ = BackfillStats{};
+        stats_.windows = count;
+    }
+    cancelled_ = false;
+
+    Logger::instance().log(LogComponent::Client, LogLevel::Info, "Backfill of ", job.symbols.size(),
+                           " symbols in ", count, " windows");
+    std::vector<std::thread> fetchers;
+    std::size_t threads = std::min(std::max<std::size_t>(config_.maxInFlight, 1), count);
+    for (std::size_t i = 0; i < threads; ++i) {
+        fetchers.emplace_back(&Backfill::fetchWindows, this, std::ref(run));
+    }
+    for (auto& fetcher : fetchers) {
+        fetcher.join();
+    }
+
+    if (run.error) {
+        std::rethrow_exception(run.error);
+    }
+    BackfillStats out = stats();
+    Logger::instance().log(LogComponent::Client, LogLevel::Info, "Backfill wrote ", out.written, " windows, ",
+                           out.candles, " candles; ", out.resumed, " resumed, ", out.failed, " failed");
+    return out;
+}
+
+/*------------------------------*/
+/*      Fetcher threads         */
+/*------------------------------*/
+void Backfill::fetchWindows(Run& run) {
+    PriorityScope scope(config_.priority);
+    while (!cancelled_) {
+        std::size_t index = run.next.fetch_add(1);
+        if (index >= run.plan.size()) {
+            return;
+        }
+        const BackfillWindow& window = run.plan[index];
+        if (run.journal && run.journal->done(window)) {
+            resolve(run, index, Outcome::Resumed);
+            continue;
+        }
+
+        budget_.acquire(config_.priority);
+        Candles candles;
+        string failure;
+        try {
+            auto body = client_.priceHistoryShared(window.params);
+            candles = parseCandles(*body);
+            if (body->empty()) {
+                failure = "no response";
+            } else if (candles.symbol.empty()) {
+                failure = body->substr(0, 200);     // an error body, not price history
+            }
+        } catch (const std::exception& e) {
+            failure = e.what();
+        }
+        if (!failure.empty()) {
+            Logger::instance().log(LogComponent::Client, LogLevel::Warn, "Backfill window ", window.symbol, " [",
+                                   window.start, ", ", window.end, "] failed: ", failure);
+            resolve(run, index, Outcome::Failed);
+            continue;
+        }
+
+        std::size_t duplicates = mergeCandles(candles, window.start, window.end);
+        resolve(run, index, Outcome::Fetched, std::move(candles), duplicates);
+    }
+}
+
+/*
+ * @brief Records a window's outcome, then writes and checkpoints every
+ * window of its symbol that is now next in line. After a sink failure
+ * nothing more is written.
+ */
+void Backfill::resolve(Run& run, std::size_t index, Outcome outcome, Candles&& candles, std::size_t duplicates) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    switch (outcome) {
+        case Outcome::Resumed: ++stats_.resumed; break;
+        case Outcome::Fetched: ++stats_.fetched; break;
+        case Outcome::Failed: ++stats_.failed; break;
+    }
+    stats_.duplicates += duplicates;
+    run.state[index] = outcome == Outcome::Fetched ? Run::Ready : Run::Resolved;
+    run.ready[index] = std::move(candles);
+
+    std::size_t group = run.group[index];
+    std::size_t& cursor = run.cursor[group];
+    for (; cursor < run.groupEnd[group] && run.state[cursor] != Run::Pending; ++cursor) {
+        if (run.state[cursor] != Run::Ready || run.error) {
+            continue;
+        }
+        Candles& ready = run.ready[cursor];
+        try {
+            sink_.write(run.plan[cursor], ready);
+            if (run.journal) {
+                run.journal->markDone(run.plan[cursor]);
+            }
+        } catch (const std::exception& e) {
+            Logger::instance().log(LogComponent::Client, LogLevel::Error, "Backfill stopped: ", e.what());
+            run.error = std::current_exception();
+            cancelled_ = true;
+            continue;
+        }
+        ++stats_.written;
+        stats_.candles += ready.size();
+        ready = Candles{};
+    }
+}
@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "candle_store.hpp"
+#include "file_io.hpp"
+
+using string = std::string;
+
+/*--------------------------------------------------------------*/
+/*      On-disk layout. A file is a sequence of blocks, each    */
+/*      a header followed by count values of every column       */
+/*--------------------------------------------------------------*/
+struct BlockHeader {
+    std::uint32_t magic;
+    std::uint32_t count;
+    std::int64_t start;     // covered range, epoch ms
+    std::int64_t end;
+};
+static_assert(sizeof(BlockHeader) == 24, "BlockHeader must stay 8-byte aligned");
+
+static constexpr std::uint32_t blockMagic = 0x42484353;    // "SCHB"
+static constexpr std::size_t bytesPerCandle = 6 * 8;
+
+/*
+ * Calls fn(header, columns) for each complete block and returns the
+ * length of the valid prefix. A torn block from an interrupted append
+ * ends the walk.
+ */
+template <typename Fn>
+static std::size_t forEachBlock(const char* data, std::size_t size, Fn&& fn) {
+    std::size_t offset = 0;
+    while (offset + sizeof(BlockHeader) <= size) {
+        BlockHeader header;
+        std::memcpy(&header, data + offset, sizeof(header));
+        std::size_t length = sizeof(BlockHeader) + header.count * bytesPerCandle;
+        if (header.magic != blockMagic || offset + length > size) {
+            break;
+        }
+        fn(header, data + offset + sizeof(BlockHeader));
+        offset += length;
+    }
+    return offset;
+}
+
+//==============================================================================
+//                                CandleStore
+//==============================================================================
+CandleStore::CandleStore(const string& directory) : directory_{directory} {
+    std::filesystem::create_directories(directory_);
+}
+
+/*
+ * File for a symbol and frequency, e.g. "AAPL_minute1.candles".
+ */
+string CandleStore::path(const string& symbol, const string& frequency) const {
+    string name = symbol + "_" + frequency;
+    for (char& c : name) {
+        bool keep = std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-' || c == '.' || c == '$';
+        if (!keep) c = '_';
+    }
+    return (std::filesystem::path(directory_) / (name + ".candles")).string();
+}
+
+/*
+ * Covered ranges of a file, sorted and merged.
+ */
+std::vector<CandleStore::Range> CandleStore::coverage(const string& file) const {
+    std::vector<Range> ranges;
+    MappedFile mapped{file};
+    forEachBlock(mapped.data(), mapped.size(), [&](const BlockHeader& header, const char*) {
+        ranges.emplace_back(header.start, header.end);
+    });
+
+    std::sort(ranges.begin(), ranges.end());
+    std::vector<Range> merged;
+    for (auto const& r : ranges) {
+        if (!merged.empty() && r.first <= merged.back().second + 1) {
+            merged.back().second = std::max(merged.back().second, r.second);
+        } else {
+            merged.push_back(r);
+        }
+    }
+    return merged;
+}
+
+/*------------------------------*/
+/*      Reads                   */
+/*------------------------------*/
+std::vector<CandleStore::Range> CandleStore::gaps(
+    const string& symbol,
+    const string& frequency,
+    long long start,
+    long long end
+) const {
+    std::vector<Range> covered;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        covered = coverage(path(symbol, frequency));
+    }
+
+    std::vector<Range> missing;
+    long long cursor = start;
+    for (auto const& [from, to] : covered) {
+        if (to < cursor) continue;
+        if (from > end) break;
+        if (from > cursor) missing.emplace_back(cursor, from - 1);
+        cursor = std::max(cursor, to + 1);
+        if (cursor > end) break;
+    }
+    if (cursor <= end) {
+        missing.emplace_back(cursor, end);
+    }
+    return missing;
+}
+
+/*
+ * @brief Reads the stored candles in [start, end] straight from the
+ * mapping into columns. Where blocks overlap, the later block wins.
+ */
+Candles CandleStore::read(
+    const string& symbol,
+    const string& frequency,
+    long long start,
+    long long end,
+    std::pmr::memory_resource* mr
+) const {
+    // (datetime, column base, row) of every candle in range
+    struct Ref {
+        long long datetime;
+        const char* columns;
+        std::uint32_t count;
+        std::uint32_t row;
+    };
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    MappedFile mapped{path(symbol, frequency)};
+    std::vector<Ref> refs;
+    forEachBlock(mapped.data(), mapped.size(), [&](const BlockHeader& header, const char* columns) {
+        if (header.end < start || header.start > end) return;
+        const char* datetimes = columns;
+        for (std::uint32_t i = 0; i < header.count; ++i) {
+            long long dt;
+            std::memcpy(&dt, datetimes + i * 8, 8);
+            if (dt >= start && dt <= end) {
+                refs.push_back(Ref{dt, columns, header.count, i});
+            }
+        }
+    });
+
+    // Later blocks come later in refs, so a stable sort keeps them last
+    std::stable_sort(refs.begin(), refs.end(),
+                     [](const Ref& a, const Ref& b) { return a.datetime < b.datetime; });
+
+    Candles out{mr};
+    out.symbol = symbol;
+    out.reserve(refs.size());
+    for (std::size_t i = 0; i < refs.size(); ++i) {
+        if (i + 1 < refs.size() && refs[i + 1].datetime == refs[i].datetime) {
+            continue;
+        }
+        const Ref& r = refs[i];
+        auto column = [&](int c, auto& value) {
+            std::memcpy(&value, r.columns + (static_cast<std::size_t>(c) * r.count + r.row) * 8, 8);
+        };
+        double o, h, l, c;
+        long long v;
+        column(1, o);
+        column(2, h);
+        column(3, l);
+        column(4, c);
+        column(5, v);
+        out.push_back(r.datetime, o, h, l, c, v);
+    }
+    out.empty = out.size() == 0;
+    return out;
+}
+
+/*------------------------------*/
+/*      Appends                 */
+/*------------------------------*/
+/*
+ * @brief Appends one block holding the candles fetched for [start, end].
+ * A torn block left by a crash is cut off first.
+ */
+void CandleStore::append(
+    const string& symbol,
+    const string& frequency,
+    long long start,
+    long long end,
+    const Candles& candles
+) {
+    std::size_t n = candles.size();
+    BlockHeader header{blockMagic, static_cast<std::uint32_t>(n), start, end};
+
+    string block(sizeof(BlockHeader) + n * bytesPerCandle, '\0');
+    char* p = block.data();
+    std::memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    auto writeColumn = [&](const auto& column) {
+        std::memcpy(p, column.data(), n * 8);
+        p += n * 8;
+    };
+    writeColumn(candles.datetime);
+    writeColumn(candles.open);
+    writeColumn(candles.high);
+    writeColumn(candles.low);
+    writeColumn(candles.close);
+    writeColumn(candles.volume);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    string file = path(symbol, frequency);
+
+    std::size_t valid, size;
+    {
+        MappedFile mapped{file};
+        size = mapped.size();
+        valid = forEachBlock(mapped.data(), mapped.size(), [](const BlockHeader&, const char*) { });
+    }
+
+    int fd = ::open(file.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open " + file + ": " + std::strerror(errno));
+    }
+    if (valid < size && ::ftruncate(fd, static_cast<off_t>(valid)) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Could not repair " + file);
+    }
+    ::lseek(fd, static_cast<off_t>(valid), SEEK_SET);
+
+    try {
+        writeAll(fd, block.data(), block.size(), file);
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+}
+
+//==============================================================================
+//                                candleSeries
+//==============================================================================
+string candleSeries(const std::map<string, string>& params) {
+    auto param = [&](const string& key, const string& fallback) {
+        auto it = params.find(key);
+        return it == params.end() ? fallback : it->second;
+    };
+    string series = param("frequencyType", "default") + param("frequency", "1");
+    string periodType = param("periodType", "");
+    if (!periodType.empty()) {
+        series += "-" + periodType;
+    }
+    if (param("needExtendedHoursData", "false") == "true") {
+        series += "-ext";
+    }
+    return series;
+}
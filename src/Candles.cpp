@@ -0,0 +1,157 @@
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <nlohmann/json.hpp>
+
+#include "candles.hpp"
+
+using string = std::string;
+using json = nlohmann::json;
+
+//==============================================================================
+//                                Candles
+//==============================================================================
+void Candles::reserve(std::size_t n) {
+    datetime.reserve(n);
+    open.reserve(n);
+    high.reserve(n);
+    low.reserve(n);
+    close.reserve(n);
+    volume.reserve(n);
+}
+
+void Candles::clear() {
+    datetime.clear();
+    open.clear();
+    high.clear();
+    low.clear();
+    close.clear();
+    volume.clear();
+}
+
+void Candles::push_back(long long dt, double o, double h, double l, double c, long long v) {
+    datetime.push_back(dt);
+    open.push_back(o);
+    high.push_back(h);
+    low.push_back(l);
+    close.push_back(c);
+    volume.push_back(v);
+}
+
+void Candles::pop_back() {
+    datetime.pop_back();
+    open.pop_back();
+    high.pop_back();
+    low.pop_back();
+    close.pop_back();
+    volume.pop_back();
+}
+
+/*--------------------------------------------------------------*/
+/*      SAX handler that fills Candles columns as the parser    */
+/*      walks the response, so no json DOM is ever built        */
+/*--------------------------------------------------------------*/
+class CandlesSax {
+    public:
+        explicit CandlesSax(Candles& out) : out_{out} { }
+
+        bool null() { return true; }
+        bool boolean(bool val) {
+            if (depth_ == 1 && key_ == "empty") out_.empty = val;
+            return true;
+        }
+        bool number_integer(json::number_integer_t val) { return number(static_cast<double>(val), val); }
+        bool number_unsigned(json::number_unsigned_t val) {
+            return number(static_cast<double>(val), static_cast<long long>(val));
+        }
+        bool number_float(json::number_float_t val, const json::string_t&) {
+            return number(val, static_cast<long long>(val));
+        }
+        bool string(json::string_t& val) {
+            if (depth_ == 1 && key_ == "symbol") out_.symbol = val;
+            return true;
+        }
+        bool binary(json::binary_t&) { return true; }
+
+        bool start_object(std::size_t) {
+            ++depth_;
+            if (inCandles_ && depth_ == 3) row_ = Row{};
+            return true;
+        }
+        bool end_object() {
+            if (inCandles_ && depth_ == 3) {
+                out_.push_back(row_.datetime, row_.open, row_.high, row_.low, row_.close, row_.volume);
+            }
+            --depth_;
+            return true;
+        }
+        bool start_array(std::size_t) {
+            ++depth_;
+            if (depth_ == 2 && key_ == "candles") inCandles_ = true;
+            return true;
+        }
+        bool end_array() {
+            if (inCandles_ && depth_ == 2) inCandles_ = false;
+            --depth_;
+            return true;
+        }
+        bool key(json::string_t& val) {
+            key_ = val;
+            return true;
+        }
+
+        bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& ex) {
+            throw std::runtime_error("Bad priceHistory response at byte "
+                                     + std::to_string(position) + ": " + ex.what());
+        }
+
+    private:
+        struct Row {
+            long long datetime = 0;
+            double open = NAN, high = NAN, low = NAN, close = NAN;
+            long long volume = 0;
+        };
+
+        bool number(double asDouble, long long asInteger) {
+            if (!inCandles_ || depth_ != 3) return true;
+            if (key_ == "open") row_.open = asDouble;
+            else if (key_ == "high") row_.high = asDouble;
+            else if (key_ == "low") row_.low = asDouble;
+            else if (key_ == "close") row_.close = asDouble;
+            else if (key_ == "volume") row_.volume = asInteger;
+            else if (key_ == "datetime") row_.datetime = asInteger;
+            return true;
+        }
+
+        Candles& out_;
+        std::size_t depth_ = 0;
+        bool inCandles_ = false;
+        json::string_t key_;
+        Row row_;
+};
+
+/*
+ * @brief Parses a pricehistory response into columns. Every candle
+ * gets one entry in each column; missing prices are NaN. Throws on
+ * malformed input.
+ */
+Candles parseCandles(std::string_view body, std::pmr::memory_resource* mr) {
+    Candles out{mr};
+    if (body.empty()) {
+        return out;
+    }
+
+    // One "datetime" key per candle, so size the columns up front
+    std::size_t count = 0;
+    for (auto pos = body.find("\"datetime\""); pos != std::string_view::npos;
+         pos = body.find("\"datetime\"", pos + 10)) {
+        ++count;
+    }
+    out.reserve(count);
+
+    CandlesSax sax{out};
+    json::sax_parse(body.begin(), body.end(), &sax);
+    return out;
+}
@@ -1,14 +1,25 @@
-#include <iomanip>
-#include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <exception>
+#include <condition_variable>
+#include <functional>
+#include <future>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <set>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include <curl/curl.h>
 
+#include "endpoint_schema.hpp"
+#include "quote_batches.hpp"
 #include "schwab_api.hpp"
 #include "utils.hpp"
 
@@ -26,12 +37,88 @@ Client::Client(
     const string appSecret,
     const string callbackUrl,
     const string tokensFile,
-    const std::chrono::milliseconds timeoutMs
+    const std::chrono::milliseconds timeoutMs,
+    const std::size_t poolSize,
+    const string baseUrl
 )   : timeoutMs_(timeoutMs),
-    tokens_{appKey, appSecret, callbackUrl, tokensFile, true} // sets autoRefresh to true
-{ }
+    baseUrl_{baseUrl},
+    tokens_{std::make_unique<Tokens>(appKey, appSecret, callbackUrl, tokensFile, true, baseUrl, &metrics_)}, // autoRefresh on
+    pool_{poolSize},
+    loop_{pool_, limiter_}
+{
+    setDefaultTtls();
+}
+
+Client::Client(const string replayArchive, const std::size_t poolSize)
+    : timeoutMs_{0},
+    baseUrl_{schwabBaseUrl},
+    transport_{Transport::Replay},
+    archive_{std::make_unique<ResponseArchive>(replayArchive, ResponseArchive::Mode::Replay)},
+    pool_{poolSize},
+    loop_{pool_, limiter_}
+{
+    setDefaultTtls();
+}
+
+/*
+ * Stops the off-loop thread once it has run what is queued, so no
+ * request is left without its completion.
+ */
+Client::~Client() {
+    {
+        std::lock_guard<std::mutex> lock(offLoopMutex_);
+        offLoopStopping_ = true;
+    }
+    offLoopWake_.notify_all();
+    if (offLoopThread_.joinable()) {
+        offLoopThread_.join();
+    }
+}
+
+void Client::setDefaultTtls() {
+    // Slow-changing endpoints; see cache() to change or disable
+    cache_.setTtl("marketHours", std::chrono::hours(6));
+    cache_.setTtl("optionExpirationChains", std::chrono::hours(1));
+    cache_.setTtl("instruments", std::chrono::hours(24));
+}
+
+/*----------------------*/
+/*      Transport       */
+/*----------------------*/
+/*
+ * @brief Selects where requests go. Record appends every response to
+ * archivePath; Replay serves responses from archivePath in the order
+ * they were recorded, without rate limiting or network access.
+ */
+void Client::setTransport(Transport mode, const string& archivePath) {
+    if (mode != Transport::Replay && !tokens_) {
+        throw std::runtime_error("This client was created for replay and has no tokens");
+    }
+    if (mode == Transport::Live) {
+        archive_.reset();
+    } else {
+        auto archiveMode = mode == Transport::Record ? ResponseArchive::Mode::Record
+                                                     : ResponseArchive::Mode::Replay;
+        archive_ = std::make_unique<ResponseArchive>(archivePath, archiveMode);
+    }
+    transport_ = mode;
+}
+
+/*
+ * Archives are keyed by the URL below baseUrl_, so a recording replays
+ * regardless of which server it was made against.
+ */
+std::string_view Client::archiveKey(const string& fullUrl) const {
+    return std::string_view(fullUrl).substr(std::min(baseUrl_.size(), fullUrl.size()));
+}
 
-Client::~Client() = default;
+ResponseArchive::Response Client::replayed(const string& fullUrl) {
+    auto response = archive_->next(archiveKey(fullUrl));
+    if (!response) {
+        throw std::runtime_error("No recorded response for " + fullUrl);
+    }
+    return *response;
+}
 
 /*------------------------------*/
 /*      Time conversions        */
@@ -40,105 +127,741 @@ Client::~Client() = default;
  * Converts "dd-mm-yyyy HH:MM:SS" to milliseconds since Unix epoch 
  */
 long long Client::datetimeToEpoch(const std::string& datetime) {
-    std::istringstream in{datetime};
-    std::tm tm{};  
-    in >> std::get_time(&tm, "%d-%m-%Y %H:%M:%S");
-    if (in.fail()) {
+    long long epochMs = parseEpochMs(datetime, DateFormat::DateTime);
+    if (epochMs == invalidEpoch) {
         throw std::runtime_error("Bad dateTime: " + datetime);
     }
-    tm.tm_isdst = 0;    // ensure deterministic behavior
-
-    return static_cast<long long>(timegm(&tm)) * 1000LL;
+    return epochMs;
 }
 
 /* 
  * Converts "dd-mm-yyyy" to milliseconds since Unix epoch 
  */
 long long Client::dateToEpoch(const std::string& date) {
-    return datetimeToEpoch(date + " 00:00:00");
+    long long epochMs = parseEpochMs(date, DateFormat::Date);
+    if (epochMs == invalidEpoch) {
+        throw std::runtime_error("Bad date: " + date);
+    }
+    return epochMs;
+}
+
+/*
+ * Reads a date param given as epoch ms or as "dd-mm-yyyy".
+ */
+long long Client::paramToEpoch(const string& value) {
+    bool digits = !value.empty() &&
+        std::all_of(value.begin(), value.end(), [](unsigned char c) { return std::isdigit(c); });
+    return digits ? std::stoll(value) : dateToEpoch(value);
 }
 
 /*------------------------------------*/
 /*      Request helper methods        */
 /*------------------------------------*/
-/* 
- * Checks params map contains required arguments 
+/*
+ * Reports why a request's params were rejected.
  */
-bool Client::containsReqArgs(const std::map<string, string>& params, const std::set<string>& reqArgs) {
-    for (auto const& key : reqArgs) {
-        if (params.find(key) == params.end()) {
-            return false;
-        }
+static void logInvalid(std::string_view endpoint, const SchemaError& error) {
+    Logger::instance().log(LogComponent::Client, LogLevel::Warn,
+                           "Invalid params to ", endpoint, ": ", error.what(), error.key);
+}
+
+/*
+ * Checks the params set on url against its schema and builds the URL
+ * into out. Leaves out empty and returns false when they are invalid.
+ */
+template <const auto& Schema>
+static bool checkedUrl(const EndpointUrl<Schema>& url, const string& baseUrl, string& out) {
+    if (SchemaError error = url.check()) {
+        logInvalid(Schema.name(), error);
+        out.clear();
+        return false;
     }
+    url.build(baseUrl, out);
     return true;
 }
 
+template <const auto& Schema>
+static string checkedUrl(const EndpointUrl<Schema>& url, const string& baseUrl) {
+    string out;
+    checkedUrl(url, baseUrl, out);
+    return out;
+}
+
 /*
- * Checks keys in param map are valid 
+ * Validates a params map against Schema and builds its URL into out.
+ * Returns false when the params are invalid.
  */
-bool validKeys(const std::map<string, string>& params, const std::set<string>& valKeys) {
-    // Check params for correct arg names
-    for (auto const& [key, value] : params) {
-        if (valKeys.find(key) == valKeys.end()) {
-            std::cout << "Invalid key!: " << key << std::endl << std::flush;
-            return false;
-        }
+template <const auto& Schema>
+static bool checkedUrl(const std::map<string, string>& params, const string& baseUrl, string& out) {
+    EndpointUrl<Schema> url;
+    if (SchemaError error = url.set(params)) {
+        logInvalid(Schema.name(), error);
+        out.clear();
+        return false;
     }
-    return true;
+    return checkedUrl(url, baseUrl, out);
+}
+
+/*
+ * The URL of the calling thread's last buffered request; its capacity
+ * is kept, so the buffer overloads build their URLs without allocating.
+ */
+static string& requestUrl() {
+    static thread_local string url;
+    return url;
+}
+
+string Client::priceHistoryUrl(const std::map<string, string>& params) {
+    string url;
+    priceHistoryUrl(params, url);
+    return url;
+}
+
+bool Client::priceHistoryUrl(const std::map<string, string>& params, string& url) {
+    return checkedUrl<priceHistorySchema>(params, baseUrl_, url);
+}
+
+string Client::optionChainsUrl(const std::map<string, string>& params) {
+    string url;
+    optionChainsUrl(params, url);
+    return url;
+}
+
+bool Client::optionChainsUrl(const std::map<string, string>& params, string& url) {
+    return checkedUrl<optionChainsSchema>(params, baseUrl_, url);
+}
+
+/*
+ * Builds the multi-symbol quotes URL.
+ */
+string Client::quotesUrl(const string& symbols, const string& fields, const bool& indicative) {
+    string url;
+    quotesUrl(symbols, fields, indicative, url);
+    return url;
+}
+
+bool Client::quotesUrl(const string& symbols, const string& fields, const bool& indicative, string& url) {
+    EndpointUrl<quotesSchema> endpoint;
+    endpoint.set("symbols", symbols).set("indicative", indicative);
+    if (fields != "ALL") {
+        endpoint.set("fields", fields);
+    }
+    return checkedUrl(endpoint, baseUrl_, url);
+}
+
+/*
+ * Builds the single-symbol quote URL.
+ */
+bool Client::quoteUrl(const string& symbol, const string& fields, string& url) {
+    EndpointUrl<quoteSchema> endpoint;
+    endpoint.set("symbol_id", symbol);
+    if (fields != "ALL") {
+        endpoint.set("fields", fields);
+    }
+    return checkedUrl(endpoint, baseUrl_, url);
+}
+
+bool Client::moversUrl(const string& indexSymbol, const string& sort, const int& frequency, string& url) {
+    EndpointUrl<moversSchema> endpoint;
+    endpoint.set("symbol_id", indexSymbol).set("frequency", frequency);
+    if (sort != "NONE") {
+        endpoint.set("sort", sort);
+    }
+    return checkedUrl(endpoint, baseUrl_, url);
+}
+
+/*
+ * @brief The header list for the current access token. Built on the
+ * first request after each token rotation and shared by every request
+ * until the next, so steady-state requests build no headers. Waits for
+ * the tokens like Tokens::accessToken().
+ */
+std::shared_ptr<const Client::AuthHeaders> Client::currentHeaders() {
+    auto token = tokens_->readySnapshot();
+    auto headers = authHeaders_.load(std::memory_order_acquire);
+    if (headers && headers->token == token) {
+        return headers;
+    }
+    auto fresh = std::make_shared<AuthHeaders>();
+    fresh->token = token;
+    fresh->list = authHeaders(token->accessToken);
+    if (!fresh->list) {
+        throw std::runtime_error("Failed to build request headers");
+    }
+    authHeaders_.store(fresh, std::memory_order_release);
+    return fresh;
 }
 
 /*
- * @brief Perfroms a get request, and reports any errors.
+ * @brief Sets the URL, headers and timeout on a handle, and points the
+ * body at the handle's reusable response buffer, emptied here. Shared by
+ * the blocking and asynchronous request paths; the caller keeps headers
+ * alive until the transfer is done. The timeout is cut to what is left
+ * before deadline, counted from notBefore if that is later.
  */
-string Client::httpGet(const string& fullUrl, CURL* curl) {
+void Client::prepareGet(
+    CURL* curl,
+    const string& fullUrl,
+    struct curl_slist* headers,
+    DeadlineScope::Clock::time_point deadline,
+    DeadlineScope::Clock::time_point notBefore
+) {
     // Response body buffer
-    string body;
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curlCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &body);
-
-    // Auth header
-    struct curl_slist* headers = nullptr;
-    string auth = "Authorization: Bearer " + tokens_.accessToken();
-    headers = curl_slist_append(headers, auth.c_str());
-    headers = curl_slist_append(headers, "Accept: application/json");
+    ConnectionPool::responseBuffer(curl).clear();
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, ConnectionPool::writeToBuffer);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, curl);
+
+    // Auth header, shared with other requests
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
 
-    // Core options
+    // Core options; a timeout of 0 means none to curl, so never go below 1 ms
+    long timeoutMs = static_cast<long>(timeoutMs_.count());
+    if (deadline != DeadlineScope::Clock::time_point::max()) {
+        auto from = std::max(DeadlineScope::Clock::now(), notBefore);
+        long left = static_cast<long>(std::chrono::ceil<std::chrono::milliseconds>(deadline - from).count());
+        timeoutMs = std::max(1L, timeoutMs > 0 ? std::min(timeoutMs, left) : left);
+    }
     curl_easy_setopt(curl, CURLOPT_URL, fullUrl.c_str());
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS,
-                     static_cast<long>(timeoutMs_.count()));
-    //curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");  // UN-COMMENT FOR DEBUGGING PURPOSES
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeoutMs);
 
-    std::cout << fullUrl << std::endl << std::flush;
+    // libcurl's own trace, only at http=trace
+    Logger& logger = Logger::instance();
+    if (logger.enabled(LogComponent::Http, LogLevel::Trace)) {
+        curl_easy_setopt(curl, CURLOPT_DEBUGFUNCTION, curlDebugLog);
+        curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
+    }
+    logger.log(LogComponent::Http, LogLevel::Debug, "GET ", fullUrl);
+}
 
-    // Perform and check for timeout
-    CURLcode rc = curl_easy_perform(curl);
+/*
+ * @brief Checks the result of a finished transfer. A timeout is reported
+ * and returns false, for an empty body; any other curl error throws.
+ */
+bool Client::checkResult(CURLcode rc) {
     if (rc == CURLE_OPERATION_TIMEDOUT) {
-        std::cerr << "Request timed out after "
-                  << timeoutMs_.count() << "ms\n";
-        // clean up before returning
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-        return "";  // or some sentinel
+        Logger::instance().log(LogComponent::Http, LogLevel::Warn,
+                               "Request timed out (limit ", timeoutMs_.count(), "ms, or the call's deadline)");
+        return false;
     }
     else if (rc != CURLE_OK) {
         // any other curl error
         std::ostringstream err;
         err << "curl_easy_perform() failed: "
             << curl_easy_strerror(rc);
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
         throw std::runtime_error(err.str());
     }
+    return true;
+}
 
-    // Cleanup
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
+/*
+ * @brief Decides whether a finished attempt is tried again: the policy
+ * must call it retryable, attempts must remain, and the backoff (or the
+ * server's Retry-After, if longer) must end before the deadline. Sets
+ * delay to the wait before the next attempt.
+ */
+bool Client::shouldRetry(
+    EndpointMetrics& metrics,
+    const AttemptState& state,
+    CURLcode rc,
+    long status,
+    std::chrono::seconds retryAfter,
+    DeadlineScope::Clock::duration& delay
+) {
+    if (state.number >= retry_.maxAttempts || !retry_.retryable(rc, status)) {
+        return false;
+    }
+    delay = std::max<DeadlineScope::Clock::duration>(retry_.backoff(state.number), retryAfter);
+    if (DeadlineScope::Clock::now() + delay >= state.deadline) {
+        return false;
+    }
+    metrics.errorRetried();
+    string reason = rc == CURLE_OK ? "HTTP " + std::to_string(status) : string(curl_easy_strerror(rc));
+    Logger::instance().log(LogComponent::Http, LogLevel::Info, "Retrying ", metrics.name(), " request in ",
+                           std::chrono::duration_cast<std::chrono::milliseconds>(delay).count(), "ms after ",
+                           reason);
+    return true;
+}
 
+/*
+ * How long an attempt may go unanswered before it is hedged, from the
+ * endpoint's observed latency. Zero when hedging is off or too few
+ * requests have been timed yet.
+ */
+DeadlineScope::Clock::duration Client::hedgeDelay(const EndpointMetrics& metrics) const {
+    if (!hedge_.enabled) {
+        return DeadlineScope::Clock::duration::zero();
+    }
+    HistogramSnapshot total = metrics.total().snapshot();
+    if (total.count < hedge_.minSamples) {
+        return DeadlineScope::Clock::duration::zero();
+    }
+    auto quantile = std::chrono::microseconds(static_cast<long long>(total.percentileUs(hedge_.quantile)));
+    return std::max<DeadlineScope::Clock::duration>(hedge_.minDelay, quantile);
+}
+
+/*
+ * @brief Runs one attempt on curl. With hedging on, the attempt is driven
+ * through a private multi handle; if it is still unanswered after the
+ * hedge delay, a duplicate goes out on a spare pooled handle (held by
+ * hedge) and the first to finish is kept. The other is aborted.
+ */
+Client::Attempt Client::perform(
+    CURL* curl,
+    const string& fullUrl,
+    struct curl_slist* headers,
+    const AttemptState& state,
+    EndpointMetrics& metrics,
+    ConnectionPool::Lease& hedge
+) {
+    Attempt result;
+    result.curl = curl;
+    prepareGet(curl, fullUrl, headers, state.deadline);
+
+    DeadlineScope::Clock::duration hedgeAfter = hedgeDelay(metrics);
+    if (hedgeAfter == DeadlineScope::Clock::duration::zero()) {
+        result.rc = curl_easy_perform(curl);
+    } else {
+        CURLM* multi = curl_multi_init();
+        if (!multi) {
+            throw std::runtime_error("Failed to init libcurl multi handle");
+        }
+        curl_multi_add_handle(multi, curl);
+        auto hedgeAt = DeadlineScope::Clock::now() + hedgeAfter;
+
+        for (bool finished = false; !finished; ) {
+            int running = 0;
+            curl_multi_perform(multi, &running);
+            int queued = 0;
+            while (CURLMsg* msg = curl_multi_info_read(multi, &queued)) {
+                if (msg->msg == CURLMSG_DONE && !finished) {
+                    finished = true;
+                    result.curl = msg->easy_handle;
+                    result.rc = msg->data.result;
+                }
+            }
+            if (finished) {
+                break;
+            }
+
+            // One hedge at most, and only with a spare handle and token
+            auto now = DeadlineScope::Clock::now();
+            if (now >= hedgeAt) {
+                hedgeAt = DeadlineScope::Clock::time_point::max();
+                hedge = pool_.tryAcquire();
+                RateLimiter::Clock::duration retryIn{};
+                if (hedge.get() && limiter_.tryAcquire(state.priority, now, retryIn)) {
+                    prepareGet(hedge.get(), fullUrl, headers, state.deadline);
+                    curl_multi_add_handle(multi, hedge.get());
+                    metrics.hedged();
+                } else {
+                    hedge = ConnectionPool::Lease{nullptr, nullptr};
+                }
+            }
+            long waitMs = 1000;
+            if (hedgeAt != DeadlineScope::Clock::time_point::max()) {
+                auto untilHedge = std::chrono::ceil<std::chrono::milliseconds>(hedgeAt - now).count();
+                waitMs = std::clamp<long>(static_cast<long>(untilHedge), 1, 1000);
+            }
+            curl_multi_poll(multi, nullptr, 0, static_cast<int>(waitMs), nullptr);
+        }
+
+        curl_multi_remove_handle(multi, curl);
+        if (hedge.get()) {
+            curl_multi_remove_handle(multi, hedge.get());
+            if (result.curl == hedge.get()) {
+                metrics.hedgeWon();
+            }
+        }
+        curl_multi_cleanup(multi);
+    }
+
+    curl_easy_getinfo(result.curl, CURLINFO_RESPONSE_CODE, &result.status);
+    curl_off_t retryAfter = 0;
+    if (curl_easy_getinfo(result.curl, CURLINFO_RETRY_AFTER, &retryAfter) == CURLE_OK && retryAfter > 0) {
+        result.retryAfter = std::chrono::seconds{retryAfter};
+    }
+    return result;
+}
+
+/*
+ * @brief Perfroms a get request on a pooled handle, and reports any errors.
+ * The body is written into out, reusing its capacity.
+ * The handle stays open so its connection can be reused by the next request.
+ * Waits for the rate limiter first; priority is the endpoint's default,
+ * which a PriorityScope on the calling thread overrides. A 401 triggers
+ * one token refresh and a transparent retry. 5xx, 429, timeouts and
+ * dropped connections are retried under the retry policy, within the
+ * DeadlineScope's deadline; a call out of time returns "" like a timeout.
+ * Each attempt checks out a pooled handle once the limiter lets it
+ * through, and gives it back before waiting out a retry's backoff.
+ *
+ * @param status: set to the final response's HTTP status, if given
+ */
+template <typename Body>
+void Client::httpGetInto(const string& fullUrl, Priority priority, Body& out, long* status) {
+    out.clear();
+    if (status) {
+        *status = 0;
+    }
+    if (transport_ == Transport::Replay) {
+        auto body = replayed(fullUrl).body;
+        out.assign(body.data(), body.size());
+        return;
+    }
+
+    AttemptState state{PriorityScope::resolve(priority), DeadlineScope::current()};
+    EndpointMetrics& metrics = metrics_.endpoint(fullUrl);
+    auto headers = currentHeaders();
+    for (;;) {
+        // Queues no longer than the deadline, without spending a token
+        if (!limiter_.acquireUntil(state.priority, state.deadline)
+                || DeadlineScope::Clock::now() >= state.deadline) {
+            metrics.deadlineExceeded();
+            Logger::instance().log(LogComponent::Http, LogLevel::Warn, "Deadline passed before ",
+                                   metrics.name(), " attempt ", state.number, " could be sent");
+            return;
+        }
+
+        // Take a handle only with a token in hand, so callers queued in the
+        // limiter hold none and a later High request is not left waiting
+        // on the pool behind them
+        ConnectionPool::Lease handle = pool_.acquire();
+        ConnectionPool::Lease hedge{nullptr, nullptr};
+        Attempt attempt = perform(handle.get(), fullUrl, headers->list, state, metrics, hedge);
+        metrics.record(attempt.curl, attempt.rc, attempt.status);
+        if (attempt.rc == CURLE_OK && attempt.status == 401 && !state.refreshed
+                && tokens_->refreshIfStale(headers->token->accessToken)) {
+            state.refreshed = true;
+            metrics.retried();
+            headers = currentHeaders();
+            continue;
+        }
+        DeadlineScope::Clock::duration delay{};
+        if (shouldRetry(metrics, state, attempt.rc, attempt.status, attempt.retryAfter, delay)) {
+            ++state.number;
+            hedge = ConnectionPool::Lease{nullptr, nullptr};
+            handle = ConnectionPool::Lease{nullptr, nullptr};
+            std::this_thread::sleep_for(delay);
+            continue;
+        }
+
+        if (attempt.rc == CURLE_OPERATION_TIMEDOUT && DeadlineScope::Clock::now() >= state.deadline) {
+            metrics.deadlineExceeded();
+        }
+        if (status) {
+            *status = attempt.status;
+        }
+        const string& buffer = ConnectionPool::responseBuffer(attempt.curl);
+        if (attempt.rc == CURLE_OK && transport_ == Transport::Record) {
+            archive_->append(archiveKey(fullUrl), attempt.status, buffer);
+        }
+        if (checkResult(attempt.rc)) {
+            out.assign(buffer.data(), buffer.size());
+        }
+        return;
+    }
+}
+
+string Client::httpGet(const string& fullUrl, Priority priority, long* status) {
+    string body;
+    httpGetInto(fullUrl, priority, body, status);
+    return body;
+}
+
+/*
+ * Buffered get on a pooled handle, for the overloads writing into out.
+ */
+std::string_view Client::fetchInto(const string& fullUrl, Priority priority, std::pmr::string& out) {
+    httpGetInto(fullUrl, priority, out);
+    return out;
+}
+
+/*
+ * @brief Get request served from the response cache when the url was
+ * fetched within the endpoint's ttl. Only 200 responses are cached.
+ */
+string Client::cachedGet(const string& endpoint, const string& fullUrl) {
+    if (auto cached = cache_.get(fullUrl)) {
+        return *cached;
+    }
+
+    long status = 0;
+    string body = httpGet(fullUrl, Priority::Normal, &status);
+    if (status == 200 && !body.empty()) {
+        cache_.put(endpoint, fullUrl, body);
+    }
     return body;
 }
 
+/*
+ * @brief Starts a get request on the request loop and returns at once.
+ * done receives the status and body, or the error httpGet would have
+ * thrown. The priority and deadline are taken from the calling thread's
+ * scopes.
+ */
+void Client::submitGet(CURL* curl, const string& fullUrl, StatusCallback done, Priority priority) {
+    if (transport_ == Transport::Replay) {
+        loop_.checkin(curl);
+        long status = 0;
+        string body;
+        std::exception_ptr error;
+        try {
+            auto response = replayed(fullUrl);
+            status = response.status;
+            body = response.body;
+        } catch (...) {
+            error = std::current_exception();
+        }
+        loop_.post([done = std::move(done), status, body = std::move(body), error] { done(status, body, error); });
+        return;
+    }
+    submitAttempt(curl, fullUrl, std::move(done), {PriorityScope::resolve(priority), DeadlineScope::current()});
+}
+
+/*
+ * @brief Queues one attempt of an asynchronous get, sent no earlier than
+ * notBefore. A 401 is retried once after a token refresh, and failures
+ * under the retry policy after their backoff, like httpGet. The refresh
+ * blocks, so it runs off the loop thread. An attempt still queued at the
+ * deadline is not sent.
+ */
+void Client::submitAttempt(
+    CURL* curl,
+    const string& fullUrl,
+    StatusCallback&& done,
+    AttemptState state,
+    RateLimiter::Clock::time_point notBefore
+) {
+    auto headers = currentHeaders();
+    auto transfer = std::make_unique<RequestLoop::Transfer>();
+    RequestLoop::Transfer* self = transfer.get();
+    transfer->curl = curl;
+    transfer->priority = state.priority;
+    transfer->metrics = &metrics_.endpoint(fullUrl);
+    transfer->notBefore = notBefore;
+    transfer->deadline = state.deadline;
+    transfer->headers = std::shared_ptr<struct curl_slist>(headers, headers->list);
+    prepareGet(curl, fullUrl, headers->list, state.deadline, notBefore);
+    transfer->done = [this, fullUrl, token = headers->token, state, self, done = std::move(done)]
+                     (CURLcode rc, long status, string&& body) mutable {
+        EndpointMetrics& metrics = metrics_.endpoint(fullUrl);
+        if (rc == CURLE_OK && status == 401 && !state.refreshed) {
+            state.refreshed = true;
+            runOffLoop([this, fullUrl, token, state, status, body = std::move(body), done = std::move(done)]() mutable {
+                if (tokens_->refreshIfStale(token->accessToken)) {
+                    metrics_.endpoint(fullUrl).retried();
+                    resubmit(fullUrl, done, state);
+                    return;
+                }
+                finishGet(fullUrl, CURLE_OK, status, body, done);
+            });
+            return;
+        }
+        RateLimiter::Clock::duration delay{};
+        if (shouldRetry(metrics, state, rc, status, self->retryAfter, delay)) {
+            ++state.number;
+            resubmit(fullUrl, done, state, RateLimiter::Clock::now() + delay);
+            return;
+        }
+        if (rc == CURLE_OPERATION_TIMEDOUT && RateLimiter::Clock::now() >= state.deadline) {
+            metrics.deadlineExceeded();
+        }
+        finishGet(fullUrl, rc, status, body, done);
+    };
+    loop_.submit(std::move(transfer));
+}
+
+/*
+ * Queues the next attempt on a fresh handle. If it cannot be queued, e.g.
+ * because no token can be had, the request ends with that error.
+ */
+void Client::resubmit(
+    const string& fullUrl,
+    StatusCallback& done,
+    AttemptState state,
+    RateLimiter::Clock::time_point notBefore
+) {
+    CURL* curl = loop_.checkout();
+    try {
+        submitAttempt(curl, fullUrl, std::move(done), state, notBefore);
+    } catch (...) {
+        if (done) {                     // thrown before the transfer took it over
+            loop_.checkin(curl);
+            done(0, "", std::current_exception());
+        }
+    }
+}
+
+/*
+ * Records a final response and hands it to done, with checkResult's
+ * error for a failed transfer.
+ */
+void Client::finishGet(const string& fullUrl, CURLcode rc, long status, string& body, const StatusCallback& done) {
+    if (rc == CURLE_OK && transport_ == Transport::Record) {
+        archive_->append(archiveKey(fullUrl), status, body);
+    }
+    try {
+        if (!checkResult(rc)) {
+            body.clear();
+        }
+    } catch (...) {
+        done(status, "", std::current_exception());
+        return;
+    }
+    done(status, body, nullptr);
+}
+
+void Client::runOffLoop(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(offLoopMutex_);
+        if (!offLoopStopping_) {
+            if (!offLoopThread_.joinable()) {
+                offLoopThread_ = std::thread(&Client::offLoopRun, this);
+            }
+            offLoopTasks_.push_back(std::move(task));
+            offLoopWake_.notify_one();
+            return;
+        }
+    }
+    task();
+}
+
+void Client::offLoopRun() {
+    std::unique_lock<std::mutex> lock(offLoopMutex_);
+    while (true) {
+        offLoopWake_.wait(lock, [this] { return offLoopStopping_ || !offLoopTasks_.empty(); });
+        if (offLoopTasks_.empty()) {
+            return;                     // stopping, and everything queued has run
+        }
+        auto task = std::move(offLoopTasks_.front());
+        offLoopTasks_.pop_front();
+        lock.unlock();
+        try {
+            task();
+        } catch (const std::exception& e) {
+            Logger::instance().log(LogComponent::Client, LogLevel::Error, "Off-loop task threw: ", e.what());
+        } catch (...) {
+            Logger::instance().log(LogComponent::Client, LogLevel::Error, "Off-loop task threw");
+        }
+        lock.lock();
+    }
+}
+
+/*
+ * @brief Runs count requests with at most maxInFlight outstanding at once
+ * and blocks until all are done. start(i, done) issues request i; each
+ * completion starts the next one, from the loop thread or from the
+ * caller's. Returns every request's status, body and error, in order.
+ */
+std::vector<Client::Fetched> Client::fanOut(
+    std::size_t count,
+    std::size_t maxInFlight,
+    const std::function<void(std::size_t, StatusCallback)>& start
+) {
+    struct State : std::enable_shared_from_this<State> {
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::vector<Fetched> results;
+        std::size_t next = 0;
+        std::size_t inFlight = 0;
+        std::size_t remaining = 0;
+        std::size_t maxInFlight = 1;
+        bool launching = false;             // some thread is in launch
+        std::function<void()> launch;
+    };
+    auto state = std::make_shared<State>();
+    state->results.resize(count);
+    state->remaining = count;
+    state->maxInFlight = std::max<std::size_t>(maxInFlight, 1);
+    if (count == 0) {
+        return {};
+    }
+
+    // Starts requests until maxInFlight are outstanding. Only one thread
+    // launches at a time; a completion arriving meanwhile, including one
+    // that finished synchronously inside start(), leaves its free slot to
+    // that thread's loop instead of recursing. start is only called while
+    // requests remain, so while this call is still waiting
+    State* shared = state.get();            // completions keep it alive
+    state->launch = [shared, &start]() {
+        State* state = shared;
+        std::unique_lock<std::mutex> lock(state->mutex);
+        if (state->launching) {
+            return;
+        }
+        state->launching = true;
+        while (state->next < state->results.size() && state->inFlight < state->maxInFlight) {
+            std::size_t i = state->next++;
+            ++state->inFlight;
+            lock.unlock();
+
+            auto done = [state = state->shared_from_this(), i](long status, const string& body,
+                                                               std::exception_ptr error) {
+                bool last;
+                {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    state->results[i] = {status, body, error};
+                    --state->inFlight;
+                    last = --state->remaining == 0;
+                }
+                if (last) {
+                    state->finished.notify_all();
+                    return;
+                }
+                state->launch();
+            };
+            try {
+                start(i, done);
+            } catch (...) {
+                done(0, "", std::current_exception());
+            }
+            lock.lock();
+        }
+        state->launching = false;
+    };
+    state->launch();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&] { return state->remaining == 0; });
+    return std::move(state->results);
+}
+
+/*
+ * @brief Runs fetch for fullUrl unless the same url is already being
+ * fetched, in which case it waits and shares that result. Each call that
+ * joins another is counted on the endpoint as a request saved. A joiner
+ * waits no longer than its own DeadlineScope, then gets an empty result
+ * like a timed out request.
+ */
+template <typename Value, typename Fetch>
+static std::shared_ptr<const Value> joinFlight(
+    SingleFlight<Value>& flights,
+    EndpointMetrics& metrics,
+    const string& fullUrl,
+    Fetch&& fetch
+) {
+    bool joined = false;
+    auto result = flights.run(fullUrl, std::forward<Fetch>(fetch), &joined, DeadlineScope::current());
+    if (joined) {
+        metrics.coalesced();
+    }
+    if (!result) {
+        metrics.deadlineExceeded();
+        Logger::instance().log(LogComponent::Http, LogLevel::Warn, "Deadline passed waiting on a shared ",
+                               metrics.name(), " request");
+        return std::make_shared<const Value>();
+    }
+    return result;
+}
+
+SingleFlightStats Client::singleFlightStats() const {
+    SingleFlightStats total = bodyFlights_.stats();
+    for (auto stats : {candleFlights_.stats(), chainFlights_.stats()}) {
+        total.calls += stats.calls;
+        total.shared += stats.shared;
+    }
+    return total;
+}
 
 /*--------------------------*/
 /*      Data requests       */
@@ -154,40 +877,167 @@ string Client::httpGet(const string& fullUrl, CURL* curl) {
  * are valid keys.
  */
 string Client::priceHistory(const std::map<string, string>& params) {
-    std::set<string> reqArgs = {"symbol"};
-    std::set<string> argNames = {
-        "symbol",
-        "periodType",
-        "frequencyType",
-        "period",
-        "frequency",
-        "startDate",
-        "endDate",
-        "needExtendedHoursData",
-        "needPreviousClose"
-    };
+    return *priceHistoryShared(params);
+}
 
-    // Check params
-    if (!validKeys(params, argNames) || 
-            !containsReqArgs(params, reqArgs)) {
-        std::cout << "Invalid params to priceHistory!" << std::endl << std::flush;
-        return "";
+/*
+ * @brief priceHistory written into out, which keeps its capacity for the
+ * next call. Returns a view of out, empty for invalid params or a timeout.
+ */
+std::string_view Client::priceHistory(const std::map<string, string>& params, std::pmr::string& out) {
+    string& fullUrl = requestUrl();
+    if (!priceHistoryUrl(params, fullUrl)) {
+        out.clear();
+        return out;
     }
+    return fetchInto(fullUrl, Priority::Low, out);
+}
 
-    // Initialize curl
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        throw std::runtime_error("Failed to init libcurl");
+std::shared_ptr<const string> Client::priceHistoryShared(const std::map<string, string>& params) {
+    // Check params and build the query
+    string fullUrl = priceHistoryUrl(params);
+    if (fullUrl.empty()) {
+        return std::make_shared<const string>();
     }
 
-    // Build the query and configure curl handle
-    string response;
-    string fullUrl = baseUrl_ + "marketdata/v1/pricehistory"
-                    + buildQuery(curl, params);
-    curl_easy_setopt(curl, CURLOPT_URL, fullUrl.c_str());
+    // Make the get request, or join an identical one in flight
+    return joinFlight(bodyFlights_, metrics_.endpoint(fullUrl), fullUrl, [&] {
+        return httpGet(fullUrl, Priority::Low);
+    });
+}
+
+/*
+ * @brief Get price history parsed straight into Candles columns, skipping
+ * the json DOM. Takes the same params as priceHistory. Columns are allocated
+ * from mr, so passing an arena (e.g. std::pmr::monotonic_buffer_resource)
+ * makes the whole result one block. Invalid params or a timeout give no candles.
+ * With the default resource, identical calls in flight share one request;
+ * with any other mr the call makes its own and parses into mr directly.
+ */
+Candles Client::priceHistoryCandles(const std::map<string, string>& params, std::pmr::memory_resource* mr) {
+    if (mr == std::pmr::get_default_resource()) {
+        return *priceHistoryCandlesShared(params);
+    }
+
+    string fullUrl = priceHistoryUrl(params);
+    if (fullUrl.empty()) {
+        return Candles{mr};
+    }
+    EndpointMetrics& metrics = metrics_.endpoint(fullUrl);
+    string body = httpGet(fullUrl, Priority::Low);
+    auto start = std::chrono::steady_clock::now();
+    Candles candles = parseCandles(body, mr);
+    metrics.parse().record(std::chrono::steady_clock::now() - start);
+    return candles;
+}
+
+std::shared_ptr<const Candles> Client::priceHistoryCandlesShared(const std::map<string, string>& params) {
+    string fullUrl = priceHistoryUrl(params);
+    if (fullUrl.empty()) {
+        return std::make_shared<const Candles>();
+    }
 
-    // Make the post request and return the response
-    return httpGet(fullUrl, curl);
+    EndpointMetrics& metrics = metrics_.endpoint(fullUrl);
+    return joinFlight(candleFlights_, metrics, fullUrl, [&] {
+        string body = httpGet(fullUrl, Priority::Low);
+        auto start = std::chrono::steady_clock::now();
+        Candles candles = parseCandles(body);
+        metrics.parse().record(std::chrono::steady_clock::now() - start);
+        return candles;
+    });
+}
+
+/*
+ * @brief Get price history through a local CandleStore. Whatever part of
+ * [startDate, endDate] is already stored is read from disk; only the gaps
+ * are requested (concurrently) and appended to the store before reading.
+ * A gap is stored only when it comes back as price history with status
+ * 200. A gap reaching the present is stored only up to its last closed
+ * bar: the newest candle may still be forming and later bars may not be
+ * published yet, so both are fetched again next time. If a request
+ * throws, the gaps that succeeded are still stored before the error is
+ * rethrown.
+ *
+ * @param params: same keys as priceHistory. "startDate" and "endDate" are
+ * required, either in epoch ms or as "dd-mm-yyyy".
+ * @param store: the store to read from and fill
+ */
+Candles Client::priceHistory(
+    const std::map<string, string>& params,
+    CandleStore& store,
+    std::pmr::memory_resource* mr
+) {
+    auto symbol = params.find("symbol");
+    auto startDate = params.find("startDate");
+    auto endDate = params.find("endDate");
+    if (symbol == params.end() || startDate == params.end() || endDate == params.end()) {
+        Logger::instance().log(LogComponent::Client, LogLevel::Warn, "Invalid params to priceHistory");
+        return Candles{mr};
+    }
+
+    long long start = paramToEpoch(startDate->second);
+    long long end = paramToEpoch(endDate->second);
+    string series = candleSeries(params);
+
+    // Never record the future as covered
+    long long now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        Clock::now().time_since_epoch()).count();
+    std::vector<CandleStore::Range> gaps = store.gaps(symbol->second, series, start, std::min(end, now));
+
+    // Fetch the missing windows
+    std::vector<std::map<string, string>> requests;
+    for (auto const& [from, to] : gaps) {
+        auto request = params;
+        request["startDate"] = std::to_string(from);
+        request["endDate"] = std::to_string(to);
+        requests.push_back(std::move(request));
+    }
+    std::vector<Fetched> results = fanOut(requests.size(), 16,
+        [this, &requests](std::size_t i, StatusCallback done) {
+            submitPriceHistory(requests[i], std::move(done));
+        });
+
+    // Store every gap that really came back as price history; anything
+    // else stays a gap for next time. The first error is rethrown only
+    // after the others are stored
+    std::exception_ptr error;
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        if (results[i].error) {
+            if (!error) error = results[i].error;
+            continue;
+        }
+        if (results[i].status != 200) {
+            continue;   // timed out or refused
+        }
+        auto parseStart = std::chrono::steady_clock::now();
+        Candles fetched = parseCandles(results[i].body);
+        metrics_.endpoint("marketdata/v1/pricehistory").parse().record(std::chrono::steady_clock::now() - parseStart);
+        if (fetched.symbol.empty()) {
+            Logger::instance().log(LogComponent::Client, LogLevel::Warn, "priceHistory gap [", gaps[i].first,
+                                   ", ", gaps[i].second, "] of ", symbol->second, " not stored: ",
+                                   results[i].body.substr(0, 200));
+            continue;   // an error body, not price history
+        }
+        // Near now, coverage ends just before the newest bar, which is
+        // dropped, rather than at the wall clock
+        long long coveredTo = gaps[i].second;
+        if (coveredTo >= now) {
+            if (fetched.size() == 0) {
+                continue;
+            }
+            coveredTo = fetched.datetime.back() - 1;
+            fetched.pop_back();
+            if (coveredTo < gaps[i].first) {
+                continue;
+            }
+        }
+        store.append(symbol->second, series, gaps[i].first, coveredTo, fetched);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    return store.read(symbol->second, series, start, end, mr);
 }
 
 /*
@@ -205,47 +1055,173 @@ string Client::priceHistory(const std::map<string, string>& params) {
  * "optionType", "entitlement" (PN, NP, PP)
 */
 string Client::optionChains(const std::map<string, string>& params) {
-    std::set<string> reqArgs = {"symbol"};
-    std::set<string> argNames = {
-        "symbol",
-        "contractType",
-        "strikeCount",
-        "includeUnderlyingQuote",
-        "strategy",
-        "interval",
-        "range",
-        "fromDate",
-        "startDate",
-        "volatility",
-        "underlyingPrice",
-        "interestRate",
-        "daysToExpiration",
-        "expMonth",
-        "optionType",
-        "entitlement"
-    };
+    return *optionChainsShared(params);
+}
 
-    // Check params
-    if (!validKeys(params, argNames) || 
-            !containsReqArgs(params, reqArgs)) {
-        std::cout << "Invalid params to validKeys!" << std::endl << std::flush;
-        return "";
+std::string_view Client::optionChains(const std::map<string, string>& params, std::pmr::string& out) {
+    string& fullUrl = requestUrl();
+    if (!optionChainsUrl(params, fullUrl)) {
+        out.clear();
+        return out;
     }
+    return fetchInto(fullUrl, Priority::Normal, out);
+}
 
-    // Initialize curl
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        throw std::runtime_error("Failed to init libcurl");
+std::shared_ptr<const string> Client::optionChainsShared(const std::map<string, string>& params) {
+    // Check params and build the query
+    string fullUrl = optionChainsUrl(params);
+    if (fullUrl.empty()) {
+        return std::make_shared<const string>();
     }
 
-    // Build the query and configure curl handle
-    string response;
-    string fullUrl = baseUrl_ + "marketdata/v1/chains"
-                    + buildQuery(curl, params);
-    curl_easy_setopt(curl, CURLOPT_URL, fullUrl.c_str());
+    // Make the get request, or join an identical one in flight
+    return joinFlight(bodyFlights_, metrics_.endpoint(fullUrl), fullUrl, [&] {
+        return httpGet(fullUrl, Priority::Normal);
+    });
+}
 
-    // Make the post request and return the response
-    return httpGet(fullUrl, curl);
+/*
+ * Write callback state for optionChainsTable. A 200 body goes straight
+ * into the parser as it arrives; anything else is kept for the error.
+ */
+struct ChainStream {
+    CURL* curl = nullptr;
+    JsonPushParser* parser = nullptr;
+    bool keepBody = false;      // also keep a 200 body, for recording
+    long status = 0;
+    string body;
+    std::exception_ptr error;
+};
+
+static size_t chainStreamCallback(char* data, size_t size, size_t nmemb, void* userp) {
+    auto* stream = static_cast<ChainStream*>(userp);
+    size_t bytes = size * nmemb;
+    if (stream->status == 0) {
+        curl_easy_getinfo(stream->curl, CURLINFO_RESPONSE_CODE, &stream->status);
+    }
+    if (stream->status != 200 || stream->keepBody) {
+        stream->body.append(data, bytes);
+    }
+    if (stream->status != 200) {
+        return bytes;
+    }
+    try {
+        stream->parser->feed(data, bytes);
+    } catch (...) {
+        stream->error = std::current_exception();
+        return 0;   // aborts the transfer
+    }
+    return bytes;
+}
+
+/*
+ * @brief Option chains parsed into a flat OptionChainTable. The body is
+ * parsed incrementally while it downloads, so the full JSON text is never
+ * held in memory. Takes the same params as optionChains; throws on a
+ * non-200 response or malformed JSON.
+ */
+OptionChainTable Client::optionChainsTable(const std::map<string, string>& params) {
+    return *optionChainsTableShared(params);
+}
+
+std::shared_ptr<const OptionChainTable> Client::optionChainsTableShared(const std::map<string, string>& params) {
+    string fullUrl = optionChainsUrl(params);
+    if (fullUrl.empty()) {
+        return std::make_shared<const OptionChainTable>();
+    }
+    return joinFlight(chainFlights_, metrics_.endpoint(fullUrl), fullUrl, [&] {
+        return fetchOptionChainsTable(fullUrl);
+    });
+}
+
+OptionChainTable Client::fetchOptionChainsTable(const string& fullUrl) {
+    OptionChainTable table;
+    if (transport_ == Transport::Replay) {
+        auto response = replayed(fullUrl);
+        if (response.status != 200) {
+            throw std::runtime_error("optionChainsTable: HTTP " + std::to_string(response.status)
+                                     + ": " + string(response.body));
+        }
+        auto start = std::chrono::steady_clock::now();
+        OptionChainTable replayedTable = parseOptionChain(response.body);
+        metrics_.endpoint(fullUrl).parse().record(std::chrono::steady_clock::now() - start);
+        return replayedTable;
+    }
+
+    AttemptState state{PriorityScope::resolve(Priority::Normal), DeadlineScope::current()};
+    EndpointMetrics& metrics = metrics_.endpoint(fullUrl);
+    auto headers = currentHeaders();
+    for (;;) {
+        // Queues no longer than the deadline, without spending a token
+        if (!limiter_.acquireUntil(state.priority, state.deadline)
+                || DeadlineScope::Clock::now() >= state.deadline) {
+            metrics.deadlineExceeded();
+            Logger::instance().log(LogComponent::Http, LogLevel::Warn, "Deadline passed before ",
+                                   metrics.name(), " attempt ", state.number, " could be sent");
+            table.clear();
+            return table;
+        }
+
+        // A handle only once the limiter has let the attempt through
+        auto handle = pool_.acquire();
+        CURL* curl = handle.get();
+
+        table.clear();
+        OptionChainBuilder builder{table};
+        JsonPushParser parser{builder};
+        ChainStream stream;
+        stream.curl = curl;
+        stream.parser = &parser;
+        stream.keepBody = transport_ == Transport::Record;
+
+        prepareGet(curl, fullUrl, headers->list, state.deadline);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, chainStreamCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &stream);
+
+        CURLcode rc = curl_easy_perform(curl);
+        if (stream.status == 0) {
+            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &stream.status);
+        }
+        metrics.record(curl, rc, stream.status);
+
+        if (stream.error) {
+            std::rethrow_exception(stream.error);
+        }
+        if (rc == CURLE_OK && stream.status == 401 && !state.refreshed
+                && tokens_->refreshIfStale(headers->token->accessToken)) {
+            state.refreshed = true;
+            metrics.retried();
+            headers = currentHeaders();
+            continue;
+        }
+        curl_off_t retryAfter = 0;
+        curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retryAfter);
+        DeadlineScope::Clock::duration delay{};
+        if (shouldRetry(metrics, state, rc, stream.status, std::chrono::seconds{std::max<curl_off_t>(retryAfter, 0)},
+                        delay)) {
+            ++state.number;
+            handle = ConnectionPool::Lease{nullptr, nullptr};      // not held through the backoff
+            std::this_thread::sleep_for(delay);
+            continue;
+        }
+        if (rc == CURLE_OPERATION_TIMEDOUT && DeadlineScope::Clock::now() >= state.deadline) {
+            metrics.deadlineExceeded();
+        }
+        if (rc != CURLE_OK) {
+            checkResult(rc);    // reports a timeout, throws otherwise
+            table.clear();
+            return table;
+        }
+        if (transport_ == Transport::Record) {
+            archive_->append(archiveKey(fullUrl), stream.status, stream.body);
+        }
+        if (stream.status != 200) {
+            throw std::runtime_error("optionChainsTable: HTTP " + std::to_string(stream.status)
+                                     + ": " + stream.body);
+        }
+        parser.finish();
+        return table;
+    }
 }
 
 /*
@@ -255,22 +1231,15 @@ string Client::optionChains(const std::map<string, string>& params) {
  * @param symbol
 */
 string Client::optionExpirationChains(const string& symbol) {
-    std::map<string, string> params = {{"symbol", symbol}};
-
-    // Initialize curl
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        throw std::runtime_error("Failed to init libcurl");
+    EndpointUrl<expirationChainSchema> url;
+    url.set("symbol", symbol);
+    string fullUrl = checkedUrl(url, baseUrl_);
+    if (fullUrl.empty()) {
+        return "";
     }
 
-    // Build the query and configure curl handle
-    string response;
-    string fullUrl = baseUrl_ + "marketdata/v1/expirationchain"
-                    + buildQuery(curl, params);
-    curl_easy_setopt(curl, CURLOPT_URL, fullUrl.c_str());
-
-    // Make the post request and return the response
-    return httpGet(fullUrl, curl);
+    // Serve from cache or make the get request
+    return cachedGet("optionExpirationChains", fullUrl);
 }
 
 /*
@@ -281,25 +1250,24 @@ string Client::optionExpirationChains(const string& symbol) {
  * @param date: the date for which to fetch hours (YYYY-MM-DD)
 */
 string Client::marketHours(const string& markets, const string& date) {
-    std::map<string, string> params = {{"markets", markets}};
-    if (date != "TODAY") {
-        params["date"] = date;
+    EndpointUrl<marketHoursSchema> url;
+    url.set("markets", markets);
+    if (date != "TODAY" && !date.empty()) {
+        url.set("date", date);
     }
-
-    // Initialize curl
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        throw std::runtime_error("Failed to init libcurl");
+    string fullUrl = checkedUrl(url, baseUrl_);
+    if (fullUrl.empty()) {
+        return "";
     }
 
-    // Build the query and configure curl handle
-    string response;
-    string fullUrl = baseUrl_ + "marketdata/v1/markets"
-                    + buildQuery(curl, params);
-    curl_easy_setopt(curl, CURLOPT_URL, fullUrl.c_str());
+    // Without a date the server answers for its current day, but the URL
+    // stays the same across midnight, so only dated requests are cached
+    if (date == "TODAY" || date.empty()) {
+        return httpGet(fullUrl, Priority::Normal);
+    }
 
-    // Make the post request and return the response
-    return httpGet(fullUrl, curl);
+    // Serve from cache or make the get request
+    return cachedGet("marketHours", fullUrl);
 }
 
 /*
@@ -312,28 +1280,27 @@ string Client::marketHours(const string& markets, const string& date) {
  * @param frequency: (0, 1, 5, 10, 30, 60)
  * */
 string Client::movers( const string& indexSymbol, const string& sort, const int& frequency) {
-    std::map<string, string> params;
-    if (sort != "NONE") {
-        params["sort"] = sort;
-    }
-    if (sort != "NONE") {
-        params["frequency"] = frequency;
-    }
-
-    // Initialize curl
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        throw std::runtime_error("Failed to init libcurl");
+    string fullUrl;
+    if (!moversUrl(indexSymbol, sort, frequency, fullUrl)) {
+        return "";
     }
 
-    // Build the query and configure curl handle
-    string response;
-    string fullUrl = baseUrl_ + "marketdata/v1/movers/" + indexSymbol
-                    + buildQuery(curl, params);
-    curl_easy_setopt(curl, CURLOPT_URL, fullUrl.c_str());
+    // Make the get request
+    return httpGet(fullUrl, Priority::Normal);
+}
 
-    // Make the post request and return the response
-    return httpGet(fullUrl, curl);
+std::string_view Client::movers(
+    const string& indexSymbol,
+    const string& sort,
+    const int& frequency,
+    std::pmr::string& out
+) {
+    string& fullUrl = requestUrl();
+    if (!moversUrl(indexSymbol, sort, frequency, fullUrl)) {
+        out.clear();
+        return out;
+    }
+    return fetchInto(fullUrl, Priority::Normal, out);
 }
 
 /*
@@ -347,25 +1314,15 @@ string Client::movers( const string& indexSymbol, const string& sort, const int&
  *      search, fundamental)
  */
 string Client::instruments(const string& symbol, const string& projection) {
-    std::map<string, string> params = {
-        {"symbol", symbol},
-        {"projection", projection}
-    };
-
-    // Initialize curl
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        throw std::runtime_error("Failed to init libcurl");
+    EndpointUrl<instrumentsSchema> url;
+    url.set("symbol", symbol).set("projection", projection);
+    string fullUrl = checkedUrl(url, baseUrl_);
+    if (fullUrl.empty()) {
+        return "";
     }
 
-    // Build the query and configure curl handle
-    string response;
-    string fullUrl = baseUrl_ + "marketdata/v1/instruments"
-                    + buildQuery(curl, params);
-    curl_easy_setopt(curl, CURLOPT_URL, fullUrl.c_str());
-
-    // Make the post request and return the response
-    return httpGet(fullUrl, curl);
+    // Serve from cache or make the get request
+    return cachedGet("instruments", fullUrl);
 }
 
 /*
@@ -374,19 +1331,15 @@ string Client::instruments(const string& symbol, const string& projection) {
  * @param cupid
  * */
 string Client::instruments(const string& cupid) {
-    // Initialize curl
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        throw std::runtime_error("Failed to init libcurl");
+    EndpointUrl<instrumentByCusipSchema> url;
+    url.set("cusip_id", cupid);
+    string fullUrl = checkedUrl(url, baseUrl_);
+    if (fullUrl.empty()) {
+        return "";
     }
 
-    // Build the query and configure curl handle
-    string response;
-    string fullUrl = baseUrl_ + "marketdata/v1/instruments/" + cupid;
-    curl_easy_setopt(curl, CURLOPT_URL, fullUrl.c_str());
-
-    // Make the post request and return the response
-    return httpGet(fullUrl, curl);
+    // Serve from cache or make the get request
+    return cachedGet("instruments", fullUrl);
 }
 
 /*
@@ -399,27 +1352,28 @@ string Client::instruments(const string& cupid) {
  *      (boolean)
  */
 string Client::quotes(const string& symbols, const string& fields, const bool& indicative) {
-    std::map<string, string> params = {
-        {"symbols", symbols},
-        {"indicative", std::to_string(indicative)}
-    };
-    if (fields != "ALL") {
-        params["fields"] = fields;
-    }
-    // Initialize curl
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        throw std::runtime_error("Failed to init libcurl");
+    // Build the query
+    string fullUrl;
+    if (!quotesUrl(symbols, fields, indicative, fullUrl)) {
+        return "";
     }
 
-    // Build the query and configure curl handle
-    string response;
-    string fullUrl = baseUrl_ + "marketdata/v1/quotes"
-                    + buildQuery(curl, params);
-    curl_easy_setopt(curl, CURLOPT_URL, fullUrl.c_str());
+    // Make the get request and return the response
+    return httpGet(fullUrl, Priority::High);
+}
 
-    // Make the post request and return the response
-    return httpGet(fullUrl, curl);
+std::string_view Client::quotes(
+    const string& symbols,
+    const string& fields,
+    const bool& indicative,
+    std::pmr::string& out
+) {
+    string& fullUrl = requestUrl();
+    if (!quotesUrl(symbols, fields, indicative, fullUrl)) {
+        out.clear();
+        return out;
+    }
+    return fetchInto(fullUrl, Priority::High, out);
 }
 
 /*
@@ -430,23 +1384,255 @@ string Client::quotes(const string& symbols, const string& fields, const bool& i
  *      (quote, fundamental, extended, reference, regular, ALL)
  */
 string Client::quotes(const string& symbol, const string& fields) {
-    std::map<string, string> params;
-    if (fields != "ALL") {
-        params["fields"] = fields;
+    string fullUrl;
+    if (!quoteUrl(symbol, fields, fullUrl)) {
+        return "";
+    }
+
+    // Make the get request
+    return httpGet(fullUrl, Priority::High);
+}
+
+/*
+ * @brief Single-symbol quote written into out, which keeps its capacity
+ * for the next call; the allocation-free form for a polling loop.
+ */
+std::string_view Client::quotes(const string& symbol, const string& fields, std::pmr::string& out) {
+    string& fullUrl = requestUrl();
+    if (!quoteUrl(symbol, fields, fullUrl)) {
+        out.clear();
+        return out;
+    }
+    return fetchInto(fullUrl, Priority::High, out);
+}
+
+/*
+ * @brief Get Quotes for any number of symbols. The list is split into
+ * batches that fit the server's symbol and URL limits, the batches are
+ * fetched concurrently (at most maxInFlight at once), and the 200
+ * responses are merged into one json object keyed by symbol, with a
+ * single "errors" entry listing every batch's invalid symbols. Throws
+ * QuoteBatchError, carrying the merged quotes that did arrive, if any
+ * batch failed. Invalid params make no request and return "".
+ *
+ * @param symbols - symbols to quote; duplicates are dropped
+ * @param fields - comma seperated list of root nodes
+ *      (quote, fundamental, extended, reference, regular, ALL)
+ * @param indicative - return indicative quotes for symbol in addition to symbol
+ *      (boolean)
+ */
+string Client::quotes(
+    const std::vector<string>& symbols,
+    const string& fields,
+    const bool& indicative,
+    std::size_t maxInFlight
+) {
+    // Split into comma separated batches
+    std::vector<string> batches;
+    std::set<string> seen;
+    string batch;
+    std::size_t batchSymbols = 0, batchBytes = 0;
+    for (auto const& symbol : symbols) {
+        if (symbol.empty() || !seen.insert(symbol).second) {
+            continue;
+        }
+        std::size_t bytes = encodedSize(symbol) + 3;  // + encoded comma
+        if (batchSymbols > 0 &&
+                (batchSymbols == maxQuoteSymbols_ || batchBytes + bytes > maxQuoteSymbolBytes_)) {
+            batches.push_back(std::move(batch));
+            batch.clear();
+            batchSymbols = batchBytes = 0;
+        }
+        if (batchSymbols > 0) batch += ',';
+        batch += symbol;
+        ++batchSymbols;
+        batchBytes += bytes;
+    }
+    if (batchSymbols > 0) {
+        batches.push_back(std::move(batch));
     }
 
-    // Initialize curl
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        throw std::runtime_error("Failed to init libcurl");
+    // Check every batch before sending any
+    string url;
+    for (auto const& symbolList : batches) {
+        if (!quotesUrl(symbolList, fields, indicative, url)) {
+            return "";
+        }
     }
 
-    // Build the query and configure curl handle
-    string response;
-    string fullUrl = baseUrl_ + "marketdata/v1/" + symbol + "/quotes"
-                    + buildQuery(curl, params);
-    curl_easy_setopt(curl, CURLOPT_URL, fullUrl.c_str());
+    // Fetch concurrently
+    std::vector<Fetched> results = fanOut(batches.size(), maxInFlight,
+        [this, &batches, &fields, &indicative](std::size_t i, StatusCallback done) {
+            submitQuotes(batches[i], fields, indicative, std::move(done));
+        });
+
+    // Merge the members of each 200 response object into one object, with
+    // one "errors" entry combining every batch's
+    QuoteBatchMerger merger;
+    std::size_t failed = 0;
+    string firstFailure;
+    for (auto const& result : results) {
+        if (result.error || result.status != 200 || !merger.add(result.body)) {
+            if (failed++ == 0) {
+                try {
+                    if (result.error) std::rethrow_exception(result.error);
+                    firstFailure = result.status == 0 ? "no response"
+                                 : result.status == 200 ? "not a json object"
+                                 : "HTTP " + std::to_string(result.status);
+                } catch (const std::exception& e) {
+                    firstFailure = e.what();
+                }
+            }
+        }
+    }
+    string merged = merger.str();
+
+    if (failed > 0) {
+        throw QuoteBatchError(std::to_string(failed) + " of " + std::to_string(results.size())
+                              + " quote batches failed (first: " + firstFailure + ")",
+                              std::move(merged), failed, results.size());
+    }
+    return merged;
+}
 
-    // Make the post request and return the response
-    return httpGet(fullUrl, curl);
+/*------------------------------------*/
+/*      Asynchronous data requests    */
+/*------------------------------------*/
+/*
+ * Wraps a callback request in a future.
+ */
+static std::pair<std::future<string>, ResponseCallback> futureCallback() {
+    auto promise = std::make_shared<std::promise<string>>();
+    auto future = promise->get_future();
+    ResponseCallback done = [promise](const string& body, std::exception_ptr error) {
+        if (error) promise->set_exception(error);
+        else promise->set_value(body);
+    };
+    return {std::move(future), std::move(done)};
+}
+
+/*
+ * @brief Non-blocking priceHistory. Runs on the request loop, so many
+ * calls can be in flight at once. Takes the same params as priceHistory;
+ * done is called on the loop thread and must not block.
+ */
+void Client::priceHistoryAsync(const std::map<string, string>& params, ResponseCallback done) {
+    submitPriceHistory(params, [done = std::move(done)](long, const string& body, std::exception_ptr error) {
+        done(body, error);
+    });
+}
+
+void Client::submitPriceHistory(const std::map<string, string>& params, StatusCallback done) {
+    CURL* curl = loop_.checkout();
+    string fullUrl = priceHistoryUrl(params);
+    if (fullUrl.empty()) {
+        loop_.checkin(curl);
+        done(0, "", nullptr);
+        return;
+    }
+    submitGet(curl, fullUrl, std::move(done), Priority::Low);
+}
+
+std::future<string> Client::priceHistoryAsync(const std::map<string, string>& params) {
+    auto [future, done] = futureCallback();
+    priceHistoryAsync(params, std::move(done));
+    return std::move(future);
+}
+
+/*
+ * @brief Non-blocking optionChains. Takes the same params as optionChains;
+ * done is called on the loop thread and must not block.
+ */
+void Client::optionChainsAsync(const std::map<string, string>& params, ResponseCallback done) {
+    CURL* curl = loop_.checkout();
+    string fullUrl = optionChainsUrl(params);
+    if (fullUrl.empty()) {
+        loop_.checkin(curl);
+        done("", nullptr);
+        return;
+    }
+    submitGet(curl, fullUrl, [done = std::move(done)](long, const string& body, std::exception_ptr error) {
+        done(body, error);
+    }, Priority::Normal);
+}
+
+std::future<string> Client::optionChainsAsync(const std::map<string, string>& params) {
+    auto [future, done] = futureCallback();
+    optionChainsAsync(params, std::move(done));
+    return std::move(future);
+}
+
+/*
+ * @brief Non-blocking quotes. Takes the same arguments as quotes;
+ * done is called on the loop thread and must not block.
+ */
+void Client::quotesAsync(const string& symbols, const string& fields, const bool& indicative, ResponseCallback done) {
+    submitQuotes(symbols, fields, indicative, [done = std::move(done)](long, const string& body,
+                                                                      std::exception_ptr error) {
+        done(body, error);
+    });
+}
+
+void Client::submitQuotes(const string& symbols, const string& fields, const bool& indicative, StatusCallback done) {
+    string fullUrl;
+    if (!quotesUrl(symbols, fields, indicative, fullUrl)) {
+        done(0, "", nullptr);
+        return;
+    }
+    submitGet(loop_.checkout(), fullUrl, std::move(done), Priority::High);
+}
+
+std::future<string> Client::quotesAsync(const string& symbols, const string& fields, const bool& indicative) {
+    auto [future, done] = futureCallback();
+    quotesAsync(symbols, fields, indicative, std::move(done));
+    return std::move(future);
+}
+
+/*
+ * @brief Fetches price history for many param sets concurrently, with
+ * at most maxInFlight requests outstanding. Results are returned in the
+ * same order as paramsList. Rethrows the first error once every request
+ * has finished.
+ */
+std::vector<string> Client::priceHistoryMany(
+    const std::vector<std::map<string, string>>& paramsList,
+    std::size_t maxInFlight
+) {
+    std::vector<Fetched> results = fanOut(paramsList.size(), maxInFlight,
+        [this, &paramsList](std::size_t i, StatusCallback done) {
+            submitPriceHistory(paramsList[i], std::move(done));
+        });
+    std::vector<string> bodies;
+    bodies.reserve(results.size());
+    for (auto& result : results) {
+        if (result.error) {
+            std::rethrow_exception(result.error);
+        }
+        bodies.push_back(std::move(result.body));
+    }
+    return bodies;
+}
+
+/*------------------------------*/
+/*      Streaming               */
+/*------------------------------*/
+/*
+ * @brief Get the streamer's socket URL and the ids its LOGIN request
+ * needs, from the user preferences.
+ */
+StreamerInfo Client::streamerInfo() {
+    return StreamerInfo::fromUserPreference(httpGet(baseUrl_ + "trader/v1/userPreference", Priority::High));
+}
+
+/*
+ * @brief A Streamer for this account, not yet started. Each login asks
+ * Tokens for the current access token, so refreshes carry over to
+ * reconnects.
+ */
+std::unique_ptr<Streamer> Client::streamer(StreamerConfig config) {
+    if (!tokens_) {
+        throw std::runtime_error("A replay client cannot stream");
+    }
+    Tokens* tokens = tokens_.get();
+    return std::make_unique<Streamer>(streamerInfo(), [tokens] { return tokens->accessToken(); }, config);
 }
@@ -0,0 +1,220 @@
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <curl/curl.h>
+
+#include "connection_pool.hpp"
+
+//==============================================================================
+//                              ConnectionPool
+//==============================================================================
+
+/*-----------------------------------------------------*/
+/*      ConnectionPool constructors and destructors    */
+/*-----------------------------------------------------*/
+ConnectionPool::ConnectionPool(std::size_t capacity)
+    : capacity_{capacity == 0 ? 1 : capacity}
+{
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    share_ = curl_share_init();
+    if (!share_) {
+        throw std::runtime_error("Failed to init libcurl share handle");
+    }
+    curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, &ConnectionPool::lockShare);
+    curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, &ConnectionPool::unlockShare);
+    curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+
+    idle_.reserve(capacity_);
+}
+
+ConnectionPool::~ConnectionPool() {
+    // Leases must not outlive the pool, so every handle is idle here
+    for (CURL* curl : idle_) {
+        destroyHandle(curl);
+    }
+    curl_share_cleanup(share_);
+    curl_global_cleanup();
+}
+
+/*------------------------------*/
+/*      Checkout / release      */
+/*------------------------------*/
+/*
+ * @brief Checks out a handle. Reuses an idle handle (and its live
+ * connection) when there is one, creates a new one while under
+ * capacity, and otherwise waits for another thread to release one.
+ */
+ConnectionPool::Lease ConnectionPool::acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    available_.wait(lock, [this] { return !idle_.empty() || created_ < capacity_; });
+    return checkout(lock);
+}
+
+ConnectionPool::Lease ConnectionPool::tryAcquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (idle_.empty() && created_ >= capacity_) {
+        return Lease{this, nullptr};
+    }
+    return checkout(lock);
+}
+
+/*
+ * Takes an idle handle, or creates one when under capacity. Called with
+ * mutex_ held and one of the two possible.
+ */
+ConnectionPool::Lease ConnectionPool::checkout(std::unique_lock<std::mutex>& lock) {
+    if (!idle_.empty()) {
+        CURL* curl = idle_.back();
+        idle_.pop_back();
+        return Lease{this, curl};
+    }
+
+    ++created_;
+    lock.unlock();
+    try {
+        return Lease{this, createHandle()};
+    } catch (...) {
+        lock.lock();
+        --created_;
+        available_.notify_one();
+        throw;
+    }
+}
+
+/*
+ * Number of handles currently waiting in the pool.
+ */
+std::size_t ConnectionPool::idle() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return idle_.size();
+}
+
+/*
+ * Clears per-request options and returns the handle to the pool.
+ * curl_easy_reset keeps the live connection and caches.
+ */
+void ConnectionPool::release(CURL* curl) {
+    resetHandle(curl);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle_.push_back(curl);
+    }
+    available_.notify_one();
+}
+
+/*----------------------------------*/
+/*      Handle configuration        */
+/*----------------------------------*/
+/*
+ * The response buffer hangs off CURLOPT_PRIVATE, so it travels with the
+ * handle wherever it goes.
+ */
+CURL* ConnectionPool::createHandle() {
+    CURL* curl = curl_easy_init();
+    if (!curl) {
+        throw std::runtime_error("Failed to init libcurl");
+    }
+    configure(curl);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, new std::string());
+    return curl;
+}
+
+/*
+ * Clears per-request options. curl_easy_reset keeps the live connection
+ * and caches; the buffer keeps its capacity unless it grew past
+ * maxRetainedBuffer_.
+ */
+void ConnectionPool::resetHandle(CURL* curl) {
+    std::string* buffer = &responseBuffer(curl);
+    buffer->clear();
+    if (buffer->capacity() > maxRetainedBuffer_) {
+        buffer->shrink_to_fit();
+    }
+    curl_easy_reset(curl);
+    configure(curl);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, buffer);
+}
+
+void ConnectionPool::destroyHandle(CURL* curl) {
+    delete &responseBuffer(curl);
+    curl_easy_cleanup(curl);
+}
+
+/*
+ * Options that persist for the lifetime of a pooled handle. An empty
+ * Accept-Encoding offers every encoding libcurl was built with (gzip,
+ * deflate and, where available, br and zstd) and decompresses as the
+ * body streams in.
+ */
+void ConnectionPool::configure(CURL* curl) {
+    curl_easy_setopt(curl, CURLOPT_SHARE, share_);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);      // required for multi-threaded use
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, 300L);
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+}
+
+/*------------------------------*/
+/*      Response buffers        */
+/*------------------------------*/
+std::string& ConnectionPool::responseBuffer(CURL* curl) {
+    char* buffer = nullptr;
+    curl_easy_getinfo(curl, CURLINFO_PRIVATE, &buffer);
+    return *reinterpret_cast<std::string*>(buffer);
+}
+
+/*
+ * Content-Length is known once the headers are in, so the first chunk
+ * reserves room for the whole body. For a compressed response it is the
+ * compressed size, which still saves the early reallocations.
+ */
+size_t ConnectionPool::writeToBuffer(char* data, size_t size, size_t nmemb, void* curl) {
+    std::string& buffer = responseBuffer(static_cast<CURL*>(curl));
+    size_t bytes = size * nmemb;
+    if (buffer.empty()) {
+        curl_off_t length = -1;
+        curl_easy_getinfo(static_cast<CURL*>(curl), CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+        if (length > 0) {
+            buffer.reserve(static_cast<std::size_t>(length));
+        }
+    }
+    buffer.append(data, bytes);
+    return bytes;
+}
+
+/*--------------------------------*/
+/*      CURLSH lock callbacks     */
+/*--------------------------------*/
+void ConnectionPool::lockShare(CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+    static_cast<ConnectionPool*>(userptr)->shareLocks_[data].lock();
+}
+
+void ConnectionPool::unlockShare(CURL*, curl_lock_data data, void* userptr) {
+    static_cast<ConnectionPool*>(userptr)->shareLocks_[data].unlock();
+}
+
+//==============================================================================
+//                              ConnectionPool::Lease
+//==============================================================================
+ConnectionPool::Lease::Lease(Lease&& other) noexcept
+    : pool_{std::exchange(other.pool_, nullptr)},
+      curl_{std::exchange(other.curl_, nullptr)}
+{ }
+
+ConnectionPool::Lease& ConnectionPool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        if (pool_ && curl_) pool_->release(curl_);
+        pool_ = std::exchange(other.pool_, nullptr);
+        curl_ = std::exchange(other.curl_, nullptr);
+    }
+    return *this;
+}
+
+ConnectionPool::Lease::~Lease() {
+    if (pool_ && curl_) pool_->release(curl_);
+}
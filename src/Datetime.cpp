@@ -0,0 +1,260 @@
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "datetime.hpp"
+
+using string = std::string;
+
+/*--------------------------------------------------------------*/
+/*      Each format is a fixed pattern, 'd' marking a digit.    */
+/*      Up to 24 bytes are checked eight at a time as 64-bit    */
+/*      words (SWAR): separators with one compare, digits with  */
+/*      a few adds and masks, no branch per character           */
+/*--------------------------------------------------------------*/
+struct Layout {
+    std::string_view pattern;
+    int year, month, day;               // offsets; -1 when absent
+    int hour, minute, second, millis;
+};
+
+static constexpr Layout layoutOf(DateFormat format) {
+    switch (format) {
+        case DateFormat::Date:        return {"dd-dd-dddd",               6, 3, 0, -1, -1, -1, -1};
+        case DateFormat::DateTime:    return {"dd-dd-dddd dd:dd:dd",      6, 3, 0, 11, 14, 17, -1};
+        case DateFormat::IsoDate:     return {"dddd-dd-dd",               0, 5, 8, -1, -1, -1, -1};
+        case DateFormat::IsoDateTime: return {"dddd-dd-ddTdd:dd:dd.dddZ", 0, 5, 8, 11, 14, 17, 20};
+    }
+    return {};
+}
+
+static constexpr std::size_t wordCount = 3;     // 24 bytes, the longest pattern
+
+struct Masks {
+    std::uint64_t digit[wordCount];         // 0xff on digit bytes
+    std::uint64_t literal[wordCount];       // 0xff on separator bytes
+    std::uint64_t literalValue[wordCount];  // the separators themselves
+};
+
+// Built with bit_cast so the byte order matches words loaded with memcpy
+static constexpr Masks masksOf(const Layout& layout) {
+    Masks masks{};
+    for (std::size_t w = 0; w < wordCount; ++w) {
+        std::array<unsigned char, 8> digit{}, literal{}, value{};
+        for (std::size_t b = 0; b < 8; ++b) {
+            std::size_t i = w * 8 + b;
+            if (i >= layout.pattern.size()) {
+                continue;
+            }
+            if (layout.pattern[i] == 'd') {
+                digit[b] = 0xff;
+            } else {
+                literal[b] = 0xff;
+                value[b] = static_cast<unsigned char>(layout.pattern[i]);
+            }
+        }
+        masks.digit[w] = std::bit_cast<std::uint64_t>(digit);
+        masks.literal[w] = std::bit_cast<std::uint64_t>(literal);
+        masks.literalValue[w] = std::bit_cast<std::uint64_t>(value);
+    }
+    return masks;
+}
+
+static constexpr std::uint64_t millisPerDay = 86400000;
+
+static inline unsigned digits2(const unsigned char* d, int at) {
+    return d[at] * 10u + d[at + 1];
+}
+
+static inline unsigned digits3(const unsigned char* d, int at) {
+    return d[at] * 100u + d[at + 1] * 10u + d[at + 2];
+}
+
+static inline unsigned digits4(const unsigned char* d, int at) {
+    return digits2(d, at) * 100u + digits2(d, at + 2);
+}
+
+/*------------------------------*/
+/*      Parsing                 */
+/*------------------------------*/
+template <DateFormat Format>
+static long long parseOne(std::string_view text) {
+    static constexpr Layout layout = layoutOf(Format);
+    static constexpr Masks masks = masksOf(layout);
+    constexpr std::uint64_t high = 0x8080808080808080ull;
+    constexpr std::uint64_t ones = 0x0101010101010101ull;
+
+    if (text.size() != layout.pattern.size()) {
+        return invalidEpoch;
+    }
+    std::uint64_t words[wordCount] = {};
+    std::memcpy(words, text.data(), text.size());
+
+    // Any nonzero bit in bad rejects the text
+    std::uint64_t bad = 0;
+    for (std::size_t w = 0; w < wordCount; ++w) {
+        std::uint64_t x = words[w];
+        std::uint64_t digitHigh = masks.digit[w] & high;
+        std::uint64_t digitOnes = masks.digit[w] & ones;
+        std::uint64_t y = x & masks.digit[w];
+
+        bad |= (x & masks.literal[w]) ^ masks.literalValue[w];
+        bad |= y & digitHigh;                                   // not ASCII
+        bad |= (y + digitOnes * 0x46) & digitHigh;              // above '9'
+        bad |= ~((y | digitHigh) - digitOnes * 0x30) & digitHigh;  // below '0'
+        words[w] = y - digitOnes * 0x30;
+    }
+    if (bad) {
+        return invalidEpoch;
+    }
+
+    unsigned char d[wordCount * 8];
+    std::memcpy(d, words, sizeof(d));
+    unsigned year = digits4(d, layout.year);
+    unsigned month = digits2(d, layout.month);
+    unsigned day = digits2(d, layout.day);
+    unsigned hour = layout.hour >= 0 ? digits2(d, layout.hour) : 0;
+    unsigned minute = layout.minute >= 0 ? digits2(d, layout.minute) : 0;
+    unsigned second = layout.second >= 0 ? digits2(d, layout.second) : 0;
+    unsigned millis = layout.millis >= 0 ? digits3(d, layout.millis) : 0;
+
+    if (month - 1 >= 12 || day - 1 >= daysInMonth(year, month) || hour >= 24 || minute >= 60 || second >= 60) {
+        return invalidEpoch;
+    }
+    long long days = daysFromCivil(year, month, day);
+    return ((days * 24 + hour) * 60 + minute) * 60000LL + second * 1000LL + millis;
+}
+
+template <DateFormat Format, typename Text>
+static std::size_t parseAll(std::span<const Text> texts, std::span<long long> epochMs) {
+    std::size_t failed = 0;
+    for (std::size_t i = 0; i < texts.size(); ++i) {
+        long long ms = parseOne<Format>(texts[i]);
+        failed += ms == invalidEpoch;
+        epochMs[i] = ms;
+    }
+    return failed;
+}
+
+template <typename Text>
+static std::size_t parseColumn(std::span<const Text> texts, std::span<long long> epochMs, DateFormat format) {
+    if (epochMs.size() < texts.size()) {
+        texts = texts.first(epochMs.size());
+    }
+    switch (format) {
+        case DateFormat::Date:        return parseAll<DateFormat::Date>(texts, epochMs);
+        case DateFormat::DateTime:    return parseAll<DateFormat::DateTime>(texts, epochMs);
+        case DateFormat::IsoDate:     return parseAll<DateFormat::IsoDate>(texts, epochMs);
+        case DateFormat::IsoDateTime: return parseAll<DateFormat::IsoDateTime>(texts, epochMs);
+    }
+    return texts.size();
+}
+
+long long parseEpochMs(std::string_view text, DateFormat format) {
+    long long epochMs = invalidEpoch;
+    parseColumn(std::span<const std::string_view>(&text, 1), std::span<long long>(&epochMs, 1), format);
+    return epochMs;
+}
+
+std::size_t parseEpochMs(std::span<const std::string_view> texts, std::span<long long> epochMs, DateFormat format) {
+    return parseColumn(texts, epochMs, format);
+}
+
+std::size_t parseEpochMs(std::span<const string> texts, std::span<long long> epochMs, DateFormat format) {
+    return parseColumn(texts, epochMs, format);
+}
+
+/*------------------------------*/
+/*      Formatting              */
+/*------------------------------*/
+static inline void put2(char* out, unsigned value) {
+    out[0] = static_cast<char>('0' + value / 10);
+    out[1] = static_cast<char>('0' + value % 10);
+}
+
+/*
+ * Timestamps in a column usually share their day with the previous one,
+ * so the last date conversion is kept.
+ */
+struct DayCache {
+    long long days = invalidEpoch;
+    CivilDate date{};
+};
+
+template <DateFormat Format>
+static bool formatOne(long long epochMs, char* out, DayCache& cache) {
+    static constexpr Layout layout = layoutOf(Format);
+    constexpr long long perDay = static_cast<long long>(millisPerDay);
+
+    long long days = epochMs / perDay;
+    long long rest = epochMs % perDay;
+    if (rest < 0) {
+        rest += perDay;
+        --days;
+    }
+    if (days != cache.days) {
+        cache.date = civilFromDays(days);
+        cache.days = days;
+    }
+    const CivilDate& date = cache.date;
+    if (epochMs == invalidEpoch || date.year < 0 || date.year > 9999) {
+        std::memset(out, '?', layout.pattern.size());
+        return false;
+    }
+
+    std::memcpy(out, layout.pattern.data(), layout.pattern.size());
+    auto year = static_cast<unsigned>(date.year);
+    put2(out + layout.year, year / 100);
+    put2(out + layout.year + 2, year % 100);
+    put2(out + layout.month, date.month);
+    put2(out + layout.day, date.day);
+    if constexpr (layout.hour >= 0) {
+        auto seconds = static_cast<unsigned>(rest / 1000);
+        put2(out + layout.hour, seconds / 3600);
+        put2(out + layout.minute, seconds / 60 % 60);
+        put2(out + layout.second, seconds % 60);
+    }
+    if constexpr (layout.millis >= 0) {
+        auto millis = static_cast<unsigned>(rest % 1000);
+        out[layout.millis] = static_cast<char>('0' + millis / 100);
+        put2(out + layout.millis + 1, millis % 100);
+    }
+    return true;
+}
+
+template <DateFormat Format>
+static std::size_t formatAll(std::span<const long long> epochMs, char* out) {
+    constexpr std::size_t width = dateFormatWidth(Format);
+    DayCache cache;
+    std::size_t failed = 0;
+    for (std::size_t i = 0; i < epochMs.size(); ++i) {
+        failed += !formatOne<Format>(epochMs[i], out + i * width, cache);
+    }
+    return failed;
+}
+
+std::size_t formatEpochMs(std::span<const long long> epochMs, std::span<char> out, DateFormat format) {
+    std::size_t width = dateFormatWidth(format);
+    if (out.size() < epochMs.size() * width) {
+        epochMs = epochMs.first(out.size() / width);
+    }
+    switch (format) {
+        case DateFormat::Date:        return formatAll<DateFormat::Date>(epochMs, out.data());
+        case DateFormat::DateTime:    return formatAll<DateFormat::DateTime>(epochMs, out.data());
+        case DateFormat::IsoDate:     return formatAll<DateFormat::IsoDate>(epochMs, out.data());
+        case DateFormat::IsoDateTime: return formatAll<DateFormat::IsoDateTime>(epochMs, out.data());
+    }
+    return epochMs.size();
+}
+
+string formatEpochMs(long long epochMs, DateFormat format) {
+    string text(dateFormatWidth(format), '\0');
+    if (formatEpochMs(std::span<const long long>(&epochMs, 1), text, format) != 0) {
+        return "";
+    }
+    return text;
+}
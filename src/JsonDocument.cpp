@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <memory_resource>
+#include <string_view>
+
+#include "json_document.hpp"
+
+//==============================================================================
+//                                JsonValue
+//==============================================================================
+const JsonNode JsonValue::null_{};
+
+JsonValue JsonValue::operator[](std::string_view key) const {
+    for (auto const& member : members()) {
+        if (member.key == key) {
+            return JsonValue(member.value);
+        }
+    }
+    return JsonValue();
+}
+
+JsonValue JsonValue::operator[](std::size_t index) const {
+    auto items = elements();
+    return index < items.size() ? JsonValue(items[index]) : JsonValue();
+}
+
+//==============================================================================
+//                                JsonDocument
+//==============================================================================
+JsonDocument::JsonDocument(std::size_t arenaBytes)
+    : block_(std::max<std::size_t>(arenaBytes, 1024))
+{
+    arena_.emplace(block_.data(), block_.size(), &upstream_);
+}
+
+void* JsonDocument::CountingResource::do_allocate(std::size_t bytes, std::size_t alignment) {
+    this->bytes += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void JsonDocument::CountingResource::do_deallocate(void* p, std::size_t bytes, std::size_t alignment) {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+/*
+ * @brief Drops the document and resets the arena. If the last document
+ * outgrew the first block, the block is replaced by one that fits it, so
+ * a steady stream of similar documents stops allocating.
+ */
+void JsonDocument::clear() {
+    root_ = JsonNode{};
+    source_ = {};
+    key_ = {};
+    stack_.clear();
+    open_.clear();
+    parser_.reset();
+
+    if (upstream_.bytes > 0) {
+        std::size_t wanted = block_.size() + upstream_.bytes;
+        arena_.reset();                     // returns the extra blocks upstream
+        block_ = std::vector<std::byte>(wanted);
+        upstream_.bytes = 0;
+        arena_.emplace(block_.data(), block_.size(), &upstream_);
+    } else {
+        arena_->release();
+    }
+}
+
+JsonValue JsonDocument::parse(std::string_view text) {
+    clear();
+    if (text.empty()) {
+        return root();
+    }
+
+    source_ = text;
+    try {
+        parser_.feed(text);
+        parser_.finish();
+    } catch (...) {
+        stack_.clear();
+        open_.clear();
+        source_ = {};
+        throw;
+    }
+    root_ = stack_.front().value;
+    stack_.clear();
+    return root();
+}
+
+/*----------------------*/
+/*      Building        */
+/*----------------------*/
+/*
+ * Strings the parser passes straight from the text are kept as views;
+ * unescaped ones live in the parser's scratch buffer and are copied
+ * into the arena.
+ */
+std::string_view JsonDocument::keep(std::string_view text) {
+    std::less<const char*> before;
+    if (!before(text.data(), source_.data()) && !before(source_.data() + source_.size(), text.data() + text.size())) {
+        return text;
+    }
+    char* copy = static_cast<char*>(arena_->allocate(std::max<std::size_t>(text.size(), 1), 1));
+    std::memcpy(copy, text.data(), text.size());
+    return std::string_view(copy, text.size());
+}
+
+void JsonDocument::push(const JsonNode& node) {
+    stack_.push_back({key_, node});
+    key_ = {};
+}
+
+/*
+ * Moves the children of the innermost open container from the stack
+ * into one arena array and points the container at it.
+ */
+void JsonDocument::close() {
+    std::size_t at = open_.back();
+    open_.pop_back();
+    JsonNode& node = stack_[at].value;
+    std::size_t count = stack_.size() - at - 1;
+    node.size = static_cast<std::uint32_t>(count);
+
+    if (node.type == JsonType::Object) {
+        auto* members = static_cast<JsonMember*>(
+            arena_->allocate(std::max<std::size_t>(count, 1) * sizeof(JsonMember), alignof(JsonMember)));
+        std::copy(stack_.begin() + at + 1, stack_.end(), members);
+        node.members = members;
+    } else {
+        auto* elements = static_cast<JsonNode*>(
+            arena_->allocate(std::max<std::size_t>(count, 1) * sizeof(JsonNode), alignof(JsonNode)));
+        for (std::size_t i = 0; i < count; ++i) {
+            elements[i] = stack_[at + 1 + i].value;
+        }
+        node.elements = elements;
+    }
+    stack_.resize(at + 1);
+}
+
+void JsonDocument::startObject() {
+    JsonNode node;
+    node.type = JsonType::Object;
+    push(node);
+    open_.push_back(stack_.size() - 1);
+}
+
+void JsonDocument::endObject() {
+    close();
+}
+
+void JsonDocument::startArray() {
+    JsonNode node;
+    node.type = JsonType::Array;
+    push(node);
+    open_.push_back(stack_.size() - 1);
+}
+
+void JsonDocument::endArray() {
+    close();
+}
+
+void JsonDocument::key(std::string_view name) {
+    key_ = keep(name);
+}
+
+void JsonDocument::string(std::string_view value) {
+    std::string_view kept = keep(value);
+    JsonNode node;
+    node.type = JsonType::String;
+    node.size = static_cast<std::uint32_t>(kept.size());
+    node.text = kept.data();
+    push(node);
+}
+
+void JsonDocument::number(double value) {
+    JsonNode node;
+    node.type = JsonType::Number;
+    node.number = value;
+    push(node);
+}
+
+void JsonDocument::boolean(bool value) {
+    JsonNode node;
+    node.type = JsonType::Boolean;
+    node.boolean = value;
+    push(node);
+}
+
+void JsonDocument::null() {
+    push(JsonNode{});
+}
@@ -0,0 +1,278 @@
+#include <charconv>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "json_push_parser.hpp"
+
+using string = std::string;
+
+//==============================================================================
+//                              JsonPushParser
+//==============================================================================
+
+/*----------------------*/
+/*      Input           */
+/*----------------------*/
+/*
+ * @brief Consumes the next chunk of the document. Tokens cut off at the
+ * end of a chunk are kept in scratch_ and completed by the next one;
+ * strings without escapes that fit in one chunk are passed straight
+ * from the input without copying.
+ */
+void JsonPushParser::feed(const char* data, std::size_t size) {
+    const char* p = data;
+    const char* end = data + size;
+
+    while (p < end) {
+        switch (state_) {
+            case State::String: {
+                const char* q = p;
+                while (q < end && *q != '"' && *q != '\\') ++q;
+                if (q == end) {
+                    scratch_.append(p, q);
+                    p = q;
+                } else if (*q == '"') {
+                    if (scratch_.empty()) {
+                        emitString(std::string_view(p, q - p));
+                    } else {
+                        scratch_.append(p, q);
+                        emitString(scratch_);
+                    }
+                    p = q + 1;
+                } else {
+                    scratch_.append(p, q);
+                    state_ = State::Escape;
+                    p = q + 1;
+                }
+                break;
+            }
+
+            case State::Escape: {
+                char c = *p++;
+                state_ = State::String;
+                switch (c) {
+                    case '"':  scratch_ += '"';  break;
+                    case '\\': scratch_ += '\\'; break;
+                    case '/':  scratch_ += '/';  break;
+                    case 'b':  scratch_ += '\b'; break;
+                    case 'f':  scratch_ += '\f'; break;
+                    case 'n':  scratch_ += '\n'; break;
+                    case 'r':  scratch_ += '\r'; break;
+                    case 't':  scratch_ += '\t'; break;
+                    case 'u':
+                        state_ = State::Unicode;
+                        unicode_ = 0;
+                        unicodeDigits_ = 0;
+                        break;
+                    default:
+                        fail("bad escape");
+                }
+                break;
+            }
+
+            case State::Unicode: {
+                char c = *p++;
+                std::uint32_t digit;
+                if (c >= '0' && c <= '9') digit = c - '0';
+                else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+                else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+                else fail("bad \\u escape");
+                unicode_ = unicode_ * 16 + digit;
+                if (++unicodeDigits_ < 4) break;
+
+                state_ = State::String;
+                if (unicode_ >= 0xD800 && unicode_ <= 0xDBFF) {
+                    highSurrogate_ = unicode_;
+                } else if (unicode_ >= 0xDC00 && unicode_ <= 0xDFFF && highSurrogate_) {
+                    appendUtf8(0x10000 + ((highSurrogate_ - 0xD800) << 10) + (unicode_ - 0xDC00));
+                    highSurrogate_ = 0;
+                } else {
+                    if (highSurrogate_) appendUtf8(0xFFFD);
+                    highSurrogate_ = 0;
+                    appendUtf8(unicode_);
+                }
+                break;
+            }
+
+            case State::Number: {
+                while (p < end) {
+                    char c = *p;
+                    bool numeric = (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+                    if (!numeric) break;
+                    scratch_ += c;
+                    ++p;
+                }
+                if (p < end) emitNumber();
+                break;
+            }
+
+            case State::Literal: {
+                while (p < end && *p >= 'a' && *p <= 'z') {
+                    scratch_ += *p++;
+                }
+                if (p < end) emitLiteral();
+                break;
+            }
+
+            default: {
+                char c = *p++;
+                if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+                    break;
+                }
+
+                if (state_ == State::Value) {
+                    if (c == '{') {
+                        stack_.push_back(true);
+                        handler_.startObject();
+                        state_ = State::Key;
+                        allowClose_ = true;
+                    } else if (c == '[') {
+                        stack_.push_back(false);
+                        handler_.startArray();
+                        state_ = State::Value;
+                        allowClose_ = true;
+                    } else if (c == '"') {
+                        stringIsKey_ = false;
+                        scratch_.clear();
+                        state_ = State::String;
+                    } else if (c == '-' || (c >= '0' && c <= '9')) {
+                        scratch_.assign(1, c);
+                        state_ = State::Number;
+                    } else if (c == 't' || c == 'f' || c == 'n') {
+                        scratch_.assign(1, c);
+                        state_ = State::Literal;
+                    } else if (c == ']' && allowClose_ && !stack_.empty() && !stack_.back()) {
+                        stack_.pop_back();
+                        handler_.endArray();
+                        valueDone();
+                    } else {
+                        fail("expected a value");
+                    }
+                } else if (state_ == State::Key) {
+                    if (c == '"') {
+                        stringIsKey_ = true;
+                        scratch_.clear();
+                        state_ = State::String;
+                    } else if (c == '}' && allowClose_) {
+                        stack_.pop_back();
+                        handler_.endObject();
+                        valueDone();
+                    } else {
+                        fail("expected a key");
+                    }
+                } else if (state_ == State::Colon) {
+                    if (c != ':') fail("expected ':'");
+                    state_ = State::Value;
+                    allowClose_ = false;
+                } else if (state_ == State::AfterValue) {
+                    bool inObject = stack_.back();
+                    if (c == ',') {
+                        state_ = inObject ? State::Key : State::Value;
+                        allowClose_ = false;
+                    } else if (c == '}' && inObject) {
+                        stack_.pop_back();
+                        handler_.endObject();
+                        valueDone();
+                    } else if (c == ']' && !inObject) {
+                        stack_.pop_back();
+                        handler_.endArray();
+                        valueDone();
+                    } else {
+                        fail("expected ',' or a closing bracket");
+                    }
+                } else {
+                    fail("trailing characters after the document");
+                }
+                break;
+            }
+        }
+    }
+    consumed_ += size;
+}
+
+/*
+ * @brief Flushes a trailing top-level number or literal and checks the
+ * document is complete.
+ */
+void JsonPushParser::finish() {
+    if (state_ == State::Number) emitNumber();
+    else if (state_ == State::Literal) emitLiteral();
+
+    if (state_ != State::Done) {
+        fail("unexpected end of input");
+    }
+}
+
+void JsonPushParser::reset() {
+    state_ = State::Value;
+    stringIsKey_ = false;
+    allowClose_ = false;
+    stack_.clear();
+    scratch_.clear();
+    highSurrogate_ = 0;
+    consumed_ = 0;
+}
+
+/*----------------------*/
+/*      Tokens          */
+/*----------------------*/
+void JsonPushParser::valueDone() {
+    state_ = stack_.empty() ? State::Done : State::AfterValue;
+}
+
+void JsonPushParser::emitString(std::string_view text) {
+    if (stringIsKey_) {
+        handler_.key(text);
+        state_ = State::Colon;
+    } else {
+        handler_.string(text);
+        valueDone();
+    }
+    scratch_.clear();
+}
+
+void JsonPushParser::emitNumber() {
+    double value = 0;
+    const char* first = scratch_.data();
+    const char* last = first + scratch_.size();
+    auto [ptr, ec] = std::from_chars(first, last, value);
+    if (ec != std::errc() || ptr != last) {
+        fail("bad number");
+    }
+    scratch_.clear();
+    handler_.number(value);
+    valueDone();
+}
+
+void JsonPushParser::emitLiteral() {
+    if (scratch_ == "true") handler_.boolean(true);
+    else if (scratch_ == "false") handler_.boolean(false);
+    else if (scratch_ == "null") handler_.null();
+    else fail("bad literal");
+    scratch_.clear();
+    valueDone();
+}
+
+void JsonPushParser::appendUtf8(std::uint32_t cp) {
+    if (cp < 0x80) {
+        scratch_ += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        scratch_ += static_cast<char>(0xC0 | (cp >> 6));
+        scratch_ += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        scratch_ += static_cast<char>(0xE0 | (cp >> 12));
+        scratch_ += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        scratch_ += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        scratch_ += static_cast<char>(0xF0 | (cp >> 18));
+        scratch_ += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        scratch_ += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        scratch_ += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+void JsonPushParser::fail(const char* what) const {
+    throw std::runtime_error(string("JSON parse error (") + what + ") in chunk starting at byte "
+                             + std::to_string(consumed_));
+}
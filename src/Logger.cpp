@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "logger.hpp"
+
+using string = std::string;
+
+const char* logLevelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::Trace: return "TRACE";
+        case LogLevel::Debug: return "DEBUG";
+        case LogLevel::Info:  return "INFO";
+        case LogLevel::Warn:  return "WARN";
+        case LogLevel::Error: return "ERROR";
+        case LogLevel::Off:   return "OFF";
+    }
+    return "?";
+}
+
+const char* logComponentName(LogComponent component) {
+    switch (component) {
+        case LogComponent::Client:  return "client";
+        case LogComponent::Http:    return "http";
+        case LogComponent::Tokens:  return "tokens";
+        case LogComponent::Loop:    return "loop";
+        case LogComponent::Storage: return "storage";
+        case LogComponent::Stream:  return "stream";
+        case LogComponent::Count:   break;
+    }
+    return "?";
+}
+
+//==============================================================================
+//                                  Logger
+//==============================================================================
+
+/*
+ * The logger is deliberately leaked so objects destroyed late in exit can
+ * still log; stop() drains the ring from an atexit handler instead.
+ */
+Logger& Logger::instance() {
+    static Logger* logger = new Logger();
+    return *logger;
+}
+
+Logger::Logger() : slots_{std::make_unique<Slot[]>(slotCount)} {
+    static_assert((slotCount & (slotCount - 1)) == 0, "slotCount must be a power of two");
+    for (auto& level : levels_) {
+        level.store(LogLevel::Info, std::memory_order_relaxed);
+    }
+    for (std::size_t i = 0; i < slotCount; ++i) {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    sink_ = [](const LogRecord& record) {
+        string line = format(record);
+        line += '\n';
+        std::fwrite(line.data(), 1, line.size(), stderr);
+    };
+    thread_ = std::thread(&Logger::run, this);
+    std::atexit([] { instance().stop(); });
+}
+
+/*------------------------------*/
+/*      Configuration           */
+/*------------------------------*/
+void Logger::setLevel(LogComponent component, LogLevel level) {
+    levels_[static_cast<std::size_t>(component)].store(level, std::memory_order_relaxed);
+}
+
+void Logger::setLevel(LogLevel level) {
+    for (auto& current : levels_) {
+        current.store(level, std::memory_order_relaxed);
+    }
+}
+
+LogLevel Logger::level(LogComponent component) const {
+    return levels_[static_cast<std::size_t>(component)].load(std::memory_order_relaxed);
+}
+
+void Logger::setSink(LogSink sink) {
+    std::lock_guard<std::mutex> lock(sinkMutex_);
+    sink_ = std::move(sink);
+}
+
+/*------------------------------*/
+/*      Producers               */
+/*------------------------------*/
+/*
+ * @brief Claims a slot, copies the line in and publishes it. Never blocks:
+ * when the ring is full the line is counted as dropped. After exit has
+ * stopped the thread, lines go straight to the sink.
+ */
+void Logger::write(LogComponent component, LogLevel level, std::string_view message) {
+    auto now = std::chrono::system_clock::now();
+    if (!running_.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(sinkMutex_);
+        if (sink_) {
+            sink_(LogRecord{now, level, component, message});
+        }
+        return;
+    }
+
+    std::size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &slots_[pos & (slotCount - 1)];
+        std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+        if (diff == 0) {
+            if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    std::size_t size = std::min(message.size(), maxMessage);
+    std::copy_n(message.data(), size, slot->message);
+    slot->size = static_cast<std::uint16_t>(size);
+    slot->time = now;
+    slot->level = level;
+    slot->component = component;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
+    // Pairs with the fence in run(): either it sees this slot or we see it asleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed) && sleeping_.exchange(false)) {
+        sleeping_.notify_one();
+    }
+}
+
+void Logger::flush() {
+    std::size_t target = enqueuePos_.load(std::memory_order_acquire);
+    while (running_.load(std::memory_order_acquire)
+           && dequeuePos_.load(std::memory_order_acquire) < target) {
+        if (sleeping_.exchange(false)) {
+            sleeping_.notify_one();
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+/*------------------------------*/
+/*      Logger thread           */
+/*------------------------------*/
+bool Logger::drain() {
+    bool wrote = false;
+    std::lock_guard<std::mutex> lock(sinkMutex_);
+    for (;;) {
+        std::size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        Slot& slot = slots_[pos & (slotCount - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1) {
+            return wrote;
+        }
+        if (sink_) {
+            try {
+                sink_(LogRecord{slot.time, slot.level, slot.component,
+                                std::string_view(slot.message, slot.size)});
+            } catch (...) {
+                // a failing sink must not take the logger down
+            }
+        }
+        slot.sequence.store(pos + slotCount, std::memory_order_release);
+        dequeuePos_.store(pos + 1, std::memory_order_release);
+        wrote = true;
+    }
+}
+
+/*
+ * Drains until stopped, sleeping on sleeping_ while the ring is empty.
+ * Producers only touch the flag's cache line when the thread is asleep.
+ */
+void Logger::run() {
+    while (running_.load(std::memory_order_acquire)) {
+        if (drain()) {
+            continue;
+        }
+        sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (drain() || !running_.load()) {
+            sleeping_.store(false, std::memory_order_relaxed);
+            continue;
+        }
+        sleeping_.wait(true);
+    }
+    drain();
+}
+
+void Logger::stop() {
+    running_.store(false);
+    sleeping_.store(false);
+    sleeping_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+/*------------------------------*/
+/*      Formatting              */
+/*------------------------------*/
+string Logger::format(const LogRecord& record) {
+    auto sinceEpoch = record.time.time_since_epoch();
+    std::time_t seconds = std::chrono::duration_cast<std::chrono::seconds>(sinceEpoch).count();
+    auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(sinceEpoch).count() % 1000;
+    std::tm utc{};
+    gmtime_r(&seconds, &utc);
+
+    char prefix[64];
+    int size = std::snprintf(prefix, sizeof(prefix), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ %-5s %s: ",
+                             utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday,
+                             utc.tm_hour, utc.tm_min, utc.tm_sec, static_cast<int>(millis),
+                             logLevelName(record.level), logComponentName(record.component));
+    string line(prefix, static_cast<std::size_t>(std::max(size, 0)));
+    line.append(record.message);
+    return line;
+}
+
+/*------------------------------*/
+/*      Line formatting         */
+/*------------------------------*/
+void Logger::Line::append(std::string_view text) {
+    std::size_t size = std::min(text.size(), maxMessage - size_);
+    std::copy_n(text.data(), size, data_ + size_);
+    size_ += size;
+}
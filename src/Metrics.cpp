@@ -0,0 +1,287 @@
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include <curl/curl.h>
+
+#include "metrics.hpp"
+
+using string = std::string;
+
+//==============================================================================
+//                              LatencyHistogram
+//==============================================================================
+/*
+ * Values below 2^subBits get a bucket each. Above that, each power of two
+ * is split into 2^subBits equal buckets, indexed by the bits just below
+ * the leading one.
+ */
+std::size_t LatencyHistogram::bucketOf(std::uint64_t us) {
+    constexpr std::uint64_t linear = 1ULL << subBits;
+    us = std::min<std::uint64_t>(us, (1ULL << maxBits) - 1);
+    if (us < linear) {
+        return static_cast<std::size_t>(us);
+    }
+    int top = std::bit_width(us) - 1;                   // >= subBits
+    int group = top - subBits + 1;
+    std::uint64_t sub = (us >> (top - subBits)) & (linear - 1);
+    return (static_cast<std::size_t>(group) << subBits) + static_cast<std::size_t>(sub);
+}
+
+std::uint64_t LatencyHistogram::bucketUpper(std::size_t bucket) {
+    constexpr std::uint64_t linear = 1ULL << subBits;
+    std::size_t group = bucket >> subBits;
+    std::uint64_t sub = bucket & (linear - 1);
+    if (group == 0) {
+        return sub + 1;
+    }
+    return (linear + sub + 1) << (group - 1);
+}
+
+void LatencyHistogram::record(std::uint64_t us) {
+    buckets_[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(us, std::memory_order_relaxed);
+    std::uint64_t seen = max_.load(std::memory_order_relaxed);
+    while (us > seen && !max_.compare_exchange_weak(seen, us, std::memory_order_relaxed)) { }
+}
+
+/*
+ * Counts are read one by one, so a snapshot taken under load may be off
+ * by the few requests recorded while it was being taken.
+ */
+HistogramSnapshot LatencyHistogram::snapshot() const {
+    HistogramSnapshot out;
+    out.buckets.resize(bucketCount);
+    for (std::size_t i = 0; i < bucketCount; ++i) {
+        out.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        out.count += out.buckets[i];
+    }
+    out.sumUs = sum_.load(std::memory_order_relaxed);
+    out.maxUs = max_.load(std::memory_order_relaxed);
+    return out;
+}
+
+/*
+ * Upper edge of the bucket holding the q-th value, capped at the maximum
+ * seen.
+ */
+double HistogramSnapshot::percentileUs(double q) const {
+    if (count == 0) {
+        return 0.0;
+    }
+    auto rank = static_cast<std::uint64_t>(std::clamp(q, 0.0, 1.0) * (count - 1)) + 1;
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return static_cast<double>(std::min(LatencyHistogram::bucketUpper(i) - 1, maxUs));
+        }
+    }
+    return static_cast<double>(maxUs);
+}
+
+//==============================================================================
+//                              EndpointMetrics
+//==============================================================================
+/*
+ * @brief Records a finished transfer. curl reports each phase as time
+ * since the start of the request, so phases are the differences. A
+ * reused connection has no DNS, connect or TLS phase, and those are
+ * only recorded when the request opened a new connection.
+ */
+void EndpointMetrics::record(CURL* curl, CURLcode rc, long status) {
+    requests_.fetch_add(1, std::memory_order_relaxed);
+    if (rc != CURLE_OK) {
+        errors_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (status == 429) {
+        status429_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    curl_off_t nameLookup = 0, connect = 0, appConnect = 0, startTransfer = 0, total = 0;
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &nameLookup);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &appConnect);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &startTransfer);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+
+    long connects = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+    if (connects > 0) {
+        connectionsOpened_.fetch_add(static_cast<std::uint64_t>(connects), std::memory_order_relaxed);
+        dns_.record(static_cast<std::uint64_t>(nameLookup));
+        connect_.record(static_cast<std::uint64_t>(std::max<curl_off_t>(connect - nameLookup, 0)));
+        if (appConnect > 0) {
+            tls_.record(static_cast<std::uint64_t>(std::max<curl_off_t>(appConnect - connect, 0)));
+        }
+    }
+    if (startTransfer > 0) {
+        curl_off_t sent = std::max(appConnect, connect);
+        server_.record(static_cast<std::uint64_t>(std::max<curl_off_t>(startTransfer - sent, 0)));
+        transfer_.record(static_cast<std::uint64_t>(std::max<curl_off_t>(total - startTransfer, 0)));
+    }
+    total_.record(static_cast<std::uint64_t>(total));
+
+    curl_off_t downloaded = 0;
+    long headerBytes = 0, requestBytes = 0;
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &downloaded);
+    curl_easy_getinfo(curl, CURLINFO_HEADER_SIZE, &headerBytes);
+    curl_easy_getinfo(curl, CURLINFO_REQUEST_SIZE, &requestBytes);
+    bytesIn_.fetch_add(static_cast<std::uint64_t>(downloaded + headerBytes), std::memory_order_relaxed);
+    bytesOut_.fetch_add(static_cast<std::uint64_t>(requestBytes), std::memory_order_relaxed);
+}
+
+EndpointSnapshot EndpointMetrics::snapshot() const {
+    EndpointSnapshot out;
+    out.endpoint = name_;
+    out.requests = requests_.load(std::memory_order_relaxed);
+    out.errors = errors_.load(std::memory_order_relaxed);
+    out.status429 = status429_.load(std::memory_order_relaxed);
+    out.retries = retries_.load(std::memory_order_relaxed);
+    out.coalesced = coalesced_.load(std::memory_order_relaxed);
+    out.errorRetries = errorRetries_.load(std::memory_order_relaxed);
+    out.hedges = hedges_.load(std::memory_order_relaxed);
+    out.hedgeWins = hedgeWins_.load(std::memory_order_relaxed);
+    out.deadlineExceeded = deadlineExceeded_.load(std::memory_order_relaxed);
+    out.bytesIn = bytesIn_.load(std::memory_order_relaxed);
+    out.bytesOut = bytesOut_.load(std::memory_order_relaxed);
+    out.connectionsOpened = connectionsOpened_.load(std::memory_order_relaxed);
+    out.dns = dns_.snapshot();
+    out.connect = connect_.snapshot();
+    out.tls = tls_.snapshot();
+    out.server = server_.snapshot();
+    out.transfer = transfer_.snapshot();
+    out.total = total_.snapshot();
+    out.parse = parse_.snapshot();
+    return out;
+}
+
+//==============================================================================
+//                                  Metrics
+//==============================================================================
+// Path segments after "marketdata/v1/"; "other" must stay last
+static constexpr const char* endpointNames[] = {
+    "pricehistory", "chains", "expirationchain", "markets", "movers",
+    "instruments", "quotes", "other"
+};
+
+Metrics::Metrics() {
+    for (const char* name : endpointNames) {
+        endpoints_.emplace_back(name);
+    }
+}
+
+/*
+ * Matches the first path segment after "marketdata/v1/". Single-symbol
+ * quotes ("marketdata/v1/AAPL/quotes") are matched by their last segment.
+ */
+EndpointMetrics& Metrics::endpoint(std::string_view url) {
+    constexpr std::string_view root = "marketdata/v1/";
+    auto start = url.find(root);
+    if (start != std::string_view::npos) {
+        std::string_view path = url.substr(start + root.size());
+        path = path.substr(0, path.find('?'));
+        std::string_view first = path.substr(0, path.find('/'));
+        std::string_view last = path.substr(path.rfind('/') + 1);
+        std::string_view name = last == "quotes" ? last : first;
+        for (auto& endpoint : endpoints_) {
+            if (name == endpoint.name()) return endpoint;
+        }
+    }
+    return endpoints_.back();
+}
+
+void Metrics::tokenRefreshed(std::chrono::steady_clock::duration elapsed, bool ok) {
+    tokenRefreshes_.fetch_add(1, std::memory_order_relaxed);
+    if (!ok) {
+        tokenRefreshFailures_.fetch_add(1, std::memory_order_relaxed);
+    }
+    tokenRefresh_.record(elapsed);
+}
+
+MetricsSnapshot Metrics::snapshot() const {
+    MetricsSnapshot out;
+    for (auto const& endpoint : endpoints_) {
+        out.endpoints.push_back(endpoint.snapshot());
+    }
+    out.tokenRefreshes = tokenRefreshes_.load(std::memory_order_relaxed);
+    out.tokenRefreshFailures = tokenRefreshFailures_.load(std::memory_order_relaxed);
+    out.tokenRefresh = tokenRefresh_.snapshot();
+    return out;
+}
+
+/*------------------------------*/
+/*      Prometheus text         */
+/*------------------------------*/
+/*
+ * Histograms are exported as summaries (p50/p90/p99/p999 plus sum and
+ * count) in seconds; the full bucket array is available from snapshot().
+ */
+static void writeSummary(std::ostringstream& out, const char* name, const string& labels,
+                         const HistogramSnapshot& h) {
+    char value[32];
+    for (double q : {0.5, 0.9, 0.99, 0.999}) {
+        std::snprintf(value, sizeof(value), "%.6f", h.percentileUs(q) / 1e6);
+        out << name << '{' << labels << (labels.empty() ? "" : ",") << "quantile=\"" << q << "\"} "
+            << value << '\n';
+    }
+    std::snprintf(value, sizeof(value), "%.6f", h.sumUs / 1e6);
+    string braces = labels.empty() ? "" : "{" + labels + "}";
+    out << name << "_sum" << braces << ' ' << value << '\n';
+    out << name << "_count" << braces << ' ' << h.count << '\n';
+}
+
+string Metrics::prometheus() const {
+    MetricsSnapshot snap = snapshot();
+    std::ostringstream out;
+
+    auto counter = [&](const char* name, const char* help, auto field) {
+        out << "# HELP " << name << ' ' << help << '\n'
+            << "# TYPE " << name << " counter\n";
+        for (auto const& e : snap.endpoints) {
+            out << name << "{endpoint=\"" << e.endpoint << "\"} " << e.*field << '\n';
+        }
+    };
+    counter("schwab_requests_total", "Requests sent.", &EndpointSnapshot::requests);
+    counter("schwab_request_errors_total", "Requests that failed at the transport level.", &EndpointSnapshot::errors);
+    counter("schwab_http_429_total", "Responses with status 429.", &EndpointSnapshot::status429);
+    counter("schwab_retries_total", "Requests retried after a token refresh.", &EndpointSnapshot::retries);
+    counter("schwab_coalesced_total", "Calls served by an identical request already in flight.",
+            &EndpointSnapshot::coalesced);
+    counter("schwab_error_retries_total", "Requests retried after a 5xx, 429, timeout or dropped connection.",
+            &EndpointSnapshot::errorRetries);
+    counter("schwab_hedges_total", "Duplicate requests sent for a slow one.", &EndpointSnapshot::hedges);
+    counter("schwab_hedge_wins_total", "Hedges that answered first.", &EndpointSnapshot::hedgeWins);
+    counter("schwab_deadline_exceeded_total", "Calls that ran out of time before an answer.",
+            &EndpointSnapshot::deadlineExceeded);
+    counter("schwab_bytes_in_total", "Response bytes including headers.", &EndpointSnapshot::bytesIn);
+    counter("schwab_bytes_out_total", "Request bytes.", &EndpointSnapshot::bytesOut);
+    counter("schwab_connections_opened_total", "New connections.", &EndpointSnapshot::connectionsOpened);
+
+    out << "# HELP schwab_request_phase_seconds Time per request phase.\n"
+        << "# TYPE schwab_request_phase_seconds summary\n";
+    for (auto const& e : snap.endpoints) {
+        const std::pair<const char*, const HistogramSnapshot*> phases[] = {
+            {"dns", &e.dns}, {"connect", &e.connect}, {"tls", &e.tls}, {"server", &e.server},
+            {"transfer", &e.transfer}, {"total", &e.total}, {"parse", &e.parse}
+        };
+        for (auto const& [phase, h] : phases) {
+            string labels = "endpoint=\"" + e.endpoint + "\",phase=\"" + phase + "\"";
+            writeSummary(out, "schwab_request_phase_seconds", labels, *h);
+        }
+    }
+
+    out << "# HELP schwab_token_refreshes_total Token refreshes attempted.\n"
+        << "# TYPE schwab_token_refreshes_total counter\n"
+        << "schwab_token_refreshes_total " << snap.tokenRefreshes << '\n'
+        << "# HELP schwab_token_refresh_failures_total Token refreshes that failed.\n"
+        << "# TYPE schwab_token_refresh_failures_total counter\n"
+        << "schwab_token_refresh_failures_total " << snap.tokenRefreshFailures << '\n'
+        << "# HELP schwab_token_refresh_seconds Token refresh duration.\n"
+        << "# TYPE schwab_token_refresh_seconds summary\n";
+    writeSummary(out, "schwab_token_refresh_seconds", "", snap.tokenRefresh);
+    return out.str();
+}
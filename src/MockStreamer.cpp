@@ -0,0 +1,378 @@
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <nlohmann/json.hpp>
+
+#include "mock_streamer.hpp"
+#include "stream_fields.hpp"
+#include "websocket.hpp"
+
+using string = std::string;
+using json = nlohmann::json;
+
+#ifdef MSG_NOSIGNAL
+static constexpr int sendFlags = MSG_NOSIGNAL;
+#else
+static constexpr int sendFlags = 0;
+#endif
+
+static long long nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+template <typename T>
+static void appendNumber(string& out, T value) {
+    char text[32];
+    auto [end, ec] = std::to_chars(text, text + sizeof(text), value);
+    out.append(text, end);
+}
+
+//==============================================================================
+//                              MockStreamer
+//==============================================================================
+MockStreamer::MockStreamer(MockStreamerConfig config)
+    : config_{config},
+      reader_{std::make_unique<WsReader>()}
+{
+    listenFd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd_ < 0) {
+        throw std::runtime_error("MockStreamer: socket() failed");
+    }
+    int yes = 1;
+    ::setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(config_.port);
+    socklen_t length = sizeof(address);
+    if (::bind(listenFd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+        || ::listen(listenFd_, 4) != 0
+        || ::getsockname(listenFd_, reinterpret_cast<sockaddr*>(&address), &length) != 0
+        || ::pipe(wakeFds_) != 0) {
+        ::close(listenFd_);
+        throw std::runtime_error("MockStreamer: cannot listen on port " + std::to_string(config_.port));
+    }
+    port_ = ntohs(address.sin_port);
+    ::fcntl(wakeFds_[0], F_SETFL, ::fcntl(wakeFds_[0], F_GETFL) | O_NONBLOCK);
+
+    thread_ = std::thread(&MockStreamer::run, this);
+}
+
+MockStreamer::~MockStreamer() {
+    running_ = false;
+    char byte = 1;
+    [[maybe_unused]] auto written = ::write(wakeFds_[1], &byte, 1);
+    thread_.join();
+    closeClient();
+    ::close(listenFd_);
+    ::close(wakeFds_[0]);
+    ::close(wakeFds_[1]);
+}
+
+StreamerInfo MockStreamer::info() const {
+    return {"ws://127.0.0.1:" + std::to_string(port_) + "/ws", "mock-customer", "mock-correl", "N9", "APIAPP"};
+}
+
+std::vector<string> MockStreamer::subscriptions(StreamService service) const {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    const auto& symbols = symbols_[static_cast<int>(service)];
+    return {symbols.begin(), symbols.end()};
+}
+
+bool MockStreamer::waitForSubscriptions(StreamService service, std::size_t count, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(stateMutex_);
+    return stateChanged_.wait_for(lock, timeout, [&] {
+        return loggedIn_ && symbols_[static_cast<int>(service)].size() >= count;
+    });
+}
+
+/*------------------------------*/
+/*      Publishing              */
+/*------------------------------*/
+static void openData(string& frame, StreamService service, long long timestamp) {
+    frame += R"({"data":[{"service":")";
+    frame += serviceName(service);
+    frame += R"(","timestamp":)";
+    appendNumber(frame, timestamp ? timestamp : nowMs());
+    frame += R"(,"command":"SUBS","content":[)";
+}
+
+bool MockStreamer::publish(std::span<const LevelOneQuote> quotes) {
+    string frame;
+    openData(frame, StreamService::LevelOneEquities, quotes.empty() ? 0 : quotes.front().serverTime);
+    for (const auto& quote : quotes) {
+        frame += frame.back() == '[' ? R"({"key":")" : R"(,{"key":")";
+        frame.append(quote.symbol.view());
+        frame += R"(","delayed":false)";
+        for (LevelOneField field : levelOneFields) {
+            if (!quote.has(field)) {
+                continue;
+            }
+            frame += ",\"";
+            appendNumber(frame, static_cast<unsigned>(field));
+            frame += "\":";
+            visitField(quote, static_cast<unsigned>(field), [&](auto value) { appendNumber(frame, value); });
+        }
+        frame += '}';
+    }
+    frame += "]}]}";
+    return publishRaw(frame);
+}
+
+bool MockStreamer::publish(std::span<const ChartBar> bars) {
+    string frame;
+    openData(frame, StreamService::ChartEquity, bars.empty() ? 0 : bars.front().serverTime);
+    for (const auto& bar : bars) {
+        frame += frame.back() == '[' ? R"({"key":")" : R"(,{"key":")";
+        frame.append(bar.symbol.view());
+        frame += '"';
+        for (unsigned field = 1; field < chartFieldCount; ++field) {
+            frame += ",\"";
+            appendNumber(frame, field);
+            frame += "\":";
+            visitField(bar, field, [&](auto value) { appendNumber(frame, value); });
+        }
+        frame += '}';
+    }
+    frame += "]}]}";
+    return publishRaw(frame);
+}
+
+bool MockStreamer::publishRaw(std::string_view frame) {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        if (!loggedIn_) {
+            return false;
+        }
+    }
+    return sendFrame(WsOpcode::Text, frame);
+}
+
+bool MockStreamer::sendFrame(WsOpcode opcode, std::string_view payload) {
+    string frame;
+    wsAppendFrame(frame, opcode, payload);
+
+    std::lock_guard<std::mutex> lock(sendMutex_);
+    std::string_view rest = frame;
+    while (clientFd_ >= 0 && !rest.empty()) {
+        ssize_t n = ::send(clientFd_, rest.data(), rest.size(), sendFlags);
+        if (n <= 0) {
+            return false;
+        }
+        rest.remove_prefix(static_cast<std::size_t>(n));
+    }
+    return rest.empty();
+}
+
+void MockStreamer::disconnect() {
+    std::lock_guard<std::mutex> lock(sendMutex_);
+    if (clientFd_ >= 0) {
+        ::shutdown(clientFd_, SHUT_RDWR);
+    }
+}
+
+/*------------------------------*/
+/*      Server thread           */
+/*------------------------------*/
+void MockStreamer::run() {
+    auto nextHeartbeat = std::chrono::steady_clock::now() + config_.heartbeat;
+    while (running_) {
+        int client;
+        {
+            std::lock_guard<std::mutex> lock(sendMutex_);
+            client = clientFd_;
+        }
+        pollfd fds[3] = {{wakeFds_[0], POLLIN, 0}, {listenFd_, POLLIN, 0}, {client, POLLIN, 0}};
+        ::poll(fds, client >= 0 ? 3 : 2, 100);
+
+        if (fds[1].revents & POLLIN) {
+            acceptClient();
+        } else if (client >= 0 && fds[2].revents && !readClient()) {
+            closeClient();
+        }
+
+        bool loggedIn;
+        {
+            std::lock_guard<std::mutex> lock(stateMutex_);
+            loggedIn = loggedIn_;
+        }
+        if (loggedIn && config_.heartbeat.count() > 0 && std::chrono::steady_clock::now() >= nextHeartbeat) {
+            sendFrame(WsOpcode::Text, R"({"notify":[{"heartbeat":")" + std::to_string(nowMs()) + "\"}]}");
+            nextHeartbeat = std::chrono::steady_clock::now() + config_.heartbeat;
+        }
+    }
+}
+
+// A new client replaces the current one
+void MockStreamer::acceptClient() {
+    int fd = ::accept(listenFd_, nullptr, nullptr);
+    if (fd < 0) {
+        return;
+    }
+    closeClient();
+    int yes = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    std::lock_guard<std::mutex> lock(sendMutex_);
+    clientFd_ = fd;
+}
+
+void MockStreamer::closeClient() {
+    {
+        std::lock_guard<std::mutex> lock(sendMutex_);
+        if (clientFd_ >= 0) {
+            ::close(clientFd_);
+        }
+        clientFd_ = -1;
+    }
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        loggedIn_ = false;
+        symbols_[0].clear();
+        symbols_[1].clear();
+    }
+    stateChanged_.notify_all();
+    inbound_.clear();
+    upgraded_ = false;
+    reader_->reset();
+}
+
+// False once the client has gone
+bool MockStreamer::readClient() {
+    char chunk[16384];
+    ssize_t n = ::recv(clientFd_, chunk, sizeof(chunk), 0);
+    if (n <= 0) {
+        return false;
+    }
+    if (!upgraded_) {
+        inbound_.append(chunk, static_cast<std::size_t>(n));
+        return inbound_.find("\r\n\r\n") == string::npos || upgrade();
+    }
+
+    reader_->append(chunk, static_cast<std::size_t>(n));
+    WsReader::Message message;
+    while (reader_->next(message)) {
+        switch (message.opcode) {
+            case WsOpcode::Text:
+                handleRequests(message.payload);
+                break;
+            case WsOpcode::Ping:
+                sendFrame(WsOpcode::Pong, message.payload);
+                break;
+            case WsOpcode::Close:
+                sendFrame(WsOpcode::Close, message.payload.substr(0, 2));
+                return false;
+            default:
+                break;
+        }
+    }
+    return !reader_->error();
+}
+
+bool MockStreamer::upgrade() {
+    string head = inbound_.substr(0, inbound_.find("\r\n\r\n") + 2);
+    string lower = head;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    std::size_t at = lower.find("\r\nsec-websocket-key:");
+    if (head.compare(0, 4, "GET ") != 0 || at == string::npos) {
+        sendFrame(WsOpcode::Close, "");
+        return false;
+    }
+    at += 20;
+    std::size_t end = head.find("\r\n", at);
+    string key = head.substr(at, end - at);
+    key.erase(0, key.find_first_not_of(' '));
+    key.erase(key.find_last_not_of(' ') + 1);
+
+    string response = "HTTP/1.1 101 Switching Protocols\r\n"
+                      "Upgrade: websocket\r\n"
+                      "Connection: Upgrade\r\n"
+                      "Sec-WebSocket-Accept: " + wsAcceptKey(key) + "\r\n\r\n";
+    {
+        std::lock_guard<std::mutex> lock(sendMutex_);
+        if (::send(clientFd_, response.data(), response.size(), sendFlags) != static_cast<ssize_t>(response.size())) {
+            return false;
+        }
+    }
+    upgraded_ = true;
+    reader_->append(inbound_.data() + head.size() + 2, inbound_.size() - head.size() - 2);
+    inbound_.clear();
+    return true;
+}
+
+/*
+ * Answers each request the way the server does, with a response carrying
+ * the request's id and a content code (0 for success).
+ */
+void MockStreamer::handleRequests(std::string_view text) {
+    json message = json::parse(text, nullptr, false);
+    json requests = message.is_object() && message.contains("requests") ? message["requests"] : message;
+    if (!requests.is_array()) {
+        requests = json::array({requests});
+    }
+
+    for (const auto& request : requests) {
+        if (!request.is_object()) {
+            continue;
+        }
+        string service = request.value("service", "");
+        string command = request.value("command", "");
+        int code = 0;
+        {
+            std::lock_guard<std::mutex> lock(stateMutex_);
+            if (command == "LOGIN") {
+                code = config_.loginCode;
+                loggedIn_ = code == 0;
+                logins_ += loggedIn_;
+            } else if (command == "LOGOUT") {
+                loggedIn_ = false;
+            } else if (!loggedIn_) {
+                code = 3;
+            } else if (int index = serviceIndex(service); index >= 0) {
+                auto& symbols = symbols_[index];
+                if (command == "SUBS") {
+                    symbols.clear();
+                }
+                string keys = request.contains("parameters") ? request["parameters"].value("keys", "") : "";
+                for (std::size_t start = 0; start < keys.size(); ) {
+                    std::size_t comma = std::min(keys.find(',', start), keys.size());
+                    string symbol = keys.substr(start, comma - start);
+                    if (command == "UNSUBS") {
+                        symbols.erase(symbol);
+                    } else if (!symbol.empty()) {
+                        symbols.insert(symbol);
+                    }
+                    start = comma + 1;
+                }
+            } else {
+                code = 11;      // service not available
+            }
+        }
+        stateChanged_.notify_all();
+
+        json response = {
+            {"service", service},
+            {"command", command},
+            {"requestid", request.value("requestid", "")},
+            {"SchwabClientCorrelId", request.value("SchwabClientCorrelId", "")},
+            {"timestamp", nowMs()},
+            {"content", {{"code", code}, {"msg", code == 0 ? command + " command succeeded" : "Request failed"}}}
+        };
+        sendFrame(WsOpcode::Text, json{{"response", json::array({response})}}.dump());
+    }
+}
@@ -0,0 +1,415 @@
+#include <cctype>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+#include "logger.hpp"
+#include "oauth_callback.hpp"
+
+using string = std::string;
+
+#ifdef MSG_NOSIGNAL
+static constexpr int sendFlags = MSG_NOSIGNAL;
+#else
+static constexpr int sendFlags = 0;
+#endif
+
+//==============================================================================
+//                              Query parsing
+//==============================================================================
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static string urlDecode(std::string_view text) {
+    string out;
+    out.reserve(text.size());
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '+') {
+            out += ' ';
+        } else if (text[i] == '%' && i + 2 < text.size() && hexValue(text[i + 1]) >= 0
+                   && hexValue(text[i + 2]) >= 0) {
+            out += static_cast<char>(hexValue(text[i + 1]) * 16 + hexValue(text[i + 2]));
+            i += 2;
+        } else {
+            out += text[i];
+        }
+    }
+    return out;
+}
+
+/*
+ * A pasted "code=...&session=..." without the URL in front is read as
+ * the query itself.
+ */
+string queryParam(std::string_view url, std::string_view name) {
+    std::string_view query = url;
+    if (auto mark = url.find('?'); mark != std::string_view::npos) {
+        query = url.substr(mark + 1);
+    }
+    query = query.substr(0, query.find('#'));
+    while (!query.empty()) {
+        std::size_t amp = query.find('&');
+        std::string_view pair = query.substr(0, amp);
+        std::size_t eq = pair.find('=');
+        if (pair.substr(0, eq) == name) {
+            return eq == std::string_view::npos ? "" : urlDecode(pair.substr(eq + 1));
+        }
+        if (amp == std::string_view::npos) {
+            break;
+        }
+        query.remove_prefix(amp + 1);
+    }
+    return "";
+}
+
+// Throws when the authorization server redirected with an error
+static void checkDenied(std::string_view url) {
+    string error = queryParam(url, "error");
+    if (!error.empty()) {
+        string description = queryParam(url, "error_description");
+        throw std::runtime_error("Authorization failed: " + error
+                                 + (description.empty() ? "" : " (" + description + ")"));
+    }
+}
+
+static bool isSpace(char c) {
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+}
+
+//==============================================================================
+//                              TLS for the callback
+//==============================================================================
+static string sslError() {
+    char text[256] = "unknown error";
+    if (unsigned long code = ERR_get_error()) {
+        ERR_error_string_n(code, text, sizeof(text));
+    }
+    ERR_clear_error();
+    return text;
+}
+
+/*
+ * @brief A server context with a fresh P-256 key and a certificate for
+ * host signed by itself, valid for a day. Nothing is written to disk.
+ * Returns nullptr, logging why, if OpenSSL fails.
+ */
+static SSL_CTX* selfSignedContext(std::string_view host) {
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    SSL_CTX* ctx = nullptr;
+    if (key && cert) {
+        string name(host);
+        string altName = (host == "localhost" ? "DNS:" : "IP:") + name;
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), static_cast<long>(std::time(nullptr)));
+        X509_gmtime_adj(X509_getm_notBefore(cert), -60);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 60 * 60);
+        X509_set_pubkey(cert, key);
+        X509_NAME* subject = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(subject, "CN", MBSTRING_ASC,
+                                   reinterpret_cast<const unsigned char*>(name.c_str()), -1, -1, 0);
+        X509_set_issuer_name(cert, subject);
+
+        // Browsers match the host against subjectAltName, not the CN
+        X509V3_CTX v3;
+        X509V3_set_ctx_nodb(&v3);
+        X509V3_set_ctx(&v3, cert, cert, nullptr, nullptr, 0);
+        X509_EXTENSION* ext = X509V3_EXT_conf_nid(nullptr, &v3, NID_subject_alt_name, altName.c_str());
+        if (ext && X509_add_ext(cert, ext, -1) && X509_sign(cert, key, EVP_sha256()) > 0) {
+            ctx = SSL_CTX_new(TLS_server_method());
+        }
+        X509_EXTENSION_free(ext);
+        if (ctx && (SSL_CTX_use_certificate(ctx, cert) != 1 || SSL_CTX_use_PrivateKey(ctx, key) != 1)) {
+            SSL_CTX_free(ctx);
+            ctx = nullptr;
+        }
+    }
+    if (!ctx) {
+        Logger::instance().log(LogComponent::Tokens, LogLevel::Warn,
+                               "Cannot make a certificate for the callback listener: ", sslError());
+    }
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ctx;
+}
+
+/*
+ * Blocks SIGPIPE on this thread while in scope and discards any raised,
+ * since OpenSSL writes to the socket without MSG_NOSIGNAL and the browser
+ * may hang up first.
+ */
+class SigpipeBlock {
+    public:
+        SigpipeBlock() {
+            sigemptyset(&pipe_);
+            sigaddset(&pipe_, SIGPIPE);
+            pthread_sigmask(SIG_BLOCK, &pipe_, &previous_);
+        }
+
+        ~SigpipeBlock() {
+            timespec none{0, 0};
+            while (sigtimedwait(&pipe_, nullptr, &none) > 0) { }
+            pthread_sigmask(SIG_SETMASK, &previous_, nullptr);
+        }
+
+    private:
+        sigset_t pipe_;
+        sigset_t previous_;
+};
+
+//==============================================================================
+//                              OAuthCallbackListener
+//==============================================================================
+OAuthCallbackListener::OAuthCallbackListener(const string& callbackUrl) {
+    std::string_view url = callbackUrl;
+    std::string_view scheme = "http";
+    if (auto sep = url.find("://"); sep != std::string_view::npos) {
+        scheme = url.substr(0, sep);
+        url.remove_prefix(sep + 3);
+    }
+    std::string_view authority = url.substr(0, url.find_first_of("/?#"));
+
+    std::string_view host = authority;
+    string port = scheme == "https" ? "443" : "80";
+    if (!host.empty() && host.front() == '[') {                 // [::1]:8182
+        auto close = host.find(']');
+        if (close != std::string_view::npos && close + 1 < host.size() && host[close + 1] == ':') {
+            port = string(host.substr(close + 2));
+        }
+        host = host.substr(1, close == std::string_view::npos ? host.npos : close - 1);
+    } else if (auto colon = host.rfind(':'); colon != std::string_view::npos) {
+        port = string(host.substr(colon + 1));
+        host = host.substr(0, colon);
+    }
+    address_ = string(host) + ":" + port;
+
+    // Only the browser on this machine can reach a loopback callback, so
+    // that is the only kind worth listening for
+    bool loopback = host == "localhost" || host == "::1" || host.starts_with("127.");
+    if ((scheme != "http" && scheme != "https") || !loopback) {
+        Logger::instance().log(LogComponent::Tokens, LogLevel::Info, "The callback ", callbackUrl,
+                               " is not on loopback; paste the redirect URL to authorize");
+        readStdin_ = true;
+        return;
+    }
+    if (scheme == "https" && !(tls_ = selfSignedContext(host))) {
+        readStdin_ = true;
+        return;
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+    addrinfo* found = nullptr;
+    string hostName(host);
+    if (::getaddrinfo(hostName.empty() ? nullptr : hostName.c_str(), port.c_str(), &hints, &found) == 0) {
+        for (addrinfo* ai = found; ai && listenFd_ < 0; ai = ai->ai_next) {
+            int fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0) {
+                continue;
+            }
+            int yes = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+            if (::bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && ::listen(fd, 4) == 0) {
+                listenFd_ = fd;
+            } else {
+                ::close(fd);
+            }
+        }
+        ::freeaddrinfo(found);
+    }
+
+    if (!listening()) {
+        int error = errno;
+        Logger::instance().log(LogComponent::Tokens, LogLevel::Warn, "Cannot listen for the authorization callback on ",
+                               address_, ": ", std::strerror(error), "; paste the redirect URL instead");
+        if (error == EACCES) {
+            Logger::instance().log(LogComponent::Tokens, LogLevel::Warn, "Ports below 1024 need root; register a "
+                                   "callback with a higher port, e.g. ", scheme, "://127.0.0.1:8182");
+        }
+    }
+    // Without a terminal nobody can paste, so stdin is only read when the
+    // socket is the other way in or there is no socket
+    readStdin_ = !listening() || ::isatty(STDIN_FILENO);
+}
+
+OAuthCallbackListener::~OAuthCallbackListener() {
+    if (listenFd_ >= 0) {
+        ::close(listenFd_);
+    }
+    SSL_CTX_free(tls_);
+}
+
+string OAuthCallbackListener::awaitCode(const std::atomic<bool>& stop) {
+    while (!stop) {
+        pollfd fds[2];
+        nfds_t count = 0;
+        if (listening()) {
+            fds[count++] = {listenFd_, POLLIN, 0};
+        }
+        if (readStdin_) {
+            fds[count++] = {STDIN_FILENO, POLLIN, 0};
+        }
+        if (count == 0) {
+            return "";
+        }
+        if (::poll(fds, count, 100) <= 0) {
+            continue;
+        }
+
+        for (nfds_t i = 0; i < count; ++i) {
+            if (fds[i].revents == 0) {
+                continue;
+            }
+            if (fds[i].fd == listenFd_) {
+                string code = serveOne();
+                if (!code.empty()) {
+                    return code;
+                }
+                continue;
+            }
+
+            char chunk[4096];
+            ssize_t n = ::read(STDIN_FILENO, chunk, sizeof(chunk));
+            if (n > 0) {
+                pasted_.append(chunk, static_cast<std::size_t>(n));
+            } else {
+                readStdin_ = false;         // closed; keep waiting on the socket
+                if (pasted_.empty()) {
+                    continue;
+                }
+                pasted_ += '\n';            // a last line without a newline
+            }
+            for (std::size_t newline; (newline = pasted_.find('\n')) != string::npos; ) {
+                string line = pasted_.substr(0, newline);
+                pasted_.erase(0, newline + 1);
+                while (!line.empty() && isSpace(line.back())) {
+                    line.pop_back();
+                }
+                if (line.empty()) {
+                    continue;
+                }
+                checkDenied(line);
+                string code = queryParam(line, "code");
+                if (!code.empty()) {
+                    return code;
+                }
+                Logger::instance().log(LogComponent::Tokens, LogLevel::Warn, "No code= in the pasted URL");
+            }
+        }
+    }
+    return "";
+}
+
+/*
+ * Reads the request line of one connection and answers it. Requests
+ * without a code, such as the browser's favicon fetch, get a 404. Over
+ * TLS, a browser that has not yet accepted the self-signed certificate
+ * drops the handshake; it connects again once the user proceeds.
+ */
+string OAuthCallbackListener::serveOne() {
+    int fd = ::accept(listenFd_, nullptr, nullptr);
+    if (fd < 0) {
+        return "";
+    }
+    timeval timeout{2, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    SigpipeBlock sigpipe;
+    SSL* ssl = nullptr;
+    auto hangUp = [&] {
+        if (ssl) {
+            SSL_shutdown(ssl);
+            SSL_free(ssl);
+        }
+        ::close(fd);
+    };
+    if (tls_) {
+        ssl = SSL_new(tls_);
+        if (!ssl || SSL_set_fd(ssl, fd) != 1 || SSL_accept(ssl) != 1) {
+            Logger::instance().log(LogComponent::Tokens, LogLevel::Debug, "TLS handshake on ", address_,
+                                   " not completed: ", sslError());
+            SSL_free(ssl);
+            ::close(fd);
+            return "";
+        }
+    }
+    auto receive = [&](char* data, std::size_t size) -> long {
+        return ssl ? SSL_read(ssl, data, static_cast<int>(size)) : ::recv(fd, data, size, 0);
+    };
+    auto send = [&](const string& data) {
+        if (ssl) {
+            SSL_write(ssl, data.data(), static_cast<int>(data.size()));
+        } else {
+            [[maybe_unused]] auto sent = ::send(fd, data.data(), data.size(), sendFlags);
+        }
+    };
+
+    string request;
+    char chunk[2048];
+    while (request.find("\r\n") == string::npos && request.size() < 8192) {
+        long n = receive(chunk, sizeof(chunk));
+        if (n <= 0) {
+            break;
+        }
+        request.append(chunk, static_cast<std::size_t>(n));
+    }
+    if (!ssl && !request.empty() && request[0] == '\x16') {
+        Logger::instance().log(LogComponent::Tokens, LogLevel::Warn, "TLS handshake on ", address_,
+                               "; the callback is http, so the listener serves plain HTTP");
+        hangUp();
+        return "";
+    }
+
+    // "GET /callback?code=...&session=... HTTP/1.1"
+    std::string_view line(request);
+    line = line.substr(0, line.find("\r\n"));
+    std::string_view target;
+    if (auto space = line.find(' '); space != std::string_view::npos) {
+        target = line.substr(space + 1);
+        target = target.substr(0, target.find(' '));
+    }
+
+    auto reply = [&](const char* status, const string& message) {
+        string page = "<!doctype html><title>Schwab API</title><p>" + message + "</p>";
+        send(string("HTTP/1.1 ") + status + "\r\nContent-Type: text/html; charset=utf-8"
+             + "\r\nContent-Length: " + std::to_string(page.size())
+             + "\r\nConnection: close\r\n\r\n" + page);
+        hangUp();
+    };
+
+    string error = queryParam(target, "error");
+    string code = queryParam(target, "code");
+    if (!error.empty()) {
+        reply("400 Bad Request", "Authorization failed. Check the application log.");
+        checkDenied(target);
+    }
+    if (code.empty()) {
+        reply("404 Not Found", "Waiting for the authorization redirect.");
+        return "";
+    }
+    reply("200 OK", "Authorization received. You can close this window.");
+    Logger::instance().log(LogComponent::Tokens, LogLevel::Info, "Received the authorization callback on ", address_);
+    return code;
+}
@@ -0,0 +1,285 @@
+#include <charconv>
+#include <cmath>
+#include <string>
+#include <string_view>
+
+#include "option_chain.hpp"
+
+using string = std::string;
+
+//==============================================================================
+//                                StringPool
+//==============================================================================
+std::uint32_t StringPool::add(std::string_view text) {
+    chars_.append(text);
+    offsets_.push_back(static_cast<std::uint32_t>(chars_.size()));
+    return static_cast<std::uint32_t>(offsets_.size() - 2);
+}
+
+std::uint32_t StringPool::intern(std::string_view text) {
+    auto it = interned_.find(text);
+    if (it != interned_.end()) {
+        return it->second;
+    }
+    std::uint32_t id = add(text);
+    interned_.emplace(string(text), id);
+    return id;
+}
+
+void StringPool::reserve(std::size_t strings, std::size_t chars) {
+    offsets_.reserve(strings + 1);
+    chars_.reserve(chars);
+}
+
+void StringPool::clear() {
+    chars_.clear();
+    offsets_.assign(1, 0);
+    interned_.clear();
+}
+
+//==============================================================================
+//                              OptionChainTable
+//==============================================================================
+void OptionChainTable::reserve(std::size_t n) {
+    contractSymbol.reserve(n);
+    expiry.reserve(n);
+    daysToExpiration.reserve(n);
+    strike.reserve(n);
+    putCall.reserve(n);
+    bid.reserve(n);
+    ask.reserve(n);
+    last.reserve(n);
+    mark.reserve(n);
+    impliedVolatility.reserve(n);
+    delta.reserve(n);
+    gamma.reserve(n);
+    theta.reserve(n);
+    vega.reserve(n);
+    rho.reserve(n);
+    openInterest.reserve(n);
+    totalVolume.reserve(n);
+    multiplier.reserve(n);
+    strings.reserve(n + 64, n * 22);    // OCC symbols are 21 characters
+}
+
+void OptionChainTable::clear() {
+    symbol.clear();
+    status.clear();
+    underlyingPrice = interestRate = volatility = 0;
+    contractSymbol.clear();
+    expiry.clear();
+    daysToExpiration.clear();
+    strike.clear();
+    putCall.clear();
+    bid.clear();
+    ask.clear();
+    last.clear();
+    mark.clear();
+    impliedVolatility.clear();
+    delta.clear();
+    gamma.clear();
+    theta.clear();
+    vega.clear();
+    rho.clear();
+    openInterest.clear();
+    totalVolume.clear();
+    multiplier.clear();
+    strings.clear();
+}
+
+//==============================================================================
+//                             OptionChainBuilder
+//==============================================================================
+/*
+ * Chains responses nest as
+ *   { "callExpDateMap": { "yyyy-mm-dd:days": { "strike": [ {contract} ] } } }
+ * so contracts sit at depth 5 (the root object is depth 1).
+ */
+static constexpr int contractDepth = 5;
+
+static double toDouble(std::string_view text) {
+    double value = NAN;
+    std::from_chars(text.data(), text.data() + text.size(), value);
+    return value;
+}
+
+OptionChainBuilder::Field OptionChainBuilder::contractField(std::string_view name) {
+    switch (name.size()) {
+        case 3:
+            if (name == "bid") return Field::Bid;
+            if (name == "ask") return Field::Ask;
+            if (name == "rho") return Field::Rho;
+            break;
+        case 4:
+            if (name == "last") return Field::Last;
+            if (name == "mark") return Field::Mark;
+            if (name == "vega") return Field::Vega;
+            break;
+        case 5:
+            if (name == "delta") return Field::Delta;
+            if (name == "gamma") return Field::Gamma;
+            if (name == "theta") return Field::Theta;
+            break;
+        case 6:
+            if (name == "symbol") return Field::Symbol;
+            break;
+        case 7:
+            if (name == "putCall") return Field::PutCall;
+            break;
+        case 10:
+            if (name == "volatility") return Field::Volatility;
+            if (name == "multiplier") return Field::Multiplier;
+            break;
+        case 11:
+            if (name == "totalVolume") return Field::TotalVolume;
+            if (name == "strikePrice") return Field::StrikePrice;
+            break;
+        case 12:
+            if (name == "openInterest") return Field::OpenInterest;
+            break;
+        case 16:
+            if (name == "daysToExpiration") return Field::DaysToExpiration;
+            break;
+    }
+    return Field::None;
+}
+
+void OptionChainBuilder::startObject() {
+    ++depth_;
+    if (depth_ == 2) {
+        if (rootKey_ == "callExpDateMap") side_ = 'C';
+        else if (rootKey_ == "putExpDateMap") side_ = 'P';
+    } else if (depth_ == contractDepth && side_) {
+        row_ = Row{};
+        row_.strike = mapStrike_;
+        row_.putCall = side_;
+        row_.daysToExpiration = expiryDays_;
+        row_.bid = row_.ask = row_.last = row_.mark = NAN;
+        row_.impliedVolatility = row_.delta = row_.gamma = row_.theta = row_.vega = row_.rho = NAN;
+    }
+}
+
+void OptionChainBuilder::endObject() {
+    if (depth_ == contractDepth && side_) {
+        out_.contractSymbol.push_back(row_.contractSymbol);
+        out_.expiry.push_back(expiry_);
+        out_.daysToExpiration.push_back(row_.daysToExpiration);
+        out_.strike.push_back(row_.strike);
+        out_.putCall.push_back(row_.putCall);
+        out_.bid.push_back(row_.bid);
+        out_.ask.push_back(row_.ask);
+        out_.last.push_back(row_.last);
+        out_.mark.push_back(row_.mark);
+        out_.impliedVolatility.push_back(row_.impliedVolatility);
+        out_.delta.push_back(row_.delta);
+        out_.gamma.push_back(row_.gamma);
+        out_.theta.push_back(row_.theta);
+        out_.vega.push_back(row_.vega);
+        out_.rho.push_back(row_.rho);
+        out_.openInterest.push_back(row_.openInterest);
+        out_.totalVolume.push_back(row_.totalVolume);
+        out_.multiplier.push_back(row_.multiplier);
+    } else if (depth_ == 2) {
+        side_ = 0;
+    }
+    --depth_;
+    field_ = Field::None;
+}
+
+void OptionChainBuilder::startArray() {
+    ++depth_;
+}
+
+void OptionChainBuilder::endArray() {
+    --depth_;
+    field_ = Field::None;
+}
+
+void OptionChainBuilder::key(std::string_view name) {
+    field_ = Field::None;
+    if (depth_ == 1) {
+        rootKey_.assign(name);
+    } else if (side_ && depth_ == 2) {
+        // "yyyy-mm-dd:days"
+        auto colon = name.find(':');
+        expiry_ = out_.strings.intern(name.substr(0, colon));
+        expiryDays_ = 0;
+        if (colon != std::string_view::npos) {
+            auto days = name.substr(colon + 1);
+            std::from_chars(days.data(), days.data() + days.size(), expiryDays_);
+        }
+    } else if (side_ && depth_ == 3) {
+        mapStrike_ = toDouble(name);
+    } else if (side_ && depth_ == contractDepth) {
+        field_ = contractField(name);
+    }
+}
+
+void OptionChainBuilder::string(std::string_view value) {
+    if (depth_ == 1) {
+        if (rootKey_ == "symbol") out_.symbol.assign(value);
+        else if (rootKey_ == "status") out_.status.assign(value);
+        return;
+    }
+    if (depth_ != contractDepth || !side_) {
+        return;
+    }
+    switch (field_) {
+        case Field::Symbol:
+            row_.contractSymbol = out_.strings.add(value);
+            break;
+        case Field::PutCall:
+            row_.putCall = value == "PUT" ? 'P' : 'C';
+            break;
+        case Field::None:
+            break;
+        default:
+            setNumber(field_, toDouble(value));     // e.g. "NaN"
+    }
+}
+
+void OptionChainBuilder::number(double value) {
+    if (depth_ == 1) {
+        if (rootKey_ == "underlyingPrice") out_.underlyingPrice = value;
+        else if (rootKey_ == "interestRate") out_.interestRate = value;
+        else if (rootKey_ == "volatility") out_.volatility = value;
+        return;
+    }
+    if (depth_ == contractDepth && side_) {
+        setNumber(field_, value);
+    }
+}
+
+void OptionChainBuilder::setNumber(Field field, double value) {
+    switch (field) {
+        case Field::Bid:              row_.bid = value; break;
+        case Field::Ask:              row_.ask = value; break;
+        case Field::Last:             row_.last = value; break;
+        case Field::Mark:             row_.mark = value; break;
+        case Field::Volatility:       row_.impliedVolatility = value; break;
+        case Field::Delta:            row_.delta = value; break;
+        case Field::Gamma:            row_.gamma = value; break;
+        case Field::Theta:            row_.theta = value; break;
+        case Field::Vega:             row_.vega = value; break;
+        case Field::Rho:              row_.rho = value; break;
+        case Field::OpenInterest:     row_.openInterest = static_cast<std::int64_t>(value); break;
+        case Field::TotalVolume:      row_.totalVolume = static_cast<std::int64_t>(value); break;
+        case Field::StrikePrice:      row_.strike = value; break;
+        case Field::DaysToExpiration: row_.daysToExpiration = static_cast<std::int32_t>(value); break;
+        case Field::Multiplier:       row_.multiplier = static_cast<std::int32_t>(value); break;
+        default: break;
+    }
+}
+
+/*
+ * @brief Parses a complete chains response. Client::optionChainsTable
+ * does the same incrementally while the body downloads.
+ */
+OptionChainTable parseOptionChain(std::string_view body) {
+    OptionChainTable table;
+    OptionChainBuilder builder{table};
+    JsonPushParser parser{builder};
+    parser.feed(body);
+    parser.finish();
+    return table;
+}
@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "option_pricer.hpp"
+
+static constexpr double notANumber = std::numeric_limits<double>::quiet_NaN();
+
+/*--------------------------------------------------------------*/
+/*      Black-Scholes with a continuous yield q. Black-76 is    */
+/*      the same formula with q = r, except for rho, since the  */
+/*      futures price does not move with the rate              */
+/*--------------------------------------------------------------*/
+struct Quote {
+    double price, delta, gamma, theta, vega, rho;      // per year, per unit of vol and rate
+};
+
+static inline double normCdf(double x) {
+    return 0.5 * std::erfc(-x * 0.70710678118654752);
+}
+
+static inline double normPdf(double x) {
+    return 0.39894228040143268 * std::exp(-0.5 * x * x);
+}
+
+/*
+ * Terms shared by every contract of one expiry.
+ */
+struct Horizon {
+    double t, rootT, carry, discount;      // t in years
+
+    Horizon(double t, double r, double q)
+        : t{t}, rootT{std::sqrt(t)}, carry{std::exp(-q * t)}, discount{std::exp(-r * t)} { }
+};
+
+/*
+ * sign is +1 for a call and -1 for a put, which folds both payoffs into
+ * one branch-free formula. logMoneyness is log(s / k).
+ */
+static inline Quote blackScholes(double s, double k, double logMoneyness, const Horizon& h,
+                                 double r, double q, double vol, double sign, bool black76) {
+    if (h.t <= 0 || vol <= 0) {
+        // Expired, or no vol left: the discounted intrinsic value
+        double intrinsic = std::max(sign * (s * h.carry - k * h.discount), 0.0);
+        return {intrinsic, intrinsic > 0 ? sign * h.carry : 0.0, 0, 0, 0, 0};
+    }
+
+    double volRootT = vol * h.rootT;
+    double d1 = (logMoneyness + (r - q + 0.5 * vol * vol) * h.t) / volRootT;
+    double d2 = d1 - volRootT;
+    double nd1 = normCdf(sign * d1);
+    double nd2 = normCdf(sign * d2);
+    double pdf = normPdf(d1);
+
+    double spot = s * h.carry, strike = k * h.discount;
+    double price = sign * (spot * nd1 - strike * nd2);
+    return {
+        price,
+        sign * h.carry * nd1,
+        h.carry * pdf / (s * volRootT),
+        -spot * pdf * vol / (2 * h.rootT) - sign * r * strike * nd2 + sign * q * spot * nd1,
+        spot * pdf * h.rootT,
+        black76 ? -h.t * price : sign * k * h.t * h.discount * nd2
+    };
+}
+
+/*
+ * Vol reproducing price, by Newton steps kept inside a shrinking
+ * bisection bracket. NaN when the price is outside the no-arbitrage
+ * bounds or the contract has expired.
+ */
+static double solveVol(double price, double s, double k, const Horizon& h, double r, double q,
+                       double sign, bool black76, double guess) {
+    double lower = std::max(sign * (s * h.carry - k * h.discount), 0.0);
+    double upper = sign > 0 ? s * h.carry : k * h.discount;
+    if (!(h.t > 0) || !(price > lower) || !(price < upper)) {
+        return notANumber;
+    }
+
+    double logMoneyness = std::log(s / k);
+    double lo = 1e-6, hi = 10.0;
+    double vol = std::isfinite(guess) && guess > lo && guess < hi ? guess : 0.3;
+    double tolerance = 1e-10 * std::max(1.0, price);
+    for (int i = 0; i < 100; ++i) {
+        Quote quote = blackScholes(s, k, logMoneyness, h, r, q, vol, sign, black76);
+        double error = quote.price - price;
+        if (std::abs(error) < tolerance || hi - lo < 1e-12) {
+            break;
+        }
+        (error > 0 ? hi : lo) = vol;
+        double next = quote.vega > 1e-12 ? vol - error / quote.vega : lo - 1;
+        vol = next > lo && next < hi ? next : 0.5 * (lo + hi);
+    }
+    return vol;
+}
+
+//==============================================================================
+//                              OptionPricer
+//==============================================================================
+OptionPricer::OptionPricer(const OptionChainTable& chain, PricingConfig config)
+    : config_{config},
+      spot_{chain.underlyingPrice},
+      rate_{chain.interestRate / 100},
+      dividend_{config.dividendYield / 100}
+{
+    if (config_.threads == 0) {
+        config_.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Group rows by expiry so each group is one unit of work
+    std::size_t n = chain.size();
+    order_.resize(n);
+    std::iota(order_.begin(), order_.end(), std::size_t{0});
+    std::stable_sort(order_.begin(), order_.end(), [&](std::size_t a, std::size_t b) {
+        return std::pair(chain.daysToExpiration[a], chain.expiry[a])
+             < std::pair(chain.daysToExpiration[b], chain.expiry[b]);
+    });
+    for (std::size_t j = 0; j < n; ++j) {
+        if (j == 0 || chain.expiry[order_[j]] != chain.expiry[order_[j - 1]]) {
+            groups_.push_back({j, j});
+        }
+        groups_.back().end = j + 1;
+    }
+
+    strike_.resize(n);
+    logStrike_.resize(n);
+    days_.resize(n);
+    sign_.resize(n);
+    vol_.resize(n);
+    std::vector<double> marks(n);
+    for (std::size_t j = 0; j < n; ++j) {
+        std::size_t row = order_[j];
+        strike_[j] = chain.strike[row];
+        logStrike_[j] = std::log(chain.strike[row]);
+        days_[j] = chain.daysToExpiration[row];
+        sign_[j] = chain.putCall[row] == 'P' ? -1.0 : 1.0;
+        vol_[j] = chain.impliedVolatility[row] / 100;
+        marks[row] = vol_[j] > 0 && std::isfinite(vol_[j]) ? notANumber : chain.mark[row];
+    }
+
+    // Contracts the server sent no usable vol for are solved from their mark,
+    // falling back to the chain's own vol
+    std::vector<double> solved = impliedVolatility(marks);
+    for (std::size_t j = 0; j < n; ++j) {
+        if (!(vol_[j] > 0) || !std::isfinite(vol_[j])) {
+            double fromMark = solved[order_[j]] / 100;
+            vol_[j] = std::isfinite(fromMark) ? fromMark : chain.volatility / 100;
+        }
+    }
+}
+
+std::vector<double> OptionPricer::volatility() const {
+    std::vector<double> out(size());
+    for (std::size_t j = 0; j < size(); ++j) {
+        out[order_[j]] = vol_[j] * 100;
+    }
+    return out;
+}
+
+/*------------------------------*/
+/*      Pricing                 */
+/*------------------------------*/
+static void resize(OptionGreeks& greeks, std::size_t n) {
+    for (auto* column : {&greeks.price, &greeks.delta, &greeks.gamma, &greeks.theta, &greeks.vega, &greeks.rho}) {
+        column->resize(n);
+    }
+}
+
+OptionGreeks OptionPricer::price(const Scenario& scenario) const {
+    return std::move(price(std::span<const Scenario>(&scenario, 1)).front());
+}
+
+std::vector<OptionGreeks> OptionPricer::price(std::span<const Scenario> scenarios) const {
+    std::vector<OptionGreeks> results(scenarios.size());
+    for (auto& result : results) {
+        resize(result, size());
+    }
+    std::size_t groups = groups_.size();
+    parallelFor(scenarios.size() * groups, scenarios.size() * size(), [&](std::size_t item) {
+        priceGroup(groups_[item % groups], scenarios[item / groups], results[item / groups]);
+    });
+    return results;
+}
+
+/*
+ * Prices one expiry. Inputs are contiguous and the discounting is shared,
+ * leaving one erfc pair and an exp per contract; results are scattered
+ * back to chain order and scaled to the server's conventions.
+ */
+void OptionPricer::priceGroup(const Group& group, const Scenario& scenario, OptionGreeks& out) const {
+    bool black76 = config_.model == PricingModel::Black76;
+    double s = spot_ * (1 + scenario.spotMove);
+    double r = rate_ + scenario.ratePoints / 100;
+    double q = black76 ? r : dividend_;
+    double logSpot = std::log(s);
+    double volShift = scenario.volPoints / 100;
+    Horizon horizon{std::max(days_[group.begin] - scenario.daysForward, 0.0) / config_.daysPerYear, r, q};
+
+    for (std::size_t j = group.begin; j < group.end; ++j) {
+        double vol = std::max(vol_[j] + volShift, 0.0);
+        Quote quote = blackScholes(s, strike_[j], logSpot - logStrike_[j], horizon, r, q, vol, sign_[j], black76);
+
+        std::size_t row = order_[j];
+        out.price[row] = quote.price;
+        out.delta[row] = quote.delta;
+        out.gamma[row] = quote.gamma;
+        out.theta[row] = quote.theta / config_.daysPerYear;
+        out.vega[row] = quote.vega / 100;
+        out.rho[row] = quote.rho / 100;
+    }
+}
+
+/*------------------------------*/
+/*      Implied volatility      */
+/*------------------------------*/
+std::vector<double> OptionPricer::impliedVolatility(std::span<const double> prices) const {
+    std::vector<double> out(size(), notANumber);
+    if (prices.size() < size()) {
+        return out;
+    }
+    parallelFor(groups_.size(), size(), [&](std::size_t g) { solveGroup(groups_[g], prices, out); });
+    return out;
+}
+
+/*
+ * Each contract starts Newton from its neighbour's answer, which is
+ * usually close along one expiry.
+ */
+void OptionPricer::solveGroup(const Group& group, std::span<const double> prices, std::vector<double>& out) const {
+    bool black76 = config_.model == PricingModel::Black76;
+    double q = black76 ? rate_ : dividend_;
+    double guess = notANumber;
+    Horizon horizon{days_[group.begin] / config_.daysPerYear, rate_, q};
+    for (std::size_t j = group.begin; j < group.end; ++j) {
+        std::size_t row = order_[j];
+        double vol = solveVol(prices[row], spot_, strike_[j], horizon, rate_, q, sign_[j], black76, guess);
+        if (std::isfinite(vol)) {
+            guess = vol;
+        }
+        out[row] = vol * 100;
+    }
+}
+
+/*------------------------------*/
+/*      Threading               */
+/*------------------------------*/
+/*
+ * Work items are handed out from a shared counter, so groups of
+ * different sizes still balance. Jobs under a few thousand contracts
+ * stay on the calling thread, where they finish before a thread starts.
+ */
+template <typename Fn>
+void OptionPricer::parallelFor(std::size_t count, std::size_t contracts, Fn&& fn) const {
+    std::size_t workers = std::min<std::size_t>(config_.threads, count);
+    if (workers <= 1 || contracts < 2048) {
+        for (std::size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    std::atomic<std::size_t> next{0};
+    auto work = [&] {
+        for (std::size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count; ) {
+            fn(i);
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (std::size_t w = 1; w < workers; ++w) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
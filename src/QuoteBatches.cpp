@@ -0,0 +1,175 @@
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "quote_batches.hpp"
+
+using string = std::string;
+using json = nlohmann::json;
+
+//==============================================================================
+//                      Scanning raw top-level members
+//==============================================================================
+static std::size_t skipSpace(std::string_view text, std::size_t at) {
+    while (at < text.size() && (text[at] == ' ' || text[at] == '\t' || text[at] == '\r' || text[at] == '\n')) {
+        ++at;
+    }
+    return at;
+}
+
+/*
+ * Index just past the string starting at the '"' at, or npos if it never
+ * ends.
+ */
+static std::size_t skipString(std::string_view text, std::size_t at) {
+    for (++at; at < text.size(); ++at) {
+        if (text[at] == '\\') {
+            ++at;
+        } else if (text[at] == '"') {
+            return at + 1;
+        }
+    }
+    return std::string_view::npos;
+}
+
+/*
+ * Index just past the value starting at at, or npos if it never ends.
+ * Containers are matched by bracket depth, skipping over strings; the
+ * value itself is not validated.
+ */
+static std::size_t skipValue(std::string_view text, std::size_t at) {
+    if (at >= text.size()) {
+        return std::string_view::npos;
+    }
+    if (text[at] == '"') {
+        return skipString(text, at);
+    }
+    if (text[at] != '{' && text[at] != '[') {
+        while (at < text.size() && text[at] != ',' && text[at] != '}' && text[at] != ']'
+                && text[at] != ' ' && text[at] != '\t' && text[at] != '\r' && text[at] != '\n') {
+            ++at;
+        }
+        return at;
+    }
+
+    std::size_t depth = 0;
+    while (at < text.size()) {
+        char c = text[at];
+        if (c == '"') {
+            at = skipString(text, at);
+            if (at == std::string_view::npos) {
+                return at;
+            }
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            ++depth;
+        } else if ((c == '}' || c == ']') && --depth == 0) {
+            return at + 1;
+        }
+        ++at;
+    }
+    return std::string_view::npos;
+}
+
+//==============================================================================
+//                              QuoteBatchMerger
+//==============================================================================
+bool QuoteBatchMerger::add(std::string_view body) {
+    struct Member {
+        std::string_view key;       // with its quotes
+        std::string_view text;      // the whole member, key to end of value
+        std::string_view value;
+    };
+
+    // Split the object into members before touching any state
+    std::vector<Member> members;
+    std::size_t at = skipSpace(body, 0);
+    if (at == body.size() || body[at] != '{') {
+        return false;
+    }
+    at = skipSpace(body, at + 1);
+    bool closed = at < body.size() && body[at] == '}';
+    while (!closed) {
+        if (at >= body.size() || body[at] != '"') {
+            return false;
+        }
+        std::size_t keyEnd = skipString(body, at);
+        if (keyEnd == std::string_view::npos) {
+            return false;
+        }
+        std::size_t colon = skipSpace(body, keyEnd);
+        if (colon >= body.size() || body[colon] != ':') {
+            return false;
+        }
+        std::size_t valueStart = skipSpace(body, colon + 1);
+        std::size_t valueEnd = skipValue(body, valueStart);
+        if (valueEnd == std::string_view::npos || valueEnd == valueStart) {
+            return false;
+        }
+        members.push_back({body.substr(at, keyEnd - at), body.substr(at, valueEnd - at),
+                           body.substr(valueStart, valueEnd - valueStart)});
+
+        at = skipSpace(body, valueEnd);
+        if (at < body.size() && body[at] == ',') {
+            at = skipSpace(body, at + 1);
+        } else if (at < body.size() && body[at] == '}') {
+            closed = true;
+        } else {
+            return false;
+        }
+    }
+    if (skipSpace(body, at + 1) != body.size()) {
+        return false;   // trailing text
+    }
+
+    // Parse the small errors members up front, so a bad one adds nothing
+    std::vector<json> errors;
+    for (auto const& member : members) {
+        if (member.key == "\"errors\"") {
+            json parsed = json::parse(member.value, nullptr, false);
+            if (parsed.is_discarded()) {
+                return false;
+            }
+            errors.push_back(std::move(parsed));
+        }
+    }
+
+    for (auto const& member : members) {
+        if (member.key == "\"errors\"") {
+            continue;
+        }
+        if (!members_.empty()) members_ += ',';
+        members_.append(member.text);
+    }
+
+    // Lists such as invalidSymbols are concatenated across batches; any
+    // other entry keeps the first batch's value
+    for (auto& batchErrors : errors) {
+        if (!batchErrors.is_object()) {
+            continue;
+        }
+        for (auto& [key, value] : batchErrors.items()) {
+            auto existing = errors_.find(key);
+            if (existing == errors_.end()) {
+                errors_[key] = std::move(value);
+            } else if (existing->is_array() && value.is_array()) {
+                for (auto& item : value) {
+                    existing->push_back(std::move(item));
+                }
+            }
+        }
+    }
+    return true;
+}
+
+string QuoteBatchMerger::str() const {
+    string merged = "{" + members_;
+    if (!errors_.empty()) {
+        if (!members_.empty()) merged += ',';
+        merged += "\"errors\":" + errors_.dump();
+    }
+    merged += '}';
+    return merged;
+}
@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json_push_parser.hpp"
+#include "logger.hpp"
+#include "quote_poller.hpp"
+#include "schwab_api.hpp"
+#include "stream_fields.hpp"
+
+using string = std::string;
+
+// Member names of a quotes response's "quote" object, as level-one fields
+struct QuoteName {
+    std::string_view name;
+    LevelOneField field;
+};
+
+static constexpr QuoteName quoteNames[] = {
+    {"bidPrice", LevelOneField::Bid},           {"askPrice", LevelOneField::Ask},
+    {"lastPrice", LevelOneField::Last},         {"bidSize", LevelOneField::BidSize},
+    {"askSize", LevelOneField::AskSize},        {"totalVolume", LevelOneField::TotalVolume},
+    {"lastSize", LevelOneField::LastSize},      {"highPrice", LevelOneField::High},
+    {"lowPrice", LevelOneField::Low},           {"closePrice", LevelOneField::Close},
+    {"openPrice", LevelOneField::Open},         {"netChange", LevelOneField::NetChange},
+    {"52WeekHigh", LevelOneField::High52Week},  {"52WeekLow", LevelOneField::Low52Week},
+    {"mark", LevelOneField::Mark},              {"quoteTime", LevelOneField::QuoteTime},
+    {"tradeTime", LevelOneField::TradeTime},    {"netPercentChange", LevelOneField::NetPercentChange}
+};
+
+//==============================================================================
+//                      QuotePoller::ResponseDecoder
+//==============================================================================
+/*--------------------------------------------------------------*/
+/*      Reads {"SYM":{…,"quote":{"bidPrice":…}},…} from SAX     */
+/*      events into a row's next record. Symbols outside the    */
+/*      table and members outside "quote" are skipped           */
+/*--------------------------------------------------------------*/
+class QuotePoller::ResponseDecoder : public JsonHandler {
+    public:
+        ResponseDecoder(const std::unordered_map<std::string, std::uint32_t>& rowOf, std::vector<LevelOneQuote>& next,
+                        std::vector<std::uint32_t>& seen)
+            : rowOf_{rowOf}, next_{next}, seen_{seen} { }
+
+        void startObject() override {
+            ++depth_;
+            inQuote_ = depth_ == 3 && row_ >= 0 && quoteKey_;
+        }
+
+        void endObject() override {
+            if (depth_ == 3) {
+                inQuote_ = false;
+            } else if (depth_ == 2) {
+                row_ = -1;
+            }
+            --depth_;
+        }
+
+        void startArray() override { ++depth_; }
+        void endArray() override { --depth_; }
+
+        void key(std::string_view name) override {
+            if (depth_ == 1) {
+                auto it = rowOf_.find(std::string(name));
+                row_ = it == rowOf_.end() ? -1 : static_cast<int>(it->second);
+                if (row_ >= 0) {
+                    next_[row_] = LevelOneQuote{};
+                    next_[row_].symbol.assign(name);
+                    seen_.push_back(static_cast<std::uint32_t>(row_));
+                }
+            } else if (depth_ == 2) {
+                quoteKey_ = name == "quote";
+            } else if (depth_ == 3 && inQuote_) {
+                field_ = 0;
+                for (const auto& entry : quoteNames) {
+                    if (entry.name == name) {
+                        field_ = static_cast<unsigned>(entry.field);
+                        break;
+                    }
+                }
+            }
+        }
+
+        void number(double value) override {
+            if (inQuote_ && depth_ == 3 && field_ != 0) {
+                setField(next_[row_], field_, value);
+            }
+        }
+
+    private:
+        // members
+        const std::unordered_map<std::string, std::uint32_t>& rowOf_;
+        std::vector<LevelOneQuote>& next_;
+        std::vector<std::uint32_t>& seen_;
+        int depth_ = 0;
+        int row_ = -1;
+        bool quoteKey_ = false;
+        bool inQuote_ = false;
+        unsigned field_ = 0;
+};
+
+//==============================================================================
+//                              QuotePoller
+//==============================================================================
+QuotePoller::QuotePoller(Client& client, QuotePollerConfig config)
+    : client_{client},
+      config_{config}
+{ }
+
+QuotePoller::~QuotePoller() {
+    stop();
+}
+
+/*------------------------------*/
+/*      Subscribers             */
+/*------------------------------*/
+std::uint32_t QuotePoller::rowFor(const string& symbol) {
+    auto [it, added] = rowOf_.try_emplace(symbol, static_cast<std::uint32_t>(symbols_.size()));
+    if (added) {
+        symbols_.push_back(symbol);
+        interest_.push_back(0);
+        last_.emplace_back();
+        last_.back().symbol.assign(symbol);
+        changed_.push_back(0);
+    }
+    return it->second;
+}
+
+QuotePoller::SubscriptionId QuotePoller::subscribe(const std::vector<string>& symbols, DeltaHandler handler) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Subscriber subscriber{{}, std::move(handler)};
+    for (const auto& symbol : symbols) {
+        if (symbol.empty()) {
+            continue;
+        }
+        std::uint32_t row = rowFor(symbol);
+        if (std::find(subscriber.rows.begin(), subscriber.rows.end(), row) != subscriber.rows.end()) {
+            continue;
+        }
+        subscriber.rows.push_back(row);
+        activeDirty_ |= interest_[row]++ == 0;
+    }
+    SubscriptionId id = nextId_++;
+    subscribers_.emplace(id, std::move(subscriber));
+    return id;
+}
+
+void QuotePoller::unsubscribe(SubscriptionId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = subscribers_.find(id);
+    if (it == subscribers_.end()) {
+        return;
+    }
+    for (std::uint32_t row : it->second.rows) {
+        if (--interest_[row] == 0) {
+            // Nobody is watching: forget the snapshot rather than let it go stale
+            activeDirty_ = true;
+            last_[row].present = 0;
+        }
+    }
+    subscribers_.erase(it);
+}
+
+std::size_t QuotePoller::symbolCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<std::size_t>(std::count_if(interest_.begin(), interest_.end(), [](auto n) { return n > 0; }));
+}
+
+bool QuotePoller::snapshot(std::string_view symbol, LevelOneQuote& quote) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = rowOf_.find(string(symbol));
+    if (it == rowOf_.end() || last_[it->second].present == 0) {
+        return false;
+    }
+    quote = last_[it->second];
+    return true;
+}
+
+QuotePollerStats QuotePoller::stats() const {
+    return {polls_.load(), failedPolls_.load(), symbolsPolled_.load(),
+            changedCount_.load(), unchanged_.load(), deliveries_.load()};
+}
+
+/*------------------------------*/
+/*      Polling                 */
+/*------------------------------*/
+/*
+ * @brief Fetches every symbol someone wants in one batched quotes call,
+ * diffs the response against the last snapshot and hands each subscriber
+ * its changed symbols. Handlers run after the lock is released, so they
+ * may subscribe or unsubscribe.
+ */
+bool QuotePoller::pollNow() {
+    std::lock_guard<std::mutex> pollLock(pollMutex_);
+    std::vector<string> symbols;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (activeDirty_) {
+            active_.clear();
+            for (std::size_t row = 0; row < symbols_.size(); ++row) {
+                if (interest_[row] > 0) {
+                    active_.push_back(symbols_[row]);
+                }
+            }
+            activeDirty_ = false;
+        }
+        symbols = active_;
+    }
+
+    if (symbols.empty()) {
+        return true;    // nothing wanted, so nothing to ask for
+    }
+
+    // A poll with a failed batch fails as a whole, so no subscriber sees
+    // some of its symbols updated and others silently stale
+    string body;
+    try {
+        body = client_.quotes(symbols, "quote", false, config_.maxInFlight);
+        if (body.empty()) {
+            throw std::runtime_error("no response");
+        }
+    } catch (const std::exception& e) {   // QuoteBatchError names the failed batches
+        failedPolls_.fetch_add(1, std::memory_order_relaxed);
+        Logger::instance().log(LogComponent::Client, LogLevel::Warn, "Quote poll failed: ", e.what());
+        return false;
+    }
+    polls_.fetch_add(1, std::memory_order_relaxed);
+    symbolsPolled_.fetch_add(symbols.size(), std::memory_order_relaxed);
+
+    std::vector<std::pair<DeltaHandler, std::vector<LevelOneQuote>>> deliveries;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        // Decode into a scratch row per symbol, then fold into last_
+        std::vector<LevelOneQuote> next(symbols_.size());
+        std::vector<std::uint32_t> seen;
+        ResponseDecoder decoder(rowOf_, next, seen);
+        JsonPushParser parser(decoder);
+        try {
+            parser.feed(body);
+            parser.finish();
+        } catch (const std::exception& e) {
+            failedPolls_.fetch_add(1, std::memory_order_relaxed);
+            Logger::instance().log(LogComponent::Client, LogLevel::Warn, "Bad quotes response: ", e.what());
+            return false;
+        }
+
+        auto serverTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        std::vector<std::uint32_t> changedRows;
+        for (std::uint32_t row : seen) {
+            if (interest_[row] == 0) {
+                continue;
+            }
+            LevelOneQuote& last = last_[row];
+            const LevelOneQuote& fresh = next[row];
+            std::uint64_t changed = 0;
+            for (LevelOneField field : levelOneFields) {
+                auto n = static_cast<unsigned>(field);
+                if (!fresh.has(field)) {
+                    continue;
+                }
+                double before = 0, after = 0;
+                visitField(last, n, [&](auto value) { before = static_cast<double>(value); });
+                visitField(fresh, n, [&](auto value) { after = static_cast<double>(value); });
+                if (!last.has(field) || before != after) {
+                    changed |= std::uint64_t{1} << n;
+                    visitField(last, n, [&](auto& member) { visitField(fresh, n, [&](auto value) { member = value; }); });
+                }
+            }
+            last.present |= changed;
+            last.serverTime = serverTime;
+            if (changed != 0) {
+                changed_[row] = changed;
+                changedRows.push_back(row);
+            }
+        }
+        changedCount_.fetch_add(changedRows.size(), std::memory_order_relaxed);
+        unchanged_.fetch_add(seen.size() - changedRows.size(), std::memory_order_relaxed);
+
+        // Each subscriber gets its own rows that changed (all of them, once, when new)
+        for (auto& [id, subscriber] : subscribers_) {
+            std::vector<LevelOneQuote> records;
+            for (std::uint32_t row : subscriber.rows) {
+                std::uint64_t fields = subscriber.fresh ? last_[row].present : changed_[row];
+                if (fields != 0) {
+                    records.push_back(last_[row]);
+                    records.back().present = fields;
+                }
+            }
+            if (!records.empty()) {
+                subscriber.fresh = false;
+                deliveries.emplace_back(subscriber.handler, std::move(records));
+            }
+        }
+        for (std::uint32_t row : changedRows) {
+            changed_[row] = 0;
+        }
+    }
+
+    for (auto& [handler, records] : deliveries) {
+        deliveries_.fetch_add(records.size(), std::memory_order_relaxed);
+        try {
+            handler(records);
+        } catch (const std::exception& e) {
+            Logger::instance().log(LogComponent::Client, LogLevel::Error, "Quote handler threw: ", e.what());
+        }
+    }
+    return true;
+}
+
+/*------------------------------*/
+/*      Thread                  */
+/*------------------------------*/
+void QuotePoller::start() {
+    std::lock_guard<std::mutex> lock(waitMutex_);
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    thread_ = std::thread(&QuotePoller::run, this);
+}
+
+void QuotePoller::stop() {
+    {
+        std::lock_guard<std::mutex> lock(waitMutex_);
+        running_ = false;
+    }
+    wakeup_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+// Polls on a fixed schedule; a poll that overruns skips the missed ticks
+void QuotePoller::run() {
+    auto next = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(waitMutex_);
+    while (running_) {
+        lock.unlock();
+        pollNow();
+        lock.lock();
+
+        auto now = std::chrono::steady_clock::now();
+        next += config_.interval;
+        if (next < now) {
+            next = now + config_.interval - (now - next) % config_.interval;
+        }
+        wakeup_.wait_until(lock, next, [this] { return !running_; });
+    }
+}
@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <optional>
+
+#include "rate_limiter.hpp"
+
+//==============================================================================
+//                                RateLimiter
+//==============================================================================
+RateLimiter::RateLimiter(double perSecond, double burst)
+    : rate_{perSecond},
+      burst_{std::max(burst, 1.0)},
+      tokens_{burst_},
+      last_{Clock::now()}
+{ }
+
+void RateLimiter::setRate(double perSecond, double burst) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        refill(Clock::now());
+        rate_ = perSecond;
+        burst_ = std::max(burst, 1.0);
+        tokens_ = std::min(tokens_, burst_);
+    }
+    changed_.notify_all();
+}
+
+/*------------------------------*/
+/*      Token accounting        */
+/*------------------------------*/
+/*
+ * Adds the tokens earned since the last refill, up to burst_.
+ */
+void RateLimiter::refill(Clock::time_point now) {
+    std::chrono::duration<double> elapsed = now - last_;
+    last_ = now;
+    if (rate_ > 0) {
+        tokens_ = std::min(burst_, tokens_ + elapsed.count() * rate_);
+    }
+}
+
+RateLimiter::Clock::duration RateLimiter::untilNextToken() const {
+    if (rate_ <= 0 || tokens_ >= 1.0) {
+        return Clock::duration::zero();
+    }
+    std::chrono::duration<double> wait{(1.0 - tokens_) / rate_};
+    return std::chrono::duration_cast<Clock::duration>(wait) + std::chrono::microseconds(1);
+}
+
+void RateLimiter::record(Priority priority, Clock::duration waited) {
+    int p = static_cast<int>(priority);
+    ++stats_.granted[p];
+    if (waited > Clock::duration::zero()) {
+        ++stats_.delayed[p];
+        stats_.totalWait[p] += waited;
+        stats_.maxWait = std::max(stats_.maxWait, waited);
+    }
+}
+
+/*----------------------*/
+/*      Acquisition     */
+/*----------------------*/
+/*
+ * @brief Takes one token, queueing behind every waiter of higher priority
+ * and every earlier waiter of the same priority. With no one queued and
+ * a token free it returns without queueing, so without allocating.
+ */
+RateLimiter::Clock::duration RateLimiter::acquire(Priority priority) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const auto start = Clock::now();
+    if (waiting_.empty()) {
+        refill(start);
+        if (rate_ <= 0 || tokens_ >= 1.0) {
+            if (rate_ > 0) tokens_ -= 1.0;
+            record(priority, Clock::duration::zero());
+            return Clock::duration::zero();
+        }
+    }
+    const Ticket ticket{static_cast<int>(priority), nextTicket_++};
+    waiting_.insert(ticket);
+
+    while (true) {
+        auto now = Clock::now();
+        refill(now);
+        bool first = *waiting_.begin() == ticket;
+        if (rate_ <= 0 || (first && tokens_ >= 1.0)) {
+            if (rate_ > 0) tokens_ -= 1.0;
+            waiting_.erase(ticket);
+            auto waited = now - start;
+            record(priority, waited);
+            lock.unlock();
+            changed_.notify_all();
+            return waited;
+        }
+        if (first) {
+            changed_.wait_for(lock, untilNextToken());
+        } else {
+            changed_.wait(lock);
+        }
+    }
+}
+
+/*
+ * @brief Takes a token before deadline, polling tryAcquire and sleeping
+ * in between until a token should be free or a blocking caller is let
+ * through. Without a deadline it is plain acquire.
+ */
+bool RateLimiter::acquireUntil(Priority priority, Clock::time_point deadline) {
+    if (deadline == Clock::time_point::max()) {
+        acquire(priority);
+        return true;
+    }
+    const auto start = Clock::now();
+    Clock::duration retryIn{};
+    while (!tryAcquire(priority, start, retryIn)) {
+        auto now = Clock::now();
+        if (now >= deadline) {
+            return false;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait_until(lock, std::min(now + retryIn, deadline));
+    }
+    return true;
+}
+
+/*
+ * @brief Takes a token if one is free and no blocking caller of equal or
+ * higher priority is queued. queuedSince is when the caller started
+ * waiting, for the wait statistics.
+ */
+bool RateLimiter::tryAcquire(Priority priority, Clock::time_point queuedSince, Clock::duration& retryIn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = Clock::now();
+    refill(now);
+    if (rate_ <= 0) {
+        record(priority, now - queuedSince);
+        return true;
+    }
+
+    bool blocked = !waiting_.empty() && waiting_.begin()->first <= static_cast<int>(priority);
+    if (!blocked && tokens_ >= 1.0) {
+        tokens_ -= 1.0;
+        record(priority, now - queuedSince);
+        return true;
+    }
+
+    retryIn = std::max<Clock::duration>(untilNextToken(), std::chrono::milliseconds(1));
+    return false;
+}
+
+/*
+ * @brief Time until a request issued now would be let through, counting
+ * everyone already queued ahead of it.
+ */
+RateLimiter::Clock::duration RateLimiter::estimateWait(Priority priority) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (rate_ <= 0) {
+        return Clock::duration::zero();
+    }
+    std::chrono::duration<double> elapsed = Clock::now() - last_;
+    double tokens = std::min(burst_, tokens_ + elapsed.count() * rate_);
+    auto ahead = static_cast<double>(std::count_if(waiting_.begin(), waiting_.end(),
+        [&](const Ticket& t) { return t.first <= static_cast<int>(priority); }));
+
+    double deficit = ahead + 1.0 - tokens;
+    if (deficit <= 0) {
+        return Clock::duration::zero();
+    }
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>{deficit / rate_});
+}
+
+RateLimiter::Stats RateLimiter::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats out = stats_;
+    out.queued = waiting_.size();
+    return out;
+}
+
+//==============================================================================
+//                                PriorityScope
+//==============================================================================
+static thread_local std::optional<Priority> scopedPriority;
+
+PriorityScope::PriorityScope(Priority priority) : previous_{scopedPriority} {
+    scopedPriority = priority;
+}
+
+PriorityScope::~PriorityScope() {
+    scopedPriority = previous_;
+}
+
+Priority PriorityScope::resolve(Priority fallback) {
+    return scopedPriority.value_or(fallback);
+}
@@ -0,0 +1,285 @@
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <curl/curl.h>
+
+#include "logger.hpp"
+#include "request_loop.hpp"
+
+using string = std::string;
+
+//==============================================================================
+//                                RequestLoop
+//==============================================================================
+
+/*--------------------------------------------------*/
+/*      RequestLoop constructors and destructors    */
+/*--------------------------------------------------*/
+RequestLoop::RequestLoop(ConnectionPool& pool, RateLimiter& limiter)
+    : pool_{pool}, limiter_{limiter}
+{
+    multi_ = curl_multi_init();
+    if (!multi_) {
+        throw std::runtime_error("Failed to init libcurl multi handle");
+    }
+}
+
+RequestLoop::~RequestLoop() {
+    running_ = false;
+    curl_multi_wakeup(multi_);
+    if (thread_.joinable())
+        thread_.join();
+    runPosted();
+
+    // Abort whatever did not finish so no future is left hanging
+    for (auto& [curl, transfer] : active_) {
+        curl_multi_remove_handle(multi_, curl);
+        transfer->headers.reset();
+        if (transfer->done) {
+            try { transfer->done(CURLE_ABORTED_BY_CALLBACK, 0, string()); } catch (...) { }
+        }
+        ConnectionPool::destroyHandle(curl);
+    }
+    for (auto& queue : throttled_) {
+        for (auto& transfer : queue) {
+            pending_.push_back(std::move(transfer));
+        }
+    }
+    for (auto& [at, transfer] : delayed_) {
+        pending_.push_back(std::move(transfer));
+    }
+    for (auto& transfer : pending_) {
+        transfer->headers.reset();
+        if (transfer->done) {
+            try { transfer->done(CURLE_ABORTED_BY_CALLBACK, 0, string()); } catch (...) { }
+        }
+        ConnectionPool::destroyHandle(transfer->curl);
+    }
+    for (CURL* curl : idle_) {
+        ConnectionPool::destroyHandle(curl);
+    }
+    curl_multi_cleanup(multi_);
+}
+
+/*------------------------------*/
+/*      Handle management       */
+/*------------------------------*/
+/*
+ * Hands out an idle handle, creating one if none are left.
+ */
+CURL* RequestLoop::checkout() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!idle_.empty()) {
+            CURL* curl = idle_.back();
+            idle_.pop_back();
+            return curl;
+        }
+    }
+    return pool_.createHandle();
+}
+
+/*
+ * Resets a handle and keeps it for the next transfer, up to maxIdleHandles_.
+ */
+void RequestLoop::checkin(CURL* curl) {
+    pool_.resetHandle(curl);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (idle_.size() < maxIdleHandles_) {
+            idle_.push_back(curl);
+            return;
+        }
+    }
+    ConnectionPool::destroyHandle(curl);
+}
+
+/*----------------------*/
+/*      Submission      */
+/*----------------------*/
+/*
+ * @brief Queues a prepared transfer and wakes the loop. The loop
+ * thread is started on the first submission.
+ */
+void RequestLoop::submit(std::unique_ptr<Transfer> transfer) {
+    std::call_once(started_, [this] { start(); });
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.push_back(std::move(transfer));
+    }
+    ++inFlight_;
+    curl_multi_wakeup(multi_);
+}
+
+/*
+ * @brief Queues a task for the loop thread and wakes the loop. Tasks run
+ * in posting order, before the next round of transfers.
+ */
+void RequestLoop::post(std::function<void()> task) {
+    std::call_once(started_, [this] { start(); });
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        posted_.push_back(std::move(task));
+    }
+    curl_multi_wakeup(multi_);
+}
+
+void RequestLoop::start() {
+    running_ = true;
+    thread_ = std::thread(&RequestLoop::run, this);
+}
+
+/*----------------------*/
+/*      Event loop      */
+/*----------------------*/
+/*
+ * Moves submitted transfers into the per-priority queues, or aside until
+ * their notBefore time.
+ */
+void RequestLoop::addPending() {
+    std::vector<std::unique_ptr<Transfer>> batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        batch.swap(pending_);
+    }
+    auto now = RateLimiter::Clock::now();
+    for (auto& transfer : batch) {
+        if (transfer->notBefore > now) {
+            auto at = transfer->notBefore;
+            delayed_.emplace(at, std::move(transfer));
+        } else {
+            throttled_[static_cast<int>(transfer->priority)].push_back(std::move(transfer));
+        }
+    }
+}
+
+void RequestLoop::runPosted() {
+    std::vector<std::function<void()>> batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        batch.swap(posted_);
+    }
+    for (auto& task : batch) {
+        try {
+            task();
+        } catch (const std::exception& e) {
+            Logger::instance().log(LogComponent::Loop, LogLevel::Error, "Posted task threw: ", e.what());
+        } catch (...) {
+            Logger::instance().log(LogComponent::Loop, LogLevel::Error, "Posted task threw");
+        }
+    }
+}
+
+/*
+ * @brief Starts queued transfers, highest priority first, while the rate
+ * limiter has tokens. Stops at the first refusal so lower priorities
+ * never overtake. Delayed transfers that are due join the queues first.
+ * Returns how long to poll before trying again.
+ */
+long RequestLoop::admit() {
+    long timeoutMs = 1000;
+    auto now = RateLimiter::Clock::now();
+    while (!delayed_.empty() && delayed_.begin()->first <= now) {
+        auto due = delayed_.extract(delayed_.begin());
+        throttled_[static_cast<int>(due.mapped()->priority)].push_back(std::move(due.mapped()));
+    }
+    if (!delayed_.empty()) {
+        auto ms = std::chrono::ceil<std::chrono::milliseconds>(delayed_.begin()->first - now).count();
+        timeoutMs = std::min<long>(timeoutMs, std::max<long>(ms, 1));
+    }
+    for (auto& queue : throttled_) {
+        while (!queue.empty()) {
+            Transfer& next = *queue.front();
+            if (next.deadline <= now) {
+                // Too late to be worth a request: report it as timed out, unsent
+                std::unique_ptr<Transfer> expired = std::move(queue.front());
+                queue.pop_front();
+                expired->metrics = nullptr;
+                CURL* curl = expired->curl;
+                active_.emplace(curl, std::move(expired));
+                finish(curl, CURLE_OPERATION_TIMEDOUT);
+                continue;
+            }
+            RateLimiter::Clock::duration retryIn{};
+            if (!limiter_.tryAcquire(next.priority, next.queuedAt, retryIn)) {
+                auto ms = std::chrono::ceil<std::chrono::milliseconds>(retryIn).count();
+                return std::min<long>(timeoutMs, std::max<long>(ms, 1));
+            }
+
+            std::unique_ptr<Transfer> transfer = std::move(queue.front());
+            queue.pop_front();
+            CURL* curl = transfer->curl;
+            CURLMcode mc = curl_multi_add_handle(multi_, curl);
+            active_.emplace(curl, std::move(transfer));
+            if (mc != CURLM_OK) {
+                finish(curl, CURLE_FAILED_INIT);
+            }
+        }
+    }
+    return timeoutMs;
+}
+
+/*
+ * Drives all transfers until stopped. Blocks in curl_multi_poll
+ * when there is nothing to do; submit() and the destructor wake it.
+ */
+void RequestLoop::run() {
+    while (running_) {
+        runPosted();
+        addPending();
+        long timeoutMs = admit();
+
+        int stillRunning = 0;
+        curl_multi_perform(multi_, &stillRunning);
+
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi_, &queued)) {
+            if (msg->msg == CURLMSG_DONE) {
+                finish(msg->easy_handle, msg->data.result);
+            }
+        }
+
+        curl_multi_poll(multi_, nullptr, 0, static_cast<int>(timeoutMs), nullptr);
+    }
+}
+
+/*
+ * Detaches a finished transfer, recycles its handle and runs its completion.
+ * The body is copied out at its exact size so the handle keeps its buffer.
+ */
+void RequestLoop::finish(CURL* curl, CURLcode rc) {
+    auto it = active_.find(curl);
+    if (it == active_.end()) {
+        return;
+    }
+    std::unique_ptr<Transfer> transfer = std::move(it->second);
+    active_.erase(it);
+
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    curl_off_t retryAfter = 0;
+    if (curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retryAfter) == CURLE_OK && retryAfter > 0) {
+        transfer->retryAfter = std::chrono::seconds{retryAfter};
+    }
+    if (transfer->metrics) {
+        transfer->metrics->record(curl, rc, status);
+    }
+
+    string body = ConnectionPool::responseBuffer(curl);
+    curl_multi_remove_handle(multi_, curl);
+    transfer->headers.reset();
+    checkin(curl);
+    --inFlight_;
+
+    if (transfer->done) {
+        try {
+            transfer->done(rc, status, std::move(body));
+        } catch (const std::exception& e) {
+            Logger::instance().log(LogComponent::Loop, LogLevel::Error, "Request completion threw: ", e.what());
+        } catch (...) {
+            Logger::instance().log(LogComponent::Loop, LogLevel::Error, "Request completion threw");
+        }
+    }
+}
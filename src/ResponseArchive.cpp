@@ -0,0 +1,156 @@
+#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "file_io.hpp"
+#include "response_archive.hpp"
+
+using string = std::string;
+
+/*--------------------------------------------------------------*/
+/*      On-disk layout. A file is a sequence of records, each   */
+/*      a header followed by the url and then the body          */
+/*--------------------------------------------------------------*/
+struct RecordHeader {
+    std::uint32_t magic;
+    std::int32_t status;
+    std::uint32_t urlSize;
+    std::uint32_t bodySize;
+    std::int64_t recordedAt;    // epoch ms
+};
+static_assert(sizeof(RecordHeader) == 24, "RecordHeader layout is part of the file format");
+
+static constexpr std::uint32_t recordMagic = 0x52415253;   // "SRAR"
+
+/*
+ * Calls fn(offset, header, url) for each complete record and returns the
+ * length of the valid prefix. A torn record from an interrupted append
+ * ends the walk.
+ */
+template <typename Fn>
+static std::size_t forEachRecord(const char* data, std::size_t size, Fn&& fn) {
+    std::size_t offset = 0;
+    while (offset + sizeof(RecordHeader) <= size) {
+        RecordHeader header;
+        std::memcpy(&header, data + offset, sizeof(header));
+        std::size_t length = sizeof(RecordHeader) + header.urlSize + header.bodySize;
+        if (header.magic != recordMagic || offset + length > size) {
+            break;
+        }
+        fn(offset, header, std::string_view(data + offset + sizeof(RecordHeader), header.urlSize));
+        offset += length;
+    }
+    return offset;
+}
+
+//==============================================================================
+//                              ResponseArchive
+//==============================================================================
+ResponseArchive::ResponseArchive(const string& path, Mode mode) : path_{path}, mode_{mode} {
+    if (mode_ == Mode::Replay) {
+        mapped_ = std::make_unique<MappedFile>(path_, MADV_WILLNEED);
+        if (!mapped_->data() && ::access(path_.c_str(), F_OK) != 0) {
+            throw std::runtime_error("No response archive at " + path_);
+        }
+        forEachRecord(mapped_->data(), mapped_->size(),
+            [&](std::size_t offset, const RecordHeader&, std::string_view url) {
+                index_[url].offsets.push_back(offset);
+                ++records_;
+            });
+        return;
+    }
+
+    // Record: drop a torn tail left by a crash, then append after it
+    std::size_t valid, size;
+    {
+        MappedFile mapped{path_};
+        size = mapped.size();
+        valid = forEachRecord(mapped.data(), mapped.size(),
+            [&](std::size_t, const RecordHeader&, std::string_view) { ++records_; });
+    }
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Could not open " + path_ + ": " + std::strerror(errno));
+    }
+    if (valid < size && ::ftruncate(fd_, static_cast<off_t>(valid)) != 0) {
+        ::close(fd_);
+        throw std::runtime_error("Could not repair " + path_);
+    }
+    ::lseek(fd_, static_cast<off_t>(valid), SEEK_SET);
+}
+
+ResponseArchive::~ResponseArchive() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+/*------------------------------*/
+/*      Recording               */
+/*------------------------------*/
+void ResponseArchive::append(std::string_view url, long status, std::string_view body) {
+    if (mode_ != Mode::Record) {
+        throw std::runtime_error("Response archive " + path_ + " is not open for recording");
+    }
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    RecordHeader header{
+        recordMagic,
+        static_cast<std::int32_t>(status),
+        static_cast<std::uint32_t>(url.size()),
+        static_cast<std::uint32_t>(body.size()),
+        std::chrono::duration_cast<std::chrono::milliseconds>(now).count()
+    };
+
+    string record;
+    record.reserve(sizeof(header) + url.size() + body.size());
+    record.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    record.append(url);
+    record.append(body);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    writeAll(fd_, record.data(), record.size(), path_);
+    ++records_;
+}
+
+/*------------------------------*/
+/*      Replaying               */
+/*------------------------------*/
+std::optional<ResponseArchive::Response> ResponseArchive::next(std::string_view url) {
+    if (mode_ != Mode::Replay) {
+        throw std::runtime_error("Response archive " + path_ + " is not open for replay");
+    }
+    std::size_t offset;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(url);
+        if (it == index_.end()) {
+            return std::nullopt;
+        }
+        Series& series = it->second;
+        offset = series.offsets[series.next];
+        if (series.next + 1 < series.offsets.size()) {
+            ++series.next;
+        }
+    }
+
+    RecordHeader header;
+    const char* record = mapped_->data() + offset;
+    std::memcpy(&header, record, sizeof(header));
+    const char* body = record + sizeof(header) + header.urlSize;
+    return Response{header.status, std::string_view(body, header.bodySize), header.recordedAt};
+}
+
+void ResponseArchive::rewind() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& [url, series] : index_) {
+        series.next = 0;
+    }
+}
@@ -0,0 +1,230 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "response_cache.hpp"
+
+using string = std::string;
+
+//==============================================================================
+//                              ResponseCache
+//==============================================================================
+ResponseCache::ResponseCache(std::size_t maxBytes) : maxBytes_{maxBytes} { }
+
+/*--------------------------*/
+/*      Configuration       */
+/*--------------------------*/
+void ResponseCache::setTtl(const string& endpoint, std::chrono::seconds ttl) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ttls_[endpoint] = ttl;
+}
+
+std::chrono::seconds ResponseCache::ttl(const string& endpoint) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = ttls_.find(endpoint);
+    return it == ttls_.end() ? std::chrono::seconds{0} : it->second;
+}
+
+void ResponseCache::setMaxBytes(std::size_t maxBytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    maxBytes_ = maxBytes;
+    evict();
+}
+
+void ResponseCache::setDiskDirectory(const string& directory) {
+    if (!directory.empty()) {
+        std::filesystem::create_directories(directory);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    diskDirectory_ = directory;
+}
+
+/*----------------------*/
+/*      Lookups         */
+/*----------------------*/
+/*
+ * @brief Returns the cached body for url if it has not expired. Checks
+ * memory first, then the disk tier, promoting disk hits into memory.
+ */
+std::optional<string> ResponseCache::get(const string& url) {
+    auto now = Clock::now();
+    string directory;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(url);
+        if (it != index_.end()) {
+            if (it->second->expiresAt > now) {
+                lru_.splice(lru_.begin(), lru_, it->second);
+                ++stats_.hits;
+                return it->second->body;
+            }
+            bytes_ -= it->second->url.size() + it->second->body.size();
+            lru_.erase(it->second);
+            index_.erase(it);
+        }
+        directory = diskDirectory_;
+    }
+
+    if (!directory.empty()) {
+        auto entry = readDisk(directory, url);
+        if (entry && entry->expiresAt > now) {
+            string body = entry->body;
+            std::lock_guard<std::mutex> lock(mutex_);
+            insert(std::move(*entry));
+            ++stats_.hits;
+            ++stats_.diskHits;
+            return body;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.misses;
+    return std::nullopt;
+}
+
+/*
+ * @brief Caches body under url for the endpoint's ttl. Does nothing when
+ * the endpoint has no ttl.
+ */
+void ResponseCache::put(const string& endpoint, const string& url, const string& body) {
+    Entry entry;
+    string directory;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = ttls_.find(endpoint);
+        if (it == ttls_.end() || it->second.count() <= 0) {
+            return;
+        }
+        entry = Entry{url, body, Clock::now() + it->second};
+        directory = diskDirectory_;
+    }
+
+    if (!directory.empty()) {
+        writeDisk(directory, entry);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    insert(std::move(entry));
+}
+
+void ResponseCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lru_.clear();
+    index_.clear();
+    bytes_ = 0;
+}
+
+ResponseCache::Stats ResponseCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats out = stats_;
+    out.entries = index_.size();
+    out.bytes = bytes_;
+    return out;
+}
+
+/*----------------------------------*/
+/*      Memory tier (mutex held)    */
+/*----------------------------------*/
+void ResponseCache::insert(Entry entry) {
+    std::size_t size = entry.url.size() + entry.body.size();
+    if (size > maxBytes_) {
+        return;
+    }
+
+    auto it = index_.find(entry.url);
+    if (it != index_.end()) {
+        bytes_ -= it->second->url.size() + it->second->body.size();
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+
+    lru_.push_front(std::move(entry));
+    index_.emplace(lru_.front().url, lru_.begin());
+    bytes_ += size;
+    evict();
+}
+
+/*
+ * Drops least recently used entries until under the memory budget.
+ */
+void ResponseCache::evict() {
+    while (bytes_ > maxBytes_ && !lru_.empty()) {
+        Entry& last = lru_.back();
+        bytes_ -= last.url.size() + last.body.size();
+        index_.erase(last.url);
+        lru_.pop_back();
+        ++stats_.evictions;
+    }
+}
+
+/*------------------*/
+/*      Disk tier   */
+/*------------------*/
+/*
+ * One file per url, named by its FNV-1a hash. The file holds the expiry
+ * (seconds since epoch) and the url on their own lines, then the body.
+ */
+string ResponseCache::diskPath(const string& directory, const string& url) const {
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : url) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.cache", static_cast<unsigned long long>(hash));
+    return (std::filesystem::path(directory) / name).string();
+}
+
+std::optional<ResponseCache::Entry> ResponseCache::readDisk(const string& directory, const string& url) const {
+    std::ifstream in(diskPath(directory, url), std::ios::binary);
+    if (!in) {
+        return std::nullopt;
+    }
+
+    long long expiry = 0;
+    string storedUrl;
+    in >> expiry;
+    in.ignore(1);
+    std::getline(in, storedUrl);
+    if (!in || storedUrl != url) {
+        return std::nullopt;    // unreadable or a hash collision
+    }
+
+    string body{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    return Entry{url, std::move(body), Clock::time_point{std::chrono::seconds{expiry}}};
+}
+
+/*
+ * Writes to a temporary file and renames it, so readers never see a
+ * partial entry. A failed write or rename removes the temporary file.
+ */
+void ResponseCache::writeDisk(const string& directory, const Entry& entry) const {
+    string path = diskPath(directory, entry.url);
+    std::ostringstream tmpName;
+    tmpName << path << '.' << std::this_thread::get_id() << ".tmp";
+    string tmp = tmpName.str();
+    bool written;
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (out) {
+            out << std::chrono::duration_cast<std::chrono::seconds>(
+                       entry.expiresAt.time_since_epoch()).count() << '\n'
+                << entry.url << '\n'
+                << entry.body;
+            out.close();
+        }
+        written = static_cast<bool>(out);
+    }
+    std::error_code ec;
+    if (written) {
+        std::filesystem::rename(tmp, path, ec);
+    }
+    if (!written || ec) {
+        std::filesystem::remove(tmp, ec);
+    }
+}
@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#include "retry_policy.hpp"
+
+//==============================================================================
+//                                RetryPolicy
+//==============================================================================
+bool RetryPolicy::retryable(CURLcode rc, long status) const {
+    switch (rc) {
+        case CURLE_OK:
+            return status == 408 || status == 429 || status == 500
+                || status == 502 || status == 503 || status == 504;
+        case CURLE_OPERATION_TIMEDOUT:
+            return retryTimeouts;
+        case CURLE_COULDNT_CONNECT:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_GOT_NOTHING:
+        case CURLE_PARTIAL_FILE:
+        case CURLE_HTTP2:
+        case CURLE_HTTP2_STREAM:
+            return true;
+        default:
+            return false;
+    }
+}
+
+std::chrono::milliseconds RetryPolicy::backoff(int attempt) const {
+    static thread_local std::mt19937_64 rng{std::random_device{}()};
+    std::chrono::milliseconds::rep cap = baseDelay.count();
+    for (int i = 1; i < attempt && cap < maxDelay.count(); ++i) {
+        cap *= 2;
+    }
+    cap = std::min(cap, maxDelay.count());
+    if (cap <= 0) {
+        return std::chrono::milliseconds{0};
+    }
+    return std::chrono::milliseconds{std::uniform_int_distribution<std::chrono::milliseconds::rep>{0, cap}(rng)};
+}
+
+//==============================================================================
+//                                DeadlineScope
+//==============================================================================
+static thread_local DeadlineScope::Clock::time_point scopedDeadline = DeadlineScope::Clock::time_point::max();
+
+DeadlineScope::DeadlineScope(std::chrono::milliseconds budget)
+    : DeadlineScope(Clock::now() + budget)
+{ }
+
+DeadlineScope::DeadlineScope(Clock::time_point deadline) : previous_{scopedDeadline} {
+    scopedDeadline = std::min(scopedDeadline, deadline);
+}
+
+DeadlineScope::~DeadlineScope() {
+    scopedDeadline = previous_;
+}
+
+DeadlineScope::Clock::time_point DeadlineScope::current() {
+    return scopedDeadline;
+}
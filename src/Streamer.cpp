@@ -0,0 +1,679 @@
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <curl/curl.h>
+#include <nlohmann/json.hpp>
+
+#include "json_push_parser.hpp"
+#include "logger.hpp"
+#include "stream_fields.hpp"
+#include "streamer.hpp"
+#include "websocket.hpp"
+
+using string = std::string;
+using json = nlohmann::json;
+using SteadyClock = std::chrono::steady_clock;
+
+static int millisUntil(SteadyClock::time_point deadline) {
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - SteadyClock::now()).count();
+    return static_cast<int>(std::clamp<long long>(left, 0, 1000));
+}
+
+//==============================================================================
+//                              StreamerInfo
+//==============================================================================
+StreamerInfo StreamerInfo::fromUserPreference(const string& body) {
+    json preference = json::parse(body, nullptr, false);
+    if (!preference.is_object() || !preference.contains("streamerInfo")
+        || !preference["streamerInfo"].is_array() || preference["streamerInfo"].empty()) {
+        throw std::runtime_error("userPreference response has no streamerInfo");
+    }
+    const json& entry = preference["streamerInfo"][0];
+    auto field = [&](const char* name) { return entry.value(name, string()); };
+    return {
+        field("streamerSocketUrl"),
+        field("schwabClientCustomerId"),
+        field("schwabClientCorrelId"),
+        field("schwabClientChannel"),
+        field("schwabClientFunctionId")
+    };
+}
+
+//==============================================================================
+//                          Streamer::Connection
+//==============================================================================
+/*--------------------------------------------------------------*/
+/*      One WebSocket session. libcurl opens the socket (and    */
+/*      TLS for wss://) with CONNECT_ONLY; the upgrade and the  */
+/*      framing are done here over curl_easy_send / _recv       */
+/*--------------------------------------------------------------*/
+class Streamer::Connection {
+    public:
+        Connection(const string& url, std::chrono::milliseconds timeout) : timeout_{timeout} {
+            std::size_t schemeEnd = url.find("://");
+            string scheme = schemeEnd == string::npos ? "" : url.substr(0, schemeEnd);
+            if (scheme != "ws" && scheme != "wss") {
+                throw std::runtime_error("streamer URL must be ws:// or wss://: " + url);
+            }
+            std::size_t pathStart = url.find('/', schemeEnd + 3);
+            string authority = url.substr(schemeEnd + 3, pathStart - schemeEnd - 3);
+            string path = pathStart == string::npos ? "/" : url.substr(pathStart);
+
+            curl_ = curl_easy_init();
+            if (!curl_) {
+                throw std::runtime_error("curl_easy_init failed");
+            }
+            string httpUrl = (scheme == "wss" ? "https://" : "http://") + authority + path;
+            curl_easy_setopt(curl_, CURLOPT_URL, httpUrl.c_str());
+            curl_easy_setopt(curl_, CURLOPT_CONNECT_ONLY, 1L);
+            curl_easy_setopt(curl_, CURLOPT_NOSIGNAL, 1L);
+            curl_easy_setopt(curl_, CURLOPT_CONNECTTIMEOUT_MS, static_cast<long>(timeout.count()));
+            curl_easy_setopt(curl_, CURLOPT_TCP_NODELAY, 1L);
+            CURLcode rc = curl_easy_perform(curl_);
+            if (rc != CURLE_OK) {
+                throw std::runtime_error(string("streamer connect failed: ") + curl_easy_strerror(rc));
+            }
+            curl_easy_getinfo(curl_, CURLINFO_ACTIVESOCKET, &socket_);
+
+            handshake(authority, path);
+        }
+
+        ~Connection() {
+            curl_easy_cleanup(curl_);
+        }
+
+        curl_socket_t socket() const { return socket_; }
+        WsReader& reader() { return reader_; }
+
+        void send(WsOpcode opcode, std::string_view payload) {
+            frame_.clear();
+            wsAppendFrame(frame_, opcode, payload, true, static_cast<std::uint32_t>(random_()));
+            sendAll(frame_);
+        }
+
+        /*
+         * @brief Moves everything readable into the reader without blocking.
+         * Returns the bytes read, or -1 once the peer has closed.
+         */
+        long long receive() {
+            long long total = 0;
+            while (true) {
+                std::size_t n = 0;
+                CURLcode rc = curl_easy_recv(curl_, chunk_, sizeof(chunk_), &n);
+                if (rc == CURLE_AGAIN) {
+                    return total;
+                }
+                if (rc != CURLE_OK || n == 0) {
+                    return -1;
+                }
+                reader_.append(chunk_, n);
+                total += static_cast<long long>(n);
+            }
+        }
+
+    private:
+        void handshake(const string& authority, const string& path) {
+            unsigned char nonce[16];
+            for (auto& byte : nonce) {
+                byte = static_cast<unsigned char>(random_());
+            }
+            string key = base64(nonce, sizeof(nonce));
+            sendAll("GET " + path + " HTTP/1.1\r\n"
+                    "Host: " + authority + "\r\n"
+                    "Upgrade: websocket\r\n"
+                    "Connection: Upgrade\r\n"
+                    "Sec-WebSocket-Key: " + key + "\r\n"
+                    "Sec-WebSocket-Version: 13\r\n\r\n");
+
+            // Read the response head; frames sent right after it are kept
+            string head;
+            auto deadline = SteadyClock::now() + timeout_;
+            std::size_t end;
+            while ((end = head.find("\r\n\r\n")) == string::npos) {
+                std::size_t n = 0;
+                CURLcode rc = curl_easy_recv(curl_, chunk_, sizeof(chunk_), &n);
+                if (rc == CURLE_AGAIN) {
+                    if (SteadyClock::now() >= deadline) {
+                        throw std::runtime_error("streamer handshake timed out");
+                    }
+                    wait(POLLIN, deadline);
+                    continue;
+                }
+                if (rc != CURLE_OK || n == 0) {
+                    throw std::runtime_error("streamer closed the connection during the handshake");
+                }
+                head.append(chunk_, n);
+            }
+            reader_.append(head.data() + end + 4, head.size() - end - 4);
+            head.resize(end + 2);
+
+            if (head.compare(0, 12, "HTTP/1.1 101") != 0) {
+                throw std::runtime_error("streamer refused the upgrade: " + head.substr(0, head.find('\r')));
+            }
+            // Header names are case-insensitive, the key itself is not
+            string lower = head;
+            std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+            std::size_t at = lower.find("\r\nsec-websocket-accept:");
+            string accept;
+            if (at != string::npos) {
+                at += 24;
+                accept = head.substr(at, head.find("\r\n", at) - at);
+                accept.erase(0, accept.find_first_not_of(' '));
+                accept.erase(accept.find_last_not_of(' ') + 1);
+            }
+            if (accept != wsAcceptKey(key)) {
+                throw std::runtime_error("streamer sent a bad Sec-WebSocket-Accept");
+            }
+        }
+
+        void sendAll(std::string_view data) {
+            auto deadline = SteadyClock::now() + timeout_;
+            while (!data.empty()) {
+                std::size_t n = 0;
+                CURLcode rc = curl_easy_send(curl_, data.data(), data.size(), &n);
+                if (rc == CURLE_AGAIN) {
+                    if (SteadyClock::now() >= deadline) {
+                        throw std::runtime_error("streamer send timed out");
+                    }
+                    wait(POLLOUT, deadline);
+                    continue;
+                }
+                if (rc != CURLE_OK) {
+                    throw std::runtime_error(string("streamer send failed: ") + curl_easy_strerror(rc));
+                }
+                data.remove_prefix(n);
+            }
+        }
+
+        void wait(short events, SteadyClock::time_point deadline) {
+            pollfd fd{socket_, events, 0};
+            ::poll(&fd, 1, millisUntil(deadline));
+        }
+
+        // members
+        CURL* curl_ = nullptr;
+        curl_socket_t socket_ = CURL_SOCKET_BAD;
+        std::chrono::milliseconds timeout_;
+        WsReader reader_;
+        string frame_;                  // outgoing frame, reused
+        char chunk_[16384];
+        std::mt19937 random_{std::random_device{}()};
+};
+
+//==============================================================================
+//                          Streamer::FrameDecoder
+//==============================================================================
+/*--------------------------------------------------------------*/
+/*      Decodes "data" frames straight from SAX events into     */
+/*      records, without building a document:                   */
+/*        {"data":[{"service":…,"timestamp":…,"content":[{…}]}]}  */
+/*      depth  1    2 3                             4 5          */
+/*      Frames with any other top-level key (responses,         */
+/*      notifications) are flagged for the slow path            */
+/*--------------------------------------------------------------*/
+class Streamer::FrameDecoder : public JsonHandler {
+    public:
+        explicit FrameDecoder(Streamer& owner) : owner_{owner} { }
+
+        // Returns true when the frame also needs handleControl()
+        bool decode(std::string_view frame) {
+            parser_.reset();
+            depth_ = 0;
+            inData_ = inContent_ = control_ = false;
+            parser_.feed(frame);
+            parser_.finish();
+            return control_;
+        }
+
+        void startObject() override {
+            ++depth_;
+            if (depth_ == 3 && inData_) {
+                service_ = -1;
+                timestamp_ = 0;
+            } else if (depth_ == 5 && inContent_) {
+                quote_ = LevelOneQuote{};
+                bar_ = ChartBar{};
+                quote_.serverTime = bar_.serverTime = timestamp_;
+                field_ = ignored;
+            }
+        }
+
+        void endObject() override {
+            if (depth_ == 5 && inContent_) {
+                if (service_ == static_cast<int>(StreamService::LevelOneEquities)) {
+                    owner_.deliver(quote_);
+                } else if (service_ == static_cast<int>(StreamService::ChartEquity)) {
+                    owner_.deliver(bar_);
+                }
+            }
+            --depth_;
+        }
+
+        void startArray() override {
+            ++depth_;
+            if (depth_ == 2) {
+                inData_ = topKeyIsData_;
+            } else if (depth_ == 4 && inData_ && itemKey_ == ItemKey::Content) {
+                inContent_ = true;
+            }
+        }
+
+        void endArray() override {
+            if (depth_ == 4) {
+                inContent_ = false;
+            } else if (depth_ == 2) {
+                inData_ = false;
+            }
+            --depth_;
+        }
+
+        void key(std::string_view name) override {
+            if (depth_ == 1) {
+                topKeyIsData_ = name == "data";
+                control_ |= !topKeyIsData_;
+            } else if (depth_ == 3 && inData_) {
+                itemKey_ = name == "service"   ? ItemKey::Service
+                         : name == "timestamp" ? ItemKey::Timestamp
+                         : name == "content"   ? ItemKey::Content
+                                               : ItemKey::Other;
+            } else if (depth_ == 5 && inContent_) {
+                unsigned number = 0;
+                auto [end, ec] = std::from_chars(name.data(), name.data() + name.size(), number);
+                field_ = name == "key" ? symbolKey
+                       : ec == std::errc{} && end == name.data() + name.size() ? static_cast<int>(number)
+                                                                               : ignored;
+            }
+        }
+
+        void string(std::string_view value) override {
+            if (depth_ == 3 && inData_ && itemKey_ == ItemKey::Service) {
+                service_ = serviceIndex(value);
+            } else if (depth_ == 5 && inContent_ && (field_ == symbolKey || (field_ == 0 && quote_.symbol.length == 0))) {
+                quote_.symbol.assign(value);
+                bar_.symbol.assign(value);
+            }
+        }
+
+        void number(double value) override {
+            if (depth_ == 3 && inData_ && itemKey_ == ItemKey::Timestamp) {
+                timestamp_ = static_cast<long long>(value);
+            } else if (depth_ == 5 && inContent_ && field_ > 0) {
+                if (service_ == static_cast<int>(StreamService::LevelOneEquities)) {
+                    setField(quote_, static_cast<unsigned>(field_), value);
+                } else {
+                    setField(bar_, static_cast<unsigned>(field_), value);
+                }
+            }
+        }
+
+    private:
+        enum class ItemKey : std::uint8_t { Service, Timestamp, Content, Other };
+        static constexpr int symbolKey = -1;
+        static constexpr int ignored = -2;
+
+        // members
+        Streamer& owner_;
+        JsonPushParser parser_{*this};
+        int depth_ = 0;
+        bool topKeyIsData_ = false;
+        bool inData_ = false, inContent_ = false, control_ = false;
+        ItemKey itemKey_ = ItemKey::Other;
+        int service_ = -1;
+        long long timestamp_ = 0;
+        int field_ = ignored;
+        LevelOneQuote quote_;
+        ChartBar bar_;
+};
+
+//==============================================================================
+//                                Streamer
+//==============================================================================
+Streamer::Streamer(StreamerInfo info, std::function<string()> accessToken, StreamerConfig config)
+    : info_{std::move(info)},
+      accessToken_{std::move(accessToken)},
+      config_{config},
+      queue_{config.queueCapacity}
+{
+    if (::pipe(wakeFds_) != 0) {
+        throw std::runtime_error("Streamer: pipe() failed");
+    }
+    for (int fd : wakeFds_) {
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+}
+
+Streamer::~Streamer() {
+    stop();
+    ::close(wakeFds_[0]);
+    ::close(wakeFds_[1]);
+}
+
+void Streamer::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    thread_ = std::thread(&Streamer::run, this);
+}
+
+void Streamer::stop() {
+    running_ = false;
+    wake();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+StreamerStats Streamer::stats() const {
+    return {frames_.load(), records_.load(), dropped_.load(), bytes_.load(), reconnects_.load()};
+}
+
+/*------------------------------*/
+/*      Subscriptions           */
+/*------------------------------*/
+/*
+ * The set is updated here so subscriptions() reads back at once; the
+ * streamer thread sends the change if it is logged in, and otherwise
+ * sends the whole set when it next logs in.
+ */
+void Streamer::subscribe(StreamService service, const std::vector<string>& symbols) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        symbols_[static_cast<int>(service)].insert(symbols.begin(), symbols.end());
+        commands_.push_back({service, true, symbols});
+    }
+    wake();
+}
+
+void Streamer::unsubscribe(StreamService service, const std::vector<string>& symbols) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& symbol : symbols) {
+            symbols_[static_cast<int>(service)].erase(symbol);
+        }
+        commands_.push_back({service, false, symbols});
+    }
+    wake();
+}
+
+std::vector<string> Streamer::subscriptions(StreamService service) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto& symbols = symbols_[static_cast<int>(service)];
+    return {symbols.begin(), symbols.end()};
+}
+
+/*------------------------------*/
+/*      Requests                */
+/*------------------------------*/
+string Streamer::request(StreamService service, std::string_view command, std::string_view keys) {
+    json parameters = {{"keys", keys}};
+    parameters["fields"] = service == StreamService::LevelOneEquities ? levelOneFieldList : chartFieldList;
+    json entry = {
+        {"service", serviceName(service)},
+        {"command", command},
+        {"requestid", std::to_string(++requestId_)},
+        {"SchwabClientCustomerId", info_.customerId},
+        {"SchwabClientCorrelId", info_.correlId},
+        {"parameters", parameters}
+    };
+    return json{{"requests", json::array({entry})}}.dump();
+}
+
+string Streamer::adminRequest(std::string_view command, std::string_view parameters) {
+    json entry = {
+        {"service", "ADMIN"},
+        {"command", command},
+        {"requestid", std::to_string(++requestId_)},
+        {"SchwabClientCustomerId", info_.customerId},
+        {"SchwabClientCorrelId", info_.correlId},
+        {"parameters", json::parse(parameters)}
+    };
+    return json{{"requests", json::array({entry})}}.dump();
+}
+
+void Streamer::sendLogin(Connection& connection) {
+    json parameters = {
+        {"Authorization", accessToken_()},
+        {"SchwabClientChannel", info_.channel},
+        {"SchwabClientFunctionId", info_.functionId}
+    };
+    connection.send(WsOpcode::Text, adminRequest("LOGIN", parameters.dump()));
+}
+
+static string joinSymbols(const auto& symbols) {
+    string keys;
+    for (const auto& symbol : symbols) {
+        keys += keys.empty() ? "" : ",";
+        keys += symbol;
+    }
+    return keys;
+}
+
+// After login: the whole set, replacing whatever the server had
+void Streamer::sendSubscriptions(Connection& connection) {
+    std::vector<string> requests;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        commands_.clear();
+        for (auto service : {StreamService::LevelOneEquities, StreamService::ChartEquity}) {
+            const auto& symbols = symbols_[static_cast<int>(service)];
+            if (!symbols.empty()) {
+                requests.push_back(request(service, "SUBS", joinSymbols(symbols)));
+            }
+        }
+    }
+    for (const auto& text : requests) {
+        connection.send(WsOpcode::Text, text);
+    }
+}
+
+void Streamer::sendCommands(Connection& connection, std::vector<Command>& commands, bool live) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        commands.swap(commands_);
+    }
+    if (live) {
+        for (const auto& command : commands) {
+            if (!command.symbols.empty()) {
+                connection.send(WsOpcode::Text,
+                                request(command.service, command.add ? "ADD" : "UNSUBS", joinSymbols(command.symbols)));
+            }
+        }
+    }
+    commands.clear();
+}
+
+/*------------------------------*/
+/*      Delivery                */
+/*------------------------------*/
+void Streamer::deliver(const LevelOneQuote& quote) {
+    records_.fetch_add(1, std::memory_order_relaxed);
+    if (quoteHandler_) {
+        quoteHandler_(quote);
+    } else if (!queue_.push(quote)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Streamer::deliver(const ChartBar& bar) {
+    records_.fetch_add(1, std::memory_order_relaxed);
+    if (chartHandler_) {
+        chartHandler_(bar);
+    } else if (!queue_.push(bar)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/*
+ * @brief Responses and notifications. A failed login ends the session;
+ * other failures are logged.
+ */
+void Streamer::handleControl(Connection& connection, std::string_view frame) {
+    json message = json::parse(frame, nullptr, false);
+    if (!message.is_object()) {
+        return;
+    }
+    Logger& logger = Logger::instance();
+
+    for (const auto& response : message.value("response", json::array())) {
+        string command = response.value("command", "");
+        json content = response.value("content", json::object());
+        int code = content.value("code", -1);
+        string text = content.value("msg", "");
+
+        if (command == "LOGIN") {
+            if (code != 0) {
+                throw std::runtime_error("streamer login failed (" + std::to_string(code) + "): " + text);
+            }
+            logger.log(LogComponent::Stream, LogLevel::Info, "Logged in to ", info_.socketUrl);
+            loggedIn_ = true;
+            state_ = StreamerState::Streaming;
+            sendSubscriptions(connection);
+        } else if (code != 0) {
+            logger.log(LogComponent::Stream, LogLevel::Warn,
+                       response.value("service", ""), " ", command, " failed (", code, "): ", text);
+        }
+    }
+
+    for (const auto& notification : message.value("notify", json::array())) {
+        if (notification.contains("content")) {
+            json content = notification["content"];
+            logger.log(LogComponent::Stream, LogLevel::Info,
+                       "Notification ", content.value("code", -1), ": ", content.value("msg", ""));
+        }
+    }
+}
+
+/*------------------------------*/
+/*      Thread                  */
+/*------------------------------*/
+void Streamer::wake() {
+    char byte = 1;
+    [[maybe_unused]] auto written = ::write(wakeFds_[1], &byte, 1);
+}
+
+// Returns true if woken before timeout
+bool Streamer::waitForWake(std::chrono::milliseconds timeout) {
+    pollfd fd{wakeFds_[0], POLLIN, 0};
+    int ready = ::poll(&fd, 1, static_cast<int>(timeout.count()));
+    char drain[64];
+    while (::read(wakeFds_[0], drain, sizeof(drain)) > 0) { }
+    return ready > 0;
+}
+
+/*
+ * Connects, logs in and streams until stopped, reconnecting with
+ * exponential backoff. The backoff starts over after every session that
+ * got as far as logging in.
+ */
+void Streamer::run() {
+    Logger& logger = Logger::instance();
+    std::chrono::milliseconds backoff{250};
+
+    while (running_) {
+        state_ = StreamerState::Connecting;
+        try {
+            Connection connection(info_.socketUrl, config_.connectTimeout);
+            session(connection);
+        } catch (const std::exception& e) {
+            logger.log(LogComponent::Stream, LogLevel::Warn, "Streamer session ended: ", e.what());
+        }
+        if (loggedIn_.exchange(false)) {
+            backoff = std::chrono::milliseconds{250};
+        }
+        if (!running_) {
+            break;
+        }
+
+        state_ = StreamerState::Backoff;
+        reconnects_.fetch_add(1, std::memory_order_relaxed);
+        logger.log(LogComponent::Stream, LogLevel::Info, "Reconnecting in ", backoff.count(), " ms");
+        auto resume = SteadyClock::now() + backoff;
+        while (running_ && SteadyClock::now() < resume) {
+            waitForWake(std::chrono::milliseconds{millisUntil(resume)});
+        }
+        backoff = std::min(backoff * 2, config_.maxBackoff);
+    }
+    state_ = StreamerState::Stopped;
+}
+
+void Streamer::session(Connection& connection) {
+    FrameDecoder decoder(*this);
+    std::vector<Command> commands;
+    sendLogin(connection);
+    auto lastFrame = SteadyClock::now();
+
+    while (running_) {
+        pollfd fds[2] = {{connection.socket(), POLLIN, 0}, {wakeFds_[0], POLLIN, 0}};
+        ::poll(fds, 2, millisUntil(lastFrame + config_.idleTimeout));
+        if (fds[1].revents) {
+            char drain[64];
+            while (::read(wakeFds_[0], drain, sizeof(drain)) > 0) { }
+        }
+
+        // Read whatever arrived, including bytes TLS had already buffered
+        long long received = connection.receive();
+        if (received < 0) {
+            throw std::runtime_error("streamer closed the connection");
+        }
+        bytes_.fetch_add(static_cast<std::uint64_t>(received), std::memory_order_relaxed);
+
+        WsReader::Message message;
+        while (connection.reader().next(message)) {
+            lastFrame = SteadyClock::now();
+            frames_.fetch_add(1, std::memory_order_relaxed);
+            switch (message.opcode) {
+                case WsOpcode::Text:
+                case WsOpcode::Binary:
+                    try {
+                        if (decoder.decode(message.payload)) {
+                            handleControl(connection, message.payload);
+                        }
+                    } catch (const std::exception& e) {
+                        if (!loggedIn_) {
+                            throw;
+                        }
+                        Logger::instance().log(LogComponent::Stream, LogLevel::Warn, "Bad streamer frame: ", e.what());
+                    }
+                    break;
+                case WsOpcode::Ping:
+                    connection.send(WsOpcode::Pong, message.payload);
+                    break;
+                case WsOpcode::Close:
+                    connection.send(WsOpcode::Close, message.payload.substr(0, 2));
+                    throw std::runtime_error("streamer sent close");
+                default:
+                    break;
+            }
+        }
+        if (connection.reader().error()) {
+            throw std::runtime_error("malformed WebSocket frame");
+        }
+
+        sendCommands(connection, commands, loggedIn_);
+        if (SteadyClock::now() - lastFrame >= config_.idleTimeout) {
+            throw std::runtime_error("no frames from the streamer for " + std::to_string(config_.idleTimeout.count()) + " ms");
+        }
+    }
+
+    // Stopped: log out politely, best effort
+    if (loggedIn_) {
+        connection.send(WsOpcode::Text, adminRequest("LOGOUT", "{}"));
+    }
+    connection.send(WsOpcode::Close, std::string_view("\x03\xe8", 2));
+}
@@ -1,4 +1,7 @@
-#include <iomanip>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
 #include <map>
 #include <mutex>
@@ -7,13 +10,33 @@
 #include <string>
 #include <vector>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <curl/curl.h>
 
+#include "file_io.hpp"
+#include "oauth_callback.hpp"
+#include "retry_policy.hpp"
 #include "schwab_api.hpp"
 #include "utils.hpp"
 
 using string = std::string;
 
+namespace {
+// The token endpoint refused the refresh token itself, as opposed to a
+// network or server failure; only a new authorization helps
+struct RefreshRejected : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+// No callback listener and stdin closed: nothing can ever deliver the
+// authorization code, so retrying is pointless
+struct NoAuthorizationInput : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+}
+
 //==============================================================================
 //                                Tokens
 //==============================================================================
@@ -25,28 +48,34 @@ Tokens::Tokens(const string appKey,
                const string appSecret,
                const string callbackUrl,
                const string tokensFile,
-               bool autoRefresh
+               bool autoRefresh,
+               const string baseUrl,
+               Metrics* metrics
 )   : appKey_{appKey},
       appSecret_{appSecret},
       callbackUrl_{callbackUrl},
-      tokensFile_{tokensFile}
+      baseUrl_{baseUrl + "v1/"},
+      tokensFile_{tokensFile},
+      metrics_{metrics},
+      autoRefresh_{autoRefresh}
 {
     loadFromFile(tokensFile_);
 
-    auto now = Clock::now();
-    if (now >= expiresAt_ || now >= refreshExpiresAt_) {
-        createTokens();
-        std::cout << "Successfully created authorization tokens!" << std::endl << std::flush;
-    }
-    else {
-        std::cout << "Successfully reauthorized from saved tokens!" << std::endl << std::flush;
+    // An unexpired access token is trusted as is; if it was revoked, the
+    // first 401 refreshes it. Anything else is left to the background thread
+    auto current = snapshot();
+    if (Clock::now() < current->expiresAt && Clock::now() < current->refreshExpiresAt) {
+        ready_.store(true, std::memory_order_release);
+        Logger::instance().log(LogComponent::Tokens, LogLevel::Info, "Successfully reauthorized from saved tokens");
+    } else {
+        Logger::instance().log(LogComponent::Tokens, LogLevel::Info,
+                               "Saved tokens are missing or expired; authorizing in the background");
     }
 
-    if (autoRefresh) {
-        startBackgroundRefresh();
-    } else {
-        std::cerr << "Warning: Tokens will not be updated automatically.\n";
+    if (!autoRefresh) {
+        Logger::instance().log(LogComponent::Tokens, LogLevel::Warn, "Tokens will not be updated automatically");
     }
+    startBackgroundRefresh();
 }
 
 Tokens::~Tokens() {
@@ -57,85 +86,228 @@ Tokens::~Tokens() {
 /*      Accessor methods        */
 /*------------------------------*/
 /*
- * Getter for accessToken_ member variable.
+ * Getter for the current access token.
  */
 string Tokens::accessToken() const {
-    return accessToken_;
+    awaitReady();
+    return snapshot_.load(std::memory_order_acquire)->accessToken;
 }
 
 /*
- * Getter for refreshToken_ member variable.
+ * Getter for the current refresh token.
  */
 string Tokens::refreshToken() const {
-    return refreshToken_;
+    awaitReady();
+    return snapshot_.load(std::memory_order_acquire)->refreshToken;
+}
+
+/*
+ * Current token state. The snapshot stays valid while held, even if
+ * the tokens are refreshed in the meantime.
+ */
+std::shared_ptr<const TokenSnapshot> Tokens::snapshot() const {
+    return snapshot_.load(std::memory_order_acquire);
+}
+
+/*
+ * The current token state once startup is done. Unlike accessToken(),
+ * copies no strings.
+ */
+std::shared_ptr<const TokenSnapshot> Tokens::readySnapshot() const {
+    awaitReady();
+    return snapshot_.load(std::memory_order_acquire);
+}
+
+bool Tokens::ready() const {
+    return ready_.load(std::memory_order_acquire);
+}
+
+/*
+ * @brief Waits for startup to produce usable tokens. Also gives up at the
+ * calling thread's DeadlineScope, and at once if startup has failed for
+ * good. Returns ready().
+ */
+bool Tokens::waitUntilReady(std::chrono::milliseconds timeout) const {
+    if (ready()) {
+        return true;
+    }
+    auto deadline = std::min(std::chrono::steady_clock::now() + timeout, DeadlineScope::current());
+    std::unique_lock<std::mutex> lock(readyMutex_);
+    readyChanged_.wait_until(lock, deadline, [this] { return ready() || startupFailed_; });
+    return ready();
+}
+
+void Tokens::awaitReady() const {
+    if (!ready() && !waitUntilReady(readyTimeout_)) {
+        throw std::runtime_error(startupFailed_ ? "Authorization failed; no way to receive the authorization code"
+                                                : "Timed out waiting for authorization tokens");
+    }
+}
+
+/*
+ * Swaps in new token state, releases anyone waiting for startup, and
+ * wakes the refresh thread so it can reschedule for the new expiry.
+ */
+void Tokens::publish(std::shared_ptr<const TokenSnapshot> next) {
+    snapshot_.store(std::move(next), std::memory_order_release);
+    if (!ready()) {
+        {
+            std::lock_guard<std::mutex> lock(readyMutex_);
+            ready_.store(true, std::memory_order_release);
+        }
+        readyChanged_.notify_all();
+    }
+    { std::lock_guard<std::mutex> lock(waitMutex_); }
+    wakeup_.notify_all();
 }
 
 /*-----------------------------------------------*/
 /*      Token creation and refresh methods       */
 /*-----------------------------------------------*/
 /*
- * Starts autorefresh on a new thread using blocking I/O.
- * Will be switching to non-blocking in the future.
+ * Starts startup and then autorefresh on a new thread.
  */
 void Tokens::startBackgroundRefresh() {
-    running_ = true;
+    {
+        std::lock_guard<std::mutex> lock(waitMutex_);
+        running_ = true;
+    }
     refreshThread_ = std::thread(&Tokens::refreshLoop, this);
 }
 
 /*
- * Stops thread autorefreshing authentification tokens.
+ * Stops thread autorefreshing authentification tokens. Wakes the
+ * thread immediately instead of waiting out its sleep.
  */
 void Tokens::stopBackgroundRefresh() {
-    running_ = false;
+    stopping_ = true;
+    {
+        std::lock_guard<std::mutex> lock(waitMutex_);
+        running_ = false;
+    }
+    wakeup_.notify_all();
     if (refreshThread_.joinable())
         refreshThread_.join();
 }
 
 /*
- * Uses blocking I/O to refresh tokens -- will add nonblocking in future
+ * Runs startup if the saved tokens were not usable, then sleeps until
+ * refreshLead_ before the access token expires and refreshes. Wakes
+ * early on shutdown or when the tokens are replaced by another path
+ * (e.g. a 401 refresh) and reschedules.
  */
 void Tokens::refreshLoop() {
+    if ((!ready() && !startup()) || !autoRefresh_) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(waitMutex_);
     while (running_) {
+        auto current = snapshot();
+        if (Clock::now() + refreshLead_ < current->expiresAt) {
+            wakeup_.wait_until(lock, current->expiresAt - refreshLead_, [&] {
+                return !running_ || snapshot() != current;
+            });
+            continue;
+        }
+
+        lock.unlock();
+        bool failed = false;
+        try {
+            Logger::instance().log(LogComponent::Tokens, LogLevel::Debug, "Refreshing tokens");
+            refreshTokens();
+            Logger::instance().log(LogComponent::Tokens, LogLevel::Info, "Refreshed tokens");
+        } catch (const std::exception& e) {
+            Logger::instance().log(LogComponent::Tokens, LogLevel::Error, "Failed to refresh tokens: ", e.what());
+            failed = true;
+        }
+        lock.lock();
+
+        if (failed) {
+            wakeup_.wait_for(lock, retryDelay_, [&] { return !running_; });
+        }
+    }
+}
+
+bool Tokens::startup() {
+    while (!stopping_) {
+        auto current = snapshot();
         auto now = Clock::now();
-        if (now >= expiresAt_) {
-            try {
-                std::cout << "refreshing tokens" << std::endl << std::flush;
-                refreshTokens();
-                std::cout << "successfully refreshed tokens" << std::endl << std::flush;
-            } catch (...) {
-                std::cerr << "Failed to refresh tokens\n";
+        try {
+            if (!current->refreshToken.empty() && now < current->refreshExpiresAt) {
+                try {
+                    refreshTokens();
+                    Logger::instance().log(LogComponent::Tokens, LogLevel::Info, "Successfully reauthorized from saved tokens");
+                    return true;
+                } catch (const RefreshRejected& e) {
+                    Logger::instance().log(LogComponent::Tokens, LogLevel::Warn, "Saved refresh token was rejected: ",
+                                           e.what());
+                }
+            }
+            createTokens();
+            Logger::instance().log(LogComponent::Tokens, LogLevel::Info, "Successfully created authorization tokens");
+            return true;
+        } catch (const NoAuthorizationInput& e) {
+            // Reported once; waiters are released rather than left to time out
+            Logger::instance().log(LogComponent::Tokens, LogLevel::Error, "Failed to authorize: ", e.what());
+            {
+                std::lock_guard<std::mutex> lock(readyMutex_);
+                startupFailed_ = true;
             }
+            readyChanged_.notify_all();
+            return false;
+        } catch (const std::exception& e) {
+            if (stopping_) {
+                return false;
+            }
+            Logger::instance().log(LogComponent::Tokens, LogLevel::Error, "Failed to authorize: ", e.what());
         }
-        std::this_thread::sleep_for(std::chrono::seconds(30));
+
+        std::unique_lock<std::mutex> lock(waitMutex_);
+        wakeup_.wait_for(lock, retryDelay_, [&] { return !running_; });
     }
+    return false;
 }
 
-/*                                                                                                                                                                                                                                                                                                                                                                                        
+/*
  * Creates authentification tokens and writes them a file
- * to save the state.
+ * to save the state. A loopback callback, http or https, is captured by
+ * a listener; the redirect URL can also be pasted on stdin.
  */
 void Tokens::createTokens() {
-    // Direct user to authorize URL
-    auto authUrl = baseUrl_ + "oauth/authorize?client_id=" + appKey_
-                 + "&redirect_uri=" + curl_easy_escape(nullptr, callbackUrl_.c_str(), 0);
+    char* encUri = curl_easy_escape(nullptr, callbackUrl_.c_str(), (int)callbackUrl_.size());
+    const string redirectUri = encUri;
+    curl_free(encUri);
+
+    // Listen before handing out the URL, so the redirect cannot arrive first
+    OAuthCallbackListener listener(callbackUrl_);
+    auto authUrl = baseUrl_ + "oauth/authorize?client_id=" + appKey_ + "&redirect_uri=" + redirectUri;
     std::cout << "Visit this link to authorize:\n" << authUrl << "\n";
-    std::cout << "Enter the full redirect URL: ";
-    string redirectUrl;
-    std::getline(std::cin, redirectUrl);
-
-    // Extract code
-    auto pos = redirectUrl.find("code=");
-    auto code = redirectUrl.substr(pos + 5);
-    if (auto amp = code.find('&')) code.resize(amp);
-
-    // 1) Build the POST body with a true URL-escaped redirect URI
-    char* encUri = curl_easy_escape(nullptr,
-                                    callbackUrl_.c_str(),
-                                    (int)callbackUrl_.size());
+    if (listener.listening()) {
+        std::cout << "Waiting for the redirect to " << callbackUrl_ << " (or paste it here)" << std::endl;
+        if (listener.tls()) {
+            std::cout << "The browser will warn about its self-signed certificate; proceed to "
+                      << listener.address() << " to finish" << std::endl;
+        }
+    } else {
+        std::cout << "Enter the full redirect URL: " << std::flush;
+    }
+    Logger::instance().log(LogComponent::Tokens, LogLevel::Info, "Waiting for authorization at ", authUrl);
+
+    string code = listener.awaitCode(stopping_);
+    if (code.empty() && stopping_) {
+        throw std::runtime_error("Authorization cancelled");
+    }
+    if (code.empty()) {
+        throw NoAuthorizationInput("no callback listener and stdin is closed; run interactively, or use a "
+                                   "loopback callback the listener can bind");
+    }
+
+    // 1) Build the POST body, escaping the code and the redirect URI
+    char* encCode = curl_easy_escape(nullptr, code.c_str(), (int)code.size());
     std::string body = "grant_type=authorization_code"
-                     + std::string("&code=") + code
-                     + std::string("&redirect_uri=") + encUri;
-    curl_free(encUri);
+                     + std::string("&code=") + encCode
+                     + std::string("&redirect_uri=") + redirectUri;
+    curl_free(encCode);
 
     // Initialize curl
     CURL* curl = curl_easy_init();
@@ -161,24 +333,79 @@ void Tokens::createTokens() {
         throw std::runtime_error(curl_easy_strerror(rc));
 
     // Now parse resp
-    auto j = json::parse(response);
+    auto j = json::parse(response, nullptr, false);
+    if (!j.is_object() || !j.contains("access_token")) {
+        Logger::instance().log(LogComponent::Tokens, LogLevel::Error, "Authorization failed, response: ", response);
+        throw std::runtime_error("Missing access_token in authorization response");
+    }
+
+    std::lock_guard<std::mutex> lock(refreshMutex_);
+    publish(std::make_shared<const TokenSnapshot>(TokenSnapshot{
+        j.at("access_token").get<string>(),
+        j.at("refresh_token").get<string>(),
+        Clock::now() + accessTimeoutSeconds_,
+        Clock::now() + refreshTimeoutHours_
+    }));
 
-    accessToken_ = j.at("access_token").get<string>();
-    refreshToken_ = j.at("refresh_token").get<string>();
-    expiresAt_ = Clock::now() + accessTimeoutSeconds_;
-    refreshExpiresAt_ = Clock::now() + refreshTimeoutHours_;
-    
     writeToFile(tokensFile_);
 }
 
-/*                                                                                                                                                                                                                                                                                                                                                                                        
+/*
  * Refreshes the tokens from the current refresh token.
  */
 void Tokens::refreshTokens() {
+    std::lock_guard<std::mutex> lock(refreshMutex_);
+    refreshLocked();
+}
+
+/*
+ * @brief Refreshes after the server rejected staleAccessToken. If another
+ * caller already replaced it, returns without a second refresh.
+ * Returns false if the refresh failed.
+ */
+bool Tokens::refreshIfStale(const string& staleAccessToken) {
+    std::lock_guard<std::mutex> lock(refreshMutex_);
+    if (snapshot()->accessToken != staleAccessToken) {
+        return true;
+    }
+    try {
+        refreshLocked();
+    } catch (const std::exception& e) {
+        Logger::instance().log(LogComponent::Tokens, LogLevel::Error, "Failed to refresh tokens: ", e.what());
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Refresh implementation; refreshMutex_ must be held. Times the
+ * refresh when metrics are attached.
+ */
+void Tokens::refreshLocked() {
+    if (!metrics_) {
+        refreshRequest();
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    try {
+        refreshRequest();
+    } catch (...) {
+        metrics_->tokenRefreshed(std::chrono::steady_clock::now() - start, false);
+        throw;
+    }
+    metrics_->tokenRefreshed(std::chrono::steady_clock::now() - start, true);
+}
+
+/*
+ * Exchanges the refresh token for new tokens and publishes them.
+ */
+void Tokens::refreshRequest() {
+    const string currentRefreshToken = snapshot()->refreshToken;
+
     // Build the POST body, URL-escaping the refresh token itself:
     char* encToken = curl_easy_escape(nullptr,
-                                      refreshToken_.c_str(),
-                                      (int)refreshToken_.size());
+                                      currentRefreshToken.c_str(),
+                                      (int)currentRefreshToken.size());
     std::string body = "grant_type=refresh_token&refresh_token=" + std::string(encToken);
     curl_free(encToken);
 
@@ -200,26 +427,34 @@ void Tokens::refreshTokens() {
     curl_easy_setopt(curl, CURLOPT_WRITEDATA,    &response);
 
     CURLcode rc = curl_easy_perform(curl);
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
     curl_easy_cleanup(curl);
     if (rc != CURLE_OK) {
         throw std::runtime_error(std::string("curl perform failed: ")
                                  + curl_easy_strerror(rc));
     }
 
-    // Parse and throw error if we still didn’t get tokens
-    auto j = json::parse(response);
-    if (!j.contains("access_token")) {
-        std::cerr << "Refresh failed, response:\n" << response << "\n";
+    // Parse and throw error if we still didn’t get tokens. A 400 or 401
+    // means the refresh token itself is no good
+    auto j = json::parse(response, nullptr, false);
+    if (!j.is_object() || !j.contains("access_token")) {
+        Logger::instance().log(LogComponent::Tokens, LogLevel::Error, "Refresh failed, response: ", response);
+        if (status == 400 || status == 401) {
+            throw RefreshRejected("Refresh token rejected (HTTP " + std::to_string(status) + ")");
+        }
         throw std::runtime_error("Missing access_token in refresh response");
     }
 
-    // Store new tokens + expirations
-    accessToken_       = j["access_token"].get<string>();
-    refreshToken_      = j["refresh_token"].get<string>();
-    expiresAt_         = Clock::now() + accessTimeoutSeconds_;
-    refreshExpiresAt_  = Clock::now() + refreshTimeoutHours_;
+    // Publish new tokens + expirations
+    publish(std::make_shared<const TokenSnapshot>(TokenSnapshot{
+        j["access_token"].get<string>(),
+        j["refresh_token"].get<string>(),
+        Clock::now() + accessTimeoutSeconds_,
+        Clock::now() + refreshTimeoutHours_
+    }));
 
-    std::cout << "Authorized and generated token!" << std::endl << std::flush;
+    Logger::instance().log(LogComponent::Tokens, LogLevel::Info, "Authorized and generated token");
 
     // Write back to your tokensFile_ (no argument)
     writeToFile(tokensFile_);
@@ -237,51 +472,85 @@ void Tokens::loadFromFile(string& path) {
     std::ifstream in(path);
     // On first run, there is no file to load from
     if (!in) {
-        expiresAt_ = Clock::time_point::min();
-        refreshExpiresAt_ = Clock::time_point::min();
+        snapshot_.store(std::make_shared<const TokenSnapshot>(TokenSnapshot{
+            "", "", Clock::time_point::min(), Clock::time_point::min()
+        }));
+        return;
+    }
+    // Load from previous state. A damaged file is treated as missing
+    json savedAuthState = json::parse(in, nullptr, false);
+    if (!savedAuthState.is_object()) {
+        Logger::instance().log(LogComponent::Tokens, LogLevel::Warn, "Ignoring unreadable tokens file ", path);
+        snapshot_.store(std::make_shared<const TokenSnapshot>(TokenSnapshot{
+            "", "", Clock::time_point::min(), Clock::time_point::min()
+        }));
         return;
     }
-    // Load from previous state
-    json savedAuthState; 
-    in >> savedAuthState;
-    accessToken_  = savedAuthState.value("access_token",  "");
-    refreshToken_ = savedAuthState.value("refresh_token", "");
 
     auto accessExpiration = savedAuthState.value("access_token_expiration",  0LL);
     auto refreshExpiration = savedAuthState.value("refresh_token_expiration", 0LL);
 
-    expiresAt_ = Clock::time_point{std::chrono::seconds{accessExpiration}};
-    refreshExpiresAt_ = Clock::time_point{std::chrono::seconds{refreshExpiration}};
+    snapshot_.store(std::make_shared<const TokenSnapshot>(TokenSnapshot{
+        savedAuthState.value("access_token",  ""),
+        savedAuthState.value("refresh_token", ""),
+        Clock::time_point{std::chrono::seconds{accessExpiration}},
+        Clock::time_point{std::chrono::seconds{refreshExpiration}}
+    }));
 }
 
 /*
  * @brief Writes the new access token, refresh token, access token
  * expiration time (ms since epoch), and refresh token 
  * exiration (ms since epoch) to a json file to save the state.
+ * Written to a temporary file, synced and renamed over path, so a
+ * crash leaves either the old tokens or the new ones. Callers hold
+ * refreshMutex_.
  */
 void Tokens::writeToFile(string& path) {
     // Build the JSON with integer timestamps
+    auto current = snapshot();
     json output;
-    output["access_token"] = accessToken_;
-    output["refresh_token"] = refreshToken_;
+    output["access_token"] = current->accessToken;
+    output["refresh_token"] = current->refreshToken;
     output["access_token_expiration"] = std::chrono::duration_cast<std::chrono::seconds>(
-                                        expiresAt_.time_since_epoch()
+                                        current->expiresAt.time_since_epoch()
                                     ).count();
     output["refresh_token_expiration"] = std::chrono::duration_cast<std::chrono::seconds>(
-                                        refreshExpiresAt_.time_since_epoch()
+                                        current->refreshExpiresAt.time_since_epoch()
                                     ).count();
 
-    // Open the same file we loaded from
-    std::ofstream out(path);
-    if (!out) {
-        throw std::runtime_error("Could not open " + path + " for writing");
+    string text = output.dump(2) + "\n";
+
+    // Owner-only: the file holds live credentials
+    string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open " + tmp + " for writing: " + std::strerror(errno));
+    }
+    try {
+        writeAll(fd, text.data(), text.size(), tmp);
+        if (::fsync(fd) != 0) {
+            throw std::runtime_error("Failed to sync " + tmp + ": " + std::strerror(errno));
+        }
+    } catch (...) {
+        ::close(fd);
+        ::unlink(tmp.c_str());
+        throw;
+    }
+    ::close(fd);
+
+    if (::rename(tmp.c_str(), path.c_str()) != 0) {
+        int error = errno;
+        ::unlink(tmp.c_str());
+        throw std::runtime_error("Failed to write tokens to " + path + ": " + std::strerror(error));
     }
 
-    // Pretty-print and flush
-    out << std::setw(2) << output << "\n";
-    out.flush();
-    if (!out) {
-        throw std::runtime_error("Failed to write tokens to " + path);
+    // Sync the directory so the rename itself survives a crash
+    string directory = std::filesystem::path(path).parent_path().string();
+    int dirFd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dirFd >= 0) {
+        ::fsync(dirFd);
+        ::close(dirFd);
     }
 }
 
@@ -0,0 +1,427 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+
+using string = std::string;
+
+/*--------------------------------------------------------------*/
+/*      Compile-time descriptions of the market data endpoints  */
+/*      Each schema lists its path template and typed           */
+/*      parameters; name lookups use a perfect hash found by    */
+/*      the compiler, and urls are built without iostreams      */
+/*--------------------------------------------------------------*/
+enum class ParamType : std::uint8_t {
+    String,
+    Integer,    // optional '-' and digits
+    Number,     // any double
+    Boolean,    // true or false
+    Choice,     // one of the '|' separated choices, any case; sent as listed
+    Path        // substituted for {name} in the path; always required
+};
+
+struct ParamSpec {
+    std::string_view name;
+    ParamType type = ParamType::String;
+    bool required = false;
+    std::string_view choices = {};
+};
+
+struct SchemaError {
+    enum Kind : std::uint8_t { None, UnknownKey, BadValue, Missing } kind = None;
+    std::string_view key;
+
+    explicit operator bool() const { return kind != None; }
+    const char* what() const {
+        switch (kind) {
+            case UnknownKey: return "unknown key ";
+            case BadValue:   return "bad value for ";
+            case Missing:    return "missing ";
+            case None:       break;
+        }
+        return "";
+    }
+};
+
+/*------------------------------*/
+/*      Percent-encoding        */
+/*------------------------------*/
+/*
+ * RFC 3986 encoding, matching curl_easy_escape: everything but letters,
+ * digits and -._~ becomes %XX.
+ */
+constexpr bool isUnreserved(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')
+        || c == '-' || c == '.' || c == '_' || c == '~';
+}
+
+constexpr std::size_t encodedSize(std::string_view value) {
+    std::size_t size = 0;
+    for (unsigned char c : value) {
+        size += isUnreserved(c) ? 1 : 3;
+    }
+    return size;
+}
+
+inline void appendEncoded(string& out, std::string_view value) {
+    static constexpr char hex[] = "0123456789ABCDEF";
+    for (unsigned char c : value) {
+        if (isUnreserved(c)) {
+            out += static_cast<char>(c);
+        } else {
+            char escaped[3] = {'%', hex[c >> 4], hex[c & 0xf]};
+            out.append(escaped, 3);
+        }
+    }
+}
+
+//==============================================================================
+//                              EndpointSchema
+//==============================================================================
+template <std::size_t N>
+class EndpointSchema {
+    static_assert(N > 0 && N <= 64, "a schema has between 1 and 64 parameters");
+
+    public:
+        static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+        /*
+         * Searches for a hash seed that sends every name to its own slot. Runs
+         * at compile time; a schema without one fails to compile.
+         */
+        consteval EndpointSchema(std::string_view name, std::string_view path, const ParamSpec (&params)[N])
+            : name_{name}, path_{path}
+        {
+            for (std::size_t i = 0; i < N; ++i) {
+                params_[i] = params[i];
+                order_[i] = i;
+                if (params[i].required || params[i].type == ParamType::Path) {
+                    required_ |= std::uint64_t{1} << i;
+                }
+            }
+            std::sort(order_.begin(), order_.end(),
+                      [&](std::size_t a, std::size_t b) { return params_[a].name < params_[b].name; });
+
+            for (seed_ = 1; ; ++seed_) {
+                if (seed_ > 100000) {
+                    throw "no perfect hash seed for this schema";
+                }
+                slots_.fill(emptySlot);
+                bool collided = false;
+                for (std::size_t i = 0; i < N && !collided; ++i) {
+                    auto& slot = slots_[hash(params_[i].name, seed_) & (tableSize - 1)];
+                    collided = slot != emptySlot;
+                    slot = static_cast<std::uint8_t>(i);
+                }
+                if (!collided) {
+                    break;
+                }
+            }
+        }
+
+        constexpr std::size_t size() const { return N; }
+        constexpr std::string_view name() const { return name_; }
+        constexpr std::string_view path() const { return path_; }
+        constexpr const ParamSpec& param(std::size_t i) const { return params_[i]; }
+        constexpr std::uint64_t requiredMask() const { return required_; }
+        constexpr std::size_t sortedIndex(std::size_t i) const { return order_[i]; }    // by name
+
+        // Parameter index, or npos for an unknown name
+        constexpr std::size_t index(std::string_view key) const {
+            std::uint8_t slot = slots_[hash(key, seed_) & (tableSize - 1)];
+            return slot != emptySlot && params_[slot].name == key ? slot : npos;
+        }
+
+        static constexpr bool valueMatches(const ParamSpec& spec, std::string_view value);
+
+    private:
+        static constexpr std::size_t tableSize = std::bit_ceil(2 * N);
+        static constexpr std::uint8_t emptySlot = 0xff;
+
+        // FNV-1a, seeded
+        static constexpr std::uint32_t hash(std::string_view key, std::uint32_t seed) {
+            std::uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+            for (unsigned char c : key) {
+                h = (h ^ c) * 16777619u;
+            }
+            return h ^ (h >> 15);
+        }
+
+        // members
+        std::string_view name_, path_;
+        std::array<ParamSpec, N> params_{};
+        std::array<std::size_t, N> order_{};
+        std::array<std::uint8_t, tableSize> slots_{};
+        std::uint64_t required_ = 0;
+        std::uint32_t seed_ = 0;
+};
+
+/*
+ * The choice matching value, spelled as in the schema, or "" if none does.
+ */
+constexpr std::string_view matchChoice(std::string_view choices, std::string_view value) {
+    auto lower = [](char c) { return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c; };
+    while (!choices.empty()) {
+        std::size_t bar = choices.find('|');
+        std::string_view choice = choices.substr(0, bar);
+        if (choice.size() == value.size() && std::equal(choice.begin(), choice.end(), value.begin(),
+                [&](char x, char y) { return lower(x) == lower(y); })) {
+            return choice;
+        }
+        choices.remove_prefix(bar == std::string_view::npos ? choices.size() : bar + 1);
+    }
+    return {};
+}
+
+template <std::size_t N>
+constexpr bool EndpointSchema<N>::valueMatches(const ParamSpec& spec, std::string_view value) {
+    switch (spec.type) {
+        case ParamType::String:
+            return true;
+        case ParamType::Path:
+            return !value.empty();
+        case ParamType::Integer: {
+            std::string_view digits = value.starts_with('-') ? value.substr(1) : value;
+            return !digits.empty() && std::all_of(digits.begin(), digits.end(),
+                                                  [](char c) { return c >= '0' && c <= '9'; });
+        }
+        case ParamType::Number: {
+            double parsed;
+            auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), parsed);
+            return ec == std::errc() && end == value.data() + value.size();
+        }
+        case ParamType::Boolean:
+            return !matchChoice("true|false", value).empty();
+        case ParamType::Choice:
+            return !matchChoice(spec.choices, value).empty();
+    }
+    return false;
+}
+
+template <std::size_t N>
+EndpointSchema(std::string_view, std::string_view, const ParamSpec (&)[N]) -> EndpointSchema<N>;
+
+//==============================================================================
+//                                EndpointUrl
+//==============================================================================
+/*
+ * @brief Collects the parameters of one request to Schema and builds its
+ * url. Names given as literals are checked against the schema at compile
+ * time; values are views, so the arguments must outlive build(). The
+ * query lists parameters sorted by name, the same order a std::map gives.
+ */
+template <const auto& Schema>
+class EndpointUrl {
+    public:
+        static constexpr std::size_t size = Schema.size();
+
+        // A parameter name known at compile time
+        class Param {
+            public:
+                consteval Param(const char* name) : index_{Schema.index(name)} {
+                    if (index_ == Schema.npos) {
+                        throw "not a parameter of this endpoint";
+                    }
+                }
+                std::size_t index() const { return index_; }
+
+            private:
+                std::size_t index_;
+        };
+
+        EndpointUrl& set(Param param, std::string_view value) {
+            values_[param.index()] = value;
+            present_ |= std::uint64_t{1} << param.index();
+            return *this;
+        }
+        EndpointUrl& set(Param param, const char* value) {
+            return set(param, std::string_view(value));
+        }
+        EndpointUrl& set(Param param, bool value) {
+            return set(param, value ? std::string_view("true") : std::string_view("false"));
+        }
+        template <std::integral T> requires (!std::same_as<T, bool>)
+        EndpointUrl& set(Param param, T value) {
+            char* text = numbers_[param.index()].data();
+            auto [end, ec] = std::to_chars(text, text + numberSize, value);
+            return set(param, std::string_view(text, static_cast<std::size_t>(end - text)));
+        }
+
+        // Sets parameters by runtime name; stops at the first unknown one
+        SchemaError set(const std::map<string, string>& params) {
+            for (auto const& [key, value] : params) {
+                std::size_t i = Schema.index(key);
+                if (i == Schema.npos) {
+                    return {SchemaError::UnknownKey, key};
+                }
+                values_[i] = value;
+                present_ |= std::uint64_t{1} << i;
+            }
+            return {};
+        }
+
+        // Checks value types and required parameters
+        SchemaError check() const {
+            if ((present_ & Schema.requiredMask()) != Schema.requiredMask()) {
+                for (std::size_t i = 0; i < size; ++i) {
+                    if ((Schema.requiredMask() >> i & 1) && !(present_ >> i & 1)) {
+                        return {SchemaError::Missing, Schema.param(i).name};
+                    }
+                }
+            }
+            for (std::size_t i = 0; i < size; ++i) {
+                if ((present_ >> i & 1) && !Schema.valueMatches(Schema.param(i), values_[i])) {
+                    return {SchemaError::BadValue, Schema.param(i).name};
+                }
+            }
+            return {};
+        }
+
+        // baseUrl + path + query, in a single allocation
+        string build(std::string_view baseUrl) const {
+            string url;
+            build(baseUrl, url);
+            return url;
+        }
+
+        // As above, into url; no allocation once url has the capacity
+        void build(std::string_view baseUrl, string& url) const {
+            url.clear();
+            url.reserve(baseUrl.size() + length());
+            url.append(baseUrl);
+            appendPath(url);
+            char separator = '?';
+            for (std::size_t n = 0; n < size; ++n) {
+                std::size_t i = Schema.sortedIndex(n);
+                if (!(present_ >> i & 1) || Schema.param(i).type == ParamType::Path) {
+                    continue;
+                }
+                url += separator;
+                separator = '&';
+                appendEncoded(url, Schema.param(i).name);
+                url += '=';
+                appendEncoded(url, value(i));
+            }
+        }
+
+    private:
+        static constexpr std::size_t numberSize = 24;
+
+        // Choices and booleans go out as the schema spells them
+        std::string_view value(std::size_t i) const {
+            const ParamSpec& spec = Schema.param(i);
+            if (spec.type == ParamType::Choice || spec.type == ParamType::Boolean) {
+                std::string_view canonical = matchChoice(
+                    spec.type == ParamType::Boolean ? std::string_view("true|false") : spec.choices, values_[i]);
+                if (!canonical.empty()) {
+                    return canonical;
+                }
+            }
+            return values_[i];
+        }
+
+        std::size_t length() const {
+            std::size_t length = Schema.path().size();
+            for (std::size_t i = 0; i < size; ++i) {
+                if (present_ >> i & 1) {
+                    length += encodedSize(Schema.param(i).name) + encodedSize(value(i)) + 2;
+                }
+            }
+            return length;
+        }
+
+        void appendPath(string& url) const {
+            std::string_view path = Schema.path();
+            for (std::size_t open; (open = path.find('{')) != std::string_view::npos; ) {
+                std::size_t close = path.find('}', open);
+                url.append(path.substr(0, open));
+                appendEncoded(url, values_[Schema.index(path.substr(open + 1, close - open - 1))]);
+                path.remove_prefix(close + 1);
+            }
+            url.append(path);
+        }
+
+        // members
+        std::array<std::string_view, size> values_{};
+        std::array<std::array<char, numberSize>, size> numbers_;
+        std::uint64_t present_ = 0;
+};
+
+/*------------------------------*/
+/*      Market data endpoints   */
+/*------------------------------*/
+inline constexpr EndpointSchema priceHistorySchema{"priceHistory", "marketdata/v1/pricehistory", {
+    {"symbol", ParamType::String, true},
+    {"periodType", ParamType::Choice, false, "day|month|year|ytd"},
+    {"period", ParamType::Integer},
+    {"frequencyType", ParamType::Choice, false, "minute|daily|weekly|monthly"},
+    {"frequency", ParamType::Integer},
+    {"startDate", ParamType::Integer},     // epoch ms
+    {"endDate", ParamType::Integer},
+    {"needExtendedHoursData", ParamType::Boolean},
+    {"needPreviousClose", ParamType::Boolean}
+}};
+
+inline constexpr EndpointSchema optionChainsSchema{"optionChains", "marketdata/v1/chains", {
+    {"symbol", ParamType::String, true},
+    {"contractType", ParamType::Choice, false, "CALL|PUT|ALL"},
+    {"strikeCount", ParamType::Integer},
+    {"includeUnderlyingQuote", ParamType::Boolean},
+    {"strategy", ParamType::Choice, false,
+        "SINGLE|ANALYTICAL|COVERED|VERTICAL|CALENDAR|STRANGLE|STRADDLE|BUTTERFLY|CONDOR|DIAGONAL|COLLAR|ROLL"},
+    {"interval", ParamType::Number},
+    {"range", ParamType::Choice, false, "ITM|NTM|OTM|SAK|SBK|SNK|ALL"},
+    {"fromDate", ParamType::String},       // yyyy-mm-dd
+    {"startDate", ParamType::String},
+    {"volatility", ParamType::Number},
+    {"underlyingPrice", ParamType::Number},
+    {"interestRate", ParamType::Number},
+    {"daysToExpiration", ParamType::Integer},
+    {"expMonth", ParamType::Choice, false, "JAN|FEB|MAR|APR|MAY|JUN|JUL|AUG|SEP|OCT|NOV|DEC|ALL"},
+    {"optionType", ParamType::String},
+    {"entitlement", ParamType::Choice, false, "PN|NP|PP"}
+}};
+
+inline constexpr EndpointSchema expirationChainSchema{"optionExpirationChains", "marketdata/v1/expirationchain", {
+    {"symbol", ParamType::String, true}
+}};
+
+inline constexpr EndpointSchema marketHoursSchema{"marketHours", "marketdata/v1/markets", {
+    {"markets", ParamType::String, true},   // comma separated
+    {"date", ParamType::String}
+}};
+
+inline constexpr EndpointSchema moversSchema{"movers", "marketdata/v1/movers/{symbol_id}", {
+    {"symbol_id", ParamType::Path},
+    {"sort", ParamType::Choice, false, "VOLUME|TRADES|PERCENT_CHANGE_UP|PERCENT_CHANGE_DOWN"},
+    {"frequency", ParamType::Choice, false, "0|1|5|10|30|60"}
+}};
+
+inline constexpr EndpointSchema instrumentsSchema{"instruments", "marketdata/v1/instruments", {
+    {"symbol", ParamType::String, true},
+    {"projection", ParamType::Choice, true,
+        "symbol-search|symbol-regex|desc-search|desc-regex|search|fundamental"}
+}};
+
+inline constexpr EndpointSchema instrumentByCusipSchema{"instruments", "marketdata/v1/instruments/{cusip_id}", {
+    {"cusip_id", ParamType::Path}
+}};
+
+inline constexpr EndpointSchema quotesSchema{"quotes", "marketdata/v1/quotes", {
+    {"symbols", ParamType::String, true},   // comma separated
+    {"fields", ParamType::String},
+    {"indicative", ParamType::Boolean}
+}};
+
+inline constexpr EndpointSchema quoteSchema{"quotes", "marketdata/v1/{symbol_id}/quotes", {
+    {"symbol_id", ParamType::Path},
+    {"fields", ParamType::String}
+}};
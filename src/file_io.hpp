@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*--------------------------------------------------------------*/
+/*      File helpers shared by the on-disk stores               */
+/*--------------------------------------------------------------*/
+/*
+ * Read-only mapping of a whole file. Empty when the file is missing.
+ * advice is passed to madvise (MADV_SEQUENTIAL for one pass,
+ * MADV_WILLNEED to fault everything in up front).
+ */
+class MappedFile {
+    public:
+        explicit MappedFile(const std::string& path, int advice = MADV_SEQUENTIAL) {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) return;
+            struct stat st{};
+            if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+                void* p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    data_ = static_cast<const char*>(p);
+                    size_ = static_cast<std::size_t>(st.st_size);
+                    ::madvise(p, size_, advice);
+                }
+            }
+            ::close(fd);
+        }
+        ~MappedFile() {
+            if (data_) ::munmap(const_cast<char*>(data_), size_);
+        }
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const char* data() const { return data_; }
+        std::size_t size() const { return size_; }
+
+    private:
+        const char* data_ = nullptr;
+        std::size_t size_ = 0;
+};
+
+/*
+ * Writes all of data to fd, retrying short writes. Throws naming file.
+ */
+inline void writeAll(int fd, const char* data, std::size_t size, const std::string& file) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Failed to append to " + file + ": " + std::strerror(errno));
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <string_view>
+
+struct ssl_ctx_st;
+
+/*--------------------------------------------------------------*/
+/*      Receives the authorization code Schwab redirects the    */
+/*      browser to after login. For a loopback callback it      */
+/*      listens on that host and port and answers the redirect  */
+/*      itself, over TLS with a self-signed certificate made    */
+/*      at startup for https; the redirect URL can also be      */
+/*      pasted on stdin, which is the only way in for any       */
+/*      other callback                                          */
+/*--------------------------------------------------------------*/
+class OAuthCallbackListener {
+    public:
+        // Does not throw: for a callback that is not on loopback, or when
+        // its address cannot be bound (e.g. port 443 without root),
+        // listening() is false and only stdin is read
+        explicit OAuthCallbackListener(const std::string& callbackUrl);
+        ~OAuthCallbackListener();
+
+        OAuthCallbackListener(const OAuthCallbackListener&) = delete;
+        OAuthCallbackListener& operator=(const OAuthCallbackListener&) = delete;
+
+        bool listening() const { return listenFd_ >= 0; }
+        bool tls() const { return tls_ != nullptr; }
+        const std::string& address() const { return address_; }
+
+        /*
+         * @brief Waits for a redirect carrying a code, on the socket or
+         * stdin, and returns the code URL-decoded. Returns "" once stop
+         * is set or when there is nothing left to wait on, i.e. there is
+         * no listener and stdin is closed. Throws
+         * std::runtime_error if the redirect carries an error instead.
+         */
+        std::string awaitCode(const std::atomic<bool>& stop);
+
+    private:
+        // Answers one connection; returns its code, or "" for a request without one
+        std::string serveOne();
+
+        // members
+        int listenFd_ = -1;
+        ssl_ctx_st* tls_ = nullptr;     // SSL_CTX for an https callback
+        std::string address_;           // host:port, for the log
+        std::string pasted_;            // stdin read so far
+        bool readStdin_ = false;
+};
+
+// The named query parameter of url (a full URL or a request target),
+// URL-decoded; "" when absent
+std::string queryParam(std::string_view url, std::string_view name);
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <type_traits>
+
+#include "streamer.hpp"
+
+/*--------------------------------------------------------------*/
+/*      Field number <-> record member, shared by the decoder   */
+/*      and the mock server's encoder                           */
+/*--------------------------------------------------------------*/
+inline constexpr LevelOneField levelOneFields[] = {
+    LevelOneField::Bid, LevelOneField::Ask, LevelOneField::Last, LevelOneField::BidSize,
+    LevelOneField::AskSize, LevelOneField::TotalVolume, LevelOneField::LastSize, LevelOneField::High,
+    LevelOneField::Low, LevelOneField::Close, LevelOneField::Open, LevelOneField::NetChange,
+    LevelOneField::High52Week, LevelOneField::Low52Week, LevelOneField::Mark, LevelOneField::QuoteTime,
+    LevelOneField::TradeTime, LevelOneField::NetPercentChange
+};
+
+// The fields requested on subscription: the symbol plus every decoded field
+inline constexpr const char* levelOneFieldList = "0,1,2,3,4,5,8,9,10,11,12,17,18,19,20,33,34,35,42";
+inline constexpr const char* chartFieldList = "0,1,2,3,4,5,6,7,8";
+inline constexpr unsigned chartFieldCount = 9;
+
+/*
+ * @brief Calls fn with the member holding field, or returns false for a
+ * field the record does not keep. Quote may be const.
+ */
+template <typename Quote, typename Fn>
+bool visitField(Quote& quote, unsigned field, Fn&& fn)
+    requires std::is_same_v<std::remove_const_t<Quote>, LevelOneQuote> {
+    switch (static_cast<LevelOneField>(field)) {
+        case LevelOneField::Bid:              fn(quote.bid); return true;
+        case LevelOneField::Ask:              fn(quote.ask); return true;
+        case LevelOneField::Last:             fn(quote.last); return true;
+        case LevelOneField::BidSize:          fn(quote.bidSize); return true;
+        case LevelOneField::AskSize:          fn(quote.askSize); return true;
+        case LevelOneField::TotalVolume:      fn(quote.totalVolume); return true;
+        case LevelOneField::LastSize:         fn(quote.lastSize); return true;
+        case LevelOneField::High:             fn(quote.high); return true;
+        case LevelOneField::Low:              fn(quote.low); return true;
+        case LevelOneField::Close:            fn(quote.close); return true;
+        case LevelOneField::Open:             fn(quote.open); return true;
+        case LevelOneField::NetChange:        fn(quote.netChange); return true;
+        case LevelOneField::High52Week:       fn(quote.high52Week); return true;
+        case LevelOneField::Low52Week:        fn(quote.low52Week); return true;
+        case LevelOneField::Mark:             fn(quote.mark); return true;
+        case LevelOneField::QuoteTime:        fn(quote.quoteTime); return true;
+        case LevelOneField::TradeTime:        fn(quote.tradeTime); return true;
+        case LevelOneField::NetPercentChange: fn(quote.netPercentChange); return true;
+    }
+    return false;
+}
+
+template <typename Bar, typename Fn>
+bool visitField(Bar& bar, unsigned field, Fn&& fn)
+    requires std::is_same_v<std::remove_const_t<Bar>, ChartBar> {
+    switch (field) {
+        case 1: fn(bar.open); return true;
+        case 2: fn(bar.high); return true;
+        case 3: fn(bar.low); return true;
+        case 4: fn(bar.close); return true;
+        case 5: fn(bar.volume); return true;
+        case 6: fn(bar.sequence); return true;
+        case 7: fn(bar.time); return true;
+        case 8: fn(bar.chartDay); return true;
+    }
+    return false;
+}
+
+inline bool setField(LevelOneQuote& quote, unsigned field, double value) {
+    bool kept = visitField(quote, field, [&](auto& member) {
+        member = static_cast<std::remove_reference_t<decltype(member)>>(value);
+    });
+    if (kept) {
+        quote.present |= std::uint64_t{1} << field;
+    }
+    return kept;
+}
+
+inline bool setField(ChartBar& bar, unsigned field, double value) {
+    return visitField(bar, field, [&](auto& member) {
+        member = static_cast<std::remove_reference_t<decltype(member)>>(value);
+    });
+}
+
+// The server's name for a service
+inline const char* serviceName(StreamService service) {
+    switch (service) {
+        case StreamService::LevelOneEquities: return "LEVELONE_EQUITIES";
+        case StreamService::ChartEquity:      return "CHART_EQUITY";
+    }
+    return "";
+}
+
+// -1 for a service the streamer does not decode
+inline int serviceIndex(std::string_view name) {
+    if (name == "LEVELONE_EQUITIES") return static_cast<int>(StreamService::LevelOneEquities);
+    if (name == "CHART_EQUITY") return static_cast<int>(StreamService::ChartEquity);
+    return -1;
+}
@@ -1,7 +1,9 @@
-#include <sstream>
+#include <string>
+#include <string_view>
 
 #include <curl/curl.h>
 
+#include "logger.hpp"
 #include "utils.hpp"
 
 using string = std::string;
@@ -18,29 +20,45 @@ size_t curlCallback(void* contents, size_t size, size_t nmemb, void* userp) {
 }
 
 /*
- * Helper to URL-encode a string
+ * Builds the header list sent with every API request. The caller frees
+ * it with curl_slist_free_all.
  */
-string urlEncode(CURL* curl, const string& s) {
-    char* output = curl_easy_escape(curl, s.c_str(), (int)s.length());
-    string encoded(output);
-    curl_free(output);
-    return encoded;
+struct curl_slist* authHeaders(const string& accessToken) {
+    struct curl_slist* headers = nullptr;
+    string auth = "Authorization: Bearer " + accessToken;
+    headers = curl_slist_append(headers, auth.c_str());
+    headers = curl_slist_append(headers, "Accept: application/json");
+    return headers;
 }
 
 /*
- * Helper to build query from a map 
+ * CURLOPT_DEBUGFUNCTION forwarding libcurl's verbose output to the logger
+ * at http=trace, one line per header. Body data is skipped and the bearer
+ * token is redacted.
  */
-string buildQuery(CURL* curl, const std::map<string, string>& params) {
-    if (params.empty()) return "";
-    std::ostringstream ss;
-    ss << '?';
-    bool first = true;
-    for (auto& kv : params) {
-        if (!first) ss << '&';
-        first = false;
-        ss << urlEncode(curl, kv.first)
-           << '='
-           << urlEncode(curl, kv.second);
+int curlDebugLog(CURL*, curl_infotype type, char* data, size_t size, void*) {
+    const char* prefix;
+    switch (type) {
+        case CURLINFO_TEXT:       prefix = "* "; break;
+        case CURLINFO_HEADER_IN:  prefix = "< "; break;
+        case CURLINFO_HEADER_OUT: prefix = "> "; break;
+        default: return 0;
     }
-    return ss.str();
-}
\ No newline at end of file
+    std::string_view text(data, size);
+    while (!text.empty()) {
+        std::size_t end = text.find('\n');
+        std::string_view line = text.substr(0, end);
+        text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty()) {
+            continue;
+        }
+        if (line.starts_with("Authorization:")) {
+            line = "Authorization: <redacted>";
+        }
+        Logger::instance().log(LogComponent::Http, LogLevel::Trace, prefix, line);
+    }
+    return 0;
+}
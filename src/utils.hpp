@@ -1,4 +1,3 @@
-#include <map>
 #include <string>
 
 #include <curl/curl.h>
@@ -6,5 +5,5 @@
 using string = std::string;
 
 size_t curlCallback(void* contents, size_t size, size_t nmemb, void* userp);
-string urlEncode(CURL* curl, const string& s);
-string buildQuery(CURL* curl, const std::map<string, string>& params);
\ No newline at end of file
+struct curl_slist* authHeaders(const string& accessToken);
+int curlDebugLog(CURL* curl, curl_infotype type, char* data, size_t size, void* userp);
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+/*--------------------------------------------------------------*/
+/*      The parts of RFC 6455 the streamer and its mock need:   */
+/*      the handshake key, frame headers and an incremental     */
+/*      frame reader. Transport is left to the caller           */
+/*--------------------------------------------------------------*/
+enum class WsOpcode : std::uint8_t {
+    Continuation = 0x0,
+    Text = 0x1,
+    Binary = 0x2,
+    Close = 0x8,
+    Ping = 0x9,
+    Pong = 0xA
+};
+
+/*------------------------------*/
+/*      Handshake               */
+/*------------------------------*/
+inline std::array<std::uint8_t, 20> sha1(std::string_view data) {
+    std::uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    auto rotl = [](std::uint32_t x, int n) { return (x << n) | (x >> (32 - n)); };
+
+    std::string message(data);
+    std::uint64_t bits = static_cast<std::uint64_t>(data.size()) * 8;
+    message += '\x80';
+    while (message.size() % 64 != 56) {
+        message += '\0';
+    }
+    for (int i = 7; i >= 0; --i) {
+        message += static_cast<char>(bits >> (i * 8));
+    }
+
+    for (std::size_t block = 0; block < message.size(); block += 64) {
+        std::uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            const auto* p = reinterpret_cast<const unsigned char*>(message.data() + block + i * 4);
+            w[i] = std::uint32_t{p[0]} << 24 | std::uint32_t{p[1]} << 16 | std::uint32_t{p[2]} << 8 | p[3];
+        }
+        for (int i = 16; i < 80; ++i) {
+            w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        std::uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            std::uint32_t f, k;
+            if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else             { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+            std::uint32_t next = rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = next;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+
+    std::array<std::uint8_t, 20> digest;
+    for (int i = 0; i < 20; ++i) {
+        digest[i] = static_cast<std::uint8_t>(h[i / 4] >> (24 - i % 4 * 8));
+    }
+    return digest;
+}
+
+inline std::string base64(const std::uint8_t* data, std::size_t size) {
+    static constexpr char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((size + 2) / 3 * 4);
+    for (std::size_t i = 0; i < size; i += 3) {
+        std::uint32_t n = std::uint32_t{data[i]} << 16;
+        if (i + 1 < size) n |= std::uint32_t{data[i + 1]} << 8;
+        if (i + 2 < size) n |= data[i + 2];
+        out += alphabet[n >> 18 & 63];
+        out += alphabet[n >> 12 & 63];
+        out += i + 1 < size ? alphabet[n >> 6 & 63] : '=';
+        out += i + 2 < size ? alphabet[n & 63] : '=';
+    }
+    return out;
+}
+
+// The Sec-WebSocket-Accept a server must answer key with
+inline std::string wsAcceptKey(std::string_view key) {
+    std::string text(key);
+    text += "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    auto digest = sha1(text);
+    return base64(digest.data(), digest.size());
+}
+
+/*------------------------------*/
+/*      Framing                 */
+/*------------------------------*/
+/*
+ * @brief Appends one complete frame to out. Clients must pass a mask key
+ * (masked is true); servers send unmasked frames.
+ */
+inline void wsAppendFrame(std::string& out, WsOpcode opcode, std::string_view payload,
+                          bool masked = false, std::uint32_t maskKey = 0) {
+    std::size_t size = payload.size();
+    out += static_cast<char>(0x80 | static_cast<std::uint8_t>(opcode));
+    char maskBit = masked ? '\x80' : '\0';
+    if (size < 126) {
+        out += static_cast<char>(maskBit | static_cast<char>(size));
+    } else if (size <= 0xFFFF) {
+        out += static_cast<char>(maskBit | 126);
+        out += static_cast<char>(size >> 8);
+        out += static_cast<char>(size);
+    } else {
+        out += static_cast<char>(maskBit | 127);
+        for (int i = 7; i >= 0; --i) {
+            out += static_cast<char>(static_cast<std::uint64_t>(size) >> (i * 8));
+        }
+    }
+    if (!masked) {
+        out.append(payload);
+        return;
+    }
+
+    char mask[4] = {static_cast<char>(maskKey >> 24), static_cast<char>(maskKey >> 16),
+                    static_cast<char>(maskKey >> 8), static_cast<char>(maskKey)};
+    out.append(mask, 4);
+    std::size_t start = out.size();
+    out.append(payload);
+    for (std::size_t i = 0; i < size; ++i) {
+        out[start + i] ^= mask[i & 3];
+    }
+}
+
+/*
+ * Reassembles messages from bytes as they arrive. Fragments are joined,
+ * masked payloads unmasked, and control frames returned as they come.
+ */
+class WsReader {
+    public:
+        struct Message {
+            WsOpcode opcode;
+            std::string_view payload;     // valid until the next call
+        };
+
+        void append(const char* data, std::size_t size) {
+            // Drop what was read, cheaply when nothing is left over
+            if (start_ == buffer_.size()) {
+                buffer_.clear();
+                start_ = 0;
+            } else if (start_ >= 64 * 1024) {
+                buffer_.erase(0, start_);
+                start_ = 0;
+            }
+            buffer_.append(data, size);
+        }
+
+        // Returns false once no complete message is buffered. Sets error()
+        // on a frame this reader cannot accept
+        bool next(Message& message) {
+            while (true) {
+                std::size_t available = buffer_.size() - start_;
+                if (available < 2) {
+                    return false;
+                }
+                const auto* p = reinterpret_cast<const unsigned char*>(buffer_.data() + start_);
+                bool fin = p[0] & 0x80;
+                auto opcode = static_cast<WsOpcode>(p[0] & 0x0F);
+                bool masked = p[1] & 0x80;
+                std::uint64_t size = p[1] & 0x7F;
+                std::size_t header = 2;
+                if (size == 126) {
+                    if (available < 4) return false;
+                    size = std::uint64_t{p[2]} << 8 | p[3];
+                    header = 4;
+                } else if (size == 127) {
+                    if (available < 10) return false;
+                    size = 0;
+                    for (int i = 0; i < 8; ++i) {
+                        size = size << 8 | p[2 + i];
+                    }
+                    header = 10;
+                }
+                if (size > maxMessage_) {
+                    error_ = true;
+                    return false;
+                }
+                std::size_t maskAt = header;
+                header += masked ? 4 : 0;
+                if (available < header + size) {
+                    return false;
+                }
+
+                char* payload = buffer_.data() + start_ + header;
+                if (masked) {
+                    const char* mask = buffer_.data() + start_ + maskAt;
+                    for (std::size_t i = 0; i < size; ++i) {
+                        payload[i] ^= mask[i & 3];
+                    }
+                }
+                start_ += header + size;
+
+                std::string_view body(payload, size);
+                bool control = static_cast<std::uint8_t>(opcode) & 0x8;
+                if (control || (fin && opcode != WsOpcode::Continuation && !fragmented_)) {
+                    message = {opcode, body};
+                    return true;
+                }
+
+                // A fragmented message: collect until the final piece
+                if (opcode != WsOpcode::Continuation) {
+                    fragments_.assign(body);
+                    fragmentOpcode_ = opcode;
+                    fragmented_ = true;
+                } else if (fragmented_) {
+                    fragments_.append(body);
+                } else {
+                    error_ = true;
+                    return false;
+                }
+                if (fin) {
+                    fragmented_ = false;
+                    message = {fragmentOpcode_, fragments_};
+                    return true;
+                }
+            }
+        }
+
+        bool error() const { return error_; }
+
+        void reset() {
+            buffer_.clear();
+            fragments_.clear();
+            start_ = 0;
+            fragmented_ = false;
+            error_ = false;
+        }
+
+    private:
+        // members
+        std::string buffer_;
+        std::size_t start_ = 0;             // first unread byte of buffer_
+        std::string fragments_;
+        WsOpcode fragmentOpcode_ = WsOpcode::Text;
+        bool fragmented_ = false;
+        bool error_ = false;
+
+        static constexpr std::uint64_t maxMessage_ = 64 << 20;
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+// Minimal checks for the behaviour tests: CHECK prints the failed
+// condition and counts it; a test's main returns finish(name).
+
+#include <cstdio>
+
+inline int failures = 0;
+
+#define CHECK(cond)                                                             \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            ++failures;                                                         \
+        }                                                                       \
+    } while (0)
+
+inline int finish(const char* name) {
+    if (failures) {
+        std::printf("%s: %d failure(s)\n", name, failures);
+        return 1;
+    }
+    std::printf("%s: ok\n", name);
+    return 0;
+}
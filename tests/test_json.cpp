@@ -0,0 +1,151 @@
+// Behaviour tests for JsonPushParser. Prints each failure and exits
+// non-zero if there was any.
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "json_push_parser.hpp"
+#include "check.hpp"
+
+using string = std::string;
+
+/*----------------------------------------------*/
+/*      Records parser events as one string     */
+/*----------------------------------------------*/
+class Recorder : public JsonHandler {
+    public:
+        std::string events;
+
+        void startObject() override { events += "{ "; }
+        void endObject() override { events += "} "; }
+        void startArray() override { events += "[ "; }
+        void endArray() override { events += "] "; }
+        void key(std::string_view name) override { events += "k:" + std::string(name) + " "; }
+        void string(std::string_view value) override { events += "s:" + std::string(value) + " "; }
+        void number(double value) override { events += "n:" + std::to_string(value) + " "; }
+        void boolean(bool value) override { events += value ? "true " : "false "; }
+        void null() override { events += "null "; }
+};
+
+/*
+ * Events for text fed as the given chunks; "error" if feed or finish threw.
+ */
+template <typename... Chunks>
+static string parse(Chunks... chunks) {
+    Recorder recorder;
+    JsonPushParser parser(recorder);
+    try {
+        (parser.feed(std::string_view(chunks)), ...);
+        parser.finish();
+    } catch (const std::runtime_error&) {
+        return "error";
+    }
+    return recorder.events;
+}
+
+static string parseBytewise(std::string_view text) {
+    Recorder recorder;
+    JsonPushParser parser(recorder);
+    try {
+        for (char c : text) {
+            parser.feed(&c, 1);
+        }
+        parser.finish();
+    } catch (const std::runtime_error&) {
+        return "error";
+    }
+    return recorder.events;
+}
+
+/*
+ * Text gives expected whole, split in two at every offset, and fed one
+ * byte at a time.
+ */
+static void checkSplits(std::string_view text, const string& expected) {
+    CHECK(parse(text) == expected);
+    for (std::size_t at = 0; at <= text.size(); ++at) {
+        string events = parse(text.substr(0, at), text.substr(at));
+        if (events != expected) {
+            std::printf("split at %zu of %.*s: %s\n", at, static_cast<int>(text.size()), text.data(), events.c_str());
+            ++failures;
+        }
+    }
+    CHECK(parseBytewise(text) == expected);
+}
+
+//==============================================================================
+//                              JsonPushParser
+//==============================================================================
+static void testChunkedStrings() {
+    // Plain strings and keys split anywhere, including inside them
+    checkSplits(R"({"symbol":"AAPL","bid":189.5})", "{ k:symbol s:AAPL k:bid n:189.500000 } ");
+
+    // Escapes, including a split between '\' and the escaped character
+    checkSplits(R"(["a\"b","c\\d","e\/f","\b\f\n\r\t"])",
+                "[ s:a\"b s:c\\d s:e/f s:\b\f\n\r\t ] ");
+
+    // \u escapes, and a surrogate pair split between its halves
+    checkSplits(R"({"k\u00e9y":"\u00e9\u20ac\ud83d\ude00"})",
+                "{ k:k\xC3\xA9y s:\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80 } ");
+}
+
+static void testContainers() {
+    checkSplits(R"({"a":[1,-2.5e3,true,false,null],"b":{},"c":[]})",
+                "{ k:a [ n:1.000000 n:-2500.000000 true false null ] k:b { } k:c [ ] } ");
+    checkSplits(" [ [ ] , { \"x\" : [ { } ] } ] ", "[ [ ] { k:x [ { } ] } ] ");
+}
+
+static void testTopLevelScalars() {
+    // Numbers and literals only end at finish() when nothing follows them
+    checkSplits("42", "n:42.000000 ");
+    checkSplits("-0.5e-2", "n:-0.005000 ");
+    checkSplits("true", "true ");
+    checkSplits("false", "false ");
+    checkSplits("null", "null ");
+    checkSplits(R"("text")", "s:text ");
+}
+
+static void testEmptyAndTruncated() {
+    CHECK(parse("") == "error");
+    CHECK(parse("   ") == "error");
+    for (std::string_view cut : {"{", "[1,2", R"({"a")", R"({"a":)", R"({"a":1,)", R"("abc)",
+                                 R"("\u00)", R"("\ud83d)", "tru", "nul", R"(["x\)"}) {
+        if (parse(cut) != "error") {
+            std::printf("truncated %.*s was accepted\n", static_cast<int>(cut.size()), cut.data());
+            ++failures;
+        }
+    }
+}
+
+static void testMalformed() {
+    for (std::string_view bad : {"}", R"({"a" 1})", "[1 2]", "[1,]", R"({"a":1,})", "{1:2}",
+                                 "tru e", "01x", "[nul]", R"("\x")"}) {
+        if (parse(bad) != "error") {
+            std::printf("malformed %.*s was accepted\n", static_cast<int>(bad.size()), bad.data());
+            ++failures;
+        }
+    }
+}
+
+static void testReset() {
+    Recorder recorder;
+    JsonPushParser parser(recorder);
+    parser.feed(R"({"a":[1,)");
+    parser.reset();
+    recorder.events.clear();
+    parser.feed("[true]");
+    parser.finish();
+    CHECK(recorder.events == "[ true ] ");
+}
+
+int main() {
+    testChunkedStrings();
+    testContainers();
+    testTopLevelScalars();
+    testEmptyAndTruncated();
+    testMalformed();
+    testReset();
+    return finish("test_json");
+}
@@ -0,0 +1,98 @@
+// Behaviour tests for JsonDocument. Prints each failure and exits
+// non-zero if there was any.
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "json_document.hpp"
+#include "check.hpp"
+
+using string = std::string;
+
+//==============================================================================
+//                              JsonDocument
+//==============================================================================
+static void testDocumentValues() {
+    JsonDocument doc;
+    JsonValue root = doc.parse(R"({"AAPL":{"quote":{"bidPrice":189.5,"halted":false}},"list":[1,"two",null],)"
+                               R"("esc":"a\"b\u00e9"})");
+    CHECK(root.isObject());
+    CHECK(root.size() == 3);
+    CHECK(root["AAPL"]["quote"]["bidPrice"].number() == 189.5);
+    CHECK(root["AAPL"]["quote"]["halted"].isBoolean());
+    CHECK(!root["AAPL"]["quote"]["halted"].boolean(true));
+    CHECK(root["list"].size() == 3);
+    CHECK(root["list"][1].string() == "two");
+    CHECK(root["list"][2].isNull());
+    CHECK(root["list"][7].isNull());
+    CHECK(root["esc"].string() == "a\"b\xC3\xA9");
+    CHECK(root["missing"]["deeper"].number(-1) == -1);
+}
+
+static void testDocumentEmptyAndMalformed() {
+    JsonDocument doc;
+    CHECK(doc.parse("").isNull());
+
+    doc.parse(R"({"a":1})");
+    bool threw = false;
+    try {
+        doc.parse(R"({"a":[1,2)");
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+    CHECK(doc.root().isNull());
+
+    // Usable again after a failure
+    CHECK(doc.parse("[1]")[0].number() == 1);
+}
+
+static void testDocumentTopLevelScalars() {
+    JsonDocument doc;
+    CHECK(doc.parse("42").number() == 42);
+    CHECK(doc.parse("true").boolean());
+    CHECK(doc.parse("null").isNull());
+    CHECK(doc.parse(R"("x\ny")").string() == "x\ny");
+}
+
+/*
+ * A document bigger than the first block spills upstream; the next
+ * parse runs in one grown block and must read back the same values.
+ */
+static void testDocumentArenaGrowth() {
+    string text = "{";
+    for (int i = 0; i < 500; ++i) {
+        if (i) text += ",";
+        text += "\"k" + std::to_string(i) + "\":[" + std::to_string(i) + ",\"v\\u00e9" + std::to_string(i) + "\"]";
+    }
+    text += "}";
+
+    JsonDocument doc(1024);
+    std::size_t initial = doc.arenaBytes();
+    for (int pass = 0; pass < 3; ++pass) {
+        JsonValue root = doc.parse(text);
+        CHECK(root.size() == 500);
+        CHECK(root["k0"][0].number() == 0);
+        CHECK(root["k499"][0].number() == 499);
+        CHECK(root["k250"][1].string() == "v\xC3\xA9" "250");
+        if (pass == 0) {
+            CHECK(doc.arenaBytes() > initial);
+        }
+    }
+    std::size_t grown = doc.arenaBytes();
+    doc.parse(text);
+    CHECK(doc.arenaBytes() == grown);     // no longer spilling
+
+    // A smaller document after growth
+    CHECK(doc.parse(R"({"only":1})")["only"].number() == 1);
+}
+
+int main() {
+    testDocumentValues();
+    testDocumentEmptyAndMalformed();
+    testDocumentTopLevelScalars();
+    testDocumentArenaGrowth();
+    return finish("test_json_document");
+}
@@ -0,0 +1,72 @@
+// Behaviour tests for QuoteBatchMerger. Prints each failure and exits
+// non-zero if there was any.
+
+#include <cstdio>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+#include "quote_batches.hpp"
+#include "check.hpp"
+
+using string = std::string;
+using json = nlohmann::json;
+
+//==============================================================================
+//                              QuoteBatchMerger
+//==============================================================================
+static void testInvalidSymbolsInTwoBatches() {
+    QuoteBatchMerger merger;
+    CHECK(merger.add(R"({"AAPL":{"symbol":"AAPL","quote":{"lastPrice":189.5}},)"
+                     R"("errors":{"invalidSymbols":["BAD1","BAD2"]}})"));
+    CHECK(merger.add(R"( { "errors" : { "invalidSymbols" : ["BAD3"] } , )"
+                     R"("MSFT" : {"symbol":"MSFT","note":"a } and \" in a string"} } )"));
+
+    string merged = merger.str();
+    json parsed = json::parse(merged, nullptr, false);
+    CHECK(!parsed.is_discarded());
+
+    // One "errors" key in the text, not one per batch
+    CHECK(merged.find("\"errors\"") == merged.rfind("\"errors\""));
+    CHECK(parsed.size() == 3);
+    CHECK(parsed["AAPL"]["quote"]["lastPrice"] == 189.5);
+    CHECK(parsed["MSFT"]["note"] == "a } and \" in a string");
+    CHECK(parsed["errors"]["invalidSymbols"] == json::array({"BAD1", "BAD2", "BAD3"}));
+}
+
+static void testWithoutErrors() {
+    QuoteBatchMerger merger;
+    CHECK(merger.str() == "{}");
+    CHECK(merger.add("{}"));
+    CHECK(merger.add(R"({"A":[1,{"b":[]}]})"));
+    CHECK(merger.add(R"({"B":null,"C":-1.5e3})"));
+    CHECK(merger.str() == R"({"A":[1,{"b":[]}],"B":null,"C":-1.5e3})");
+}
+
+static void testErrorsOnly() {
+    QuoteBatchMerger merger;
+    CHECK(merger.add(R"({"errors":{"invalidSymbols":["X"]}})"));
+    CHECK(merger.str() == R"({"errors":{"invalidSymbols":["X"]}})");
+}
+
+static void testRejectsNonObjects() {
+    QuoteBatchMerger merger;
+    CHECK(merger.add(R"({"A":1})"));
+    for (string bad : {"", "[]", "error", R"({"B":2)", R"({"B":2} x)", R"({"B" 2})", R"({"B":})",
+                       R"({"B":{"c":1})", R"({"B":"open})", R"({"B":1,"errors":{"invalidSymbols":[}})"}) {
+        if (merger.add(bad)) {
+            std::printf("accepted %s\n", bad.c_str());
+            ++failures;
+        }
+    }
+    // A rejected body adds nothing
+    CHECK(merger.str() == R"({"A":1})");
+}
+
+int main() {
+    testInvalidSymbolsInTwoBatches();
+    testWithoutErrors();
+    testErrorsOnly();
+    testRejectsNonObjects();
+    return finish("test_quotes");
+}